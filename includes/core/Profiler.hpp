@@ -0,0 +1,187 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Frame profiler.
+//
+// cpu zones can be opened on any thread, every thread appends to its own ring
+// without locks and end_frame() drains the rings into the frame that just ended.
+// gpu zones are GL_TIME_ELAPSED queries on the context thread, they are read back
+// without stalling once the gpu got to them, usually a few frames later.
+//
+// instrument code with the PROFILE_* macros below, they compile to nothing unless
+// the ENABLE_PROFILER cmake option is on.
+
+struct CpuZoneEvent {
+  // string literal, zones never copy their names
+  const char* name;
+  int64_t start_ns;
+  int64_t end_ns;
+  uint32_t thread;
+};
+
+struct GpuZoneEvent {
+  const char* name;
+  // cpu time the zone was submitted at, the gpu runs it some time later
+  int64_t submit_ns;
+  int64_t elapsed_ns;
+};
+
+struct ProfiledFrame {
+  uint64_t index;
+  int64_t start_ns;
+  int64_t end_ns;
+  // sorted by start time
+  std::vector<CpuZoneEvent> cpu_zones;
+  std::vector<GpuZoneEvent> gpu_zones;
+  int64_t gpu_ns;
+  // gpu zones of the frame whose queries are not available yet
+  uint32_t gpu_pending;
+};
+
+// milliseconds
+struct Percentiles {
+  double p50;
+  double p95;
+  double p99;
+  double max;
+};
+
+// nearest rank percentiles of samples in milliseconds
+Percentiles percentiles(std::vector<double> values);
+
+struct ZoneStats {
+  std::string name;
+  bool gpu;
+  // frames the zone ran in and calls over those frames
+  size_t frames;
+  size_t calls;
+  // time spent in the zone per frame
+  Percentiles ms;
+};
+
+struct ProfilerStats {
+  size_t frames;
+  Percentiles cpu_frame;
+  // only frames whose gpu zones all came back
+  Percentiles gpu_frame;
+  // slowest p95 first
+  std::vector<ZoneStats> zones;
+  // zones lost to full thread rings or a full query ring
+  uint64_t dropped_zones;
+};
+
+class Profiler {
+public:
+  // frames kept for stats and traces, 5 seconds at 60 fps
+  static constexpr size_t HISTORY_FRAMES = 300;
+  // zones a thread can close between two end_frame() calls
+  static constexpr size_t THREAD_CAPACITY = 8192;
+  static constexpr size_t GPU_QUERIES = 256;
+
+  class CpuZone {
+  public:
+    explicit CpuZone(const char* name);
+    ~CpuZone();
+
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+  private:
+    const char* name_;
+    int64_t start_ns_;
+  };
+
+  // GL_TIME_ELAPSED queries do not nest, a gpu zone opened inside another one is ignored
+  class GpuZone {
+  public:
+    explicit GpuZone(const char* name);
+    ~GpuZone();
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+  private:
+    bool active_;
+  };
+
+  static Profiler& instance();
+  static int64_t now_ns();
+
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  // name of the calling thread in traces
+  void set_thread_name(std::string_view name);
+  // closes the current frame, on the context thread. collects the zones of all
+  // threads and the gpu queries that became available since the last call
+  void end_frame();
+
+  ProfilerStats stats() const;
+  void log_stats() const;
+
+  // the frame history in the Chrome trace event format, for chrome://tracing or ui.perfetto.dev
+  std::string chrome_trace() const;
+  bool write_chrome_trace(const std::filesystem::path& path) const;
+
+private:
+  struct ThreadBuffer;
+
+  struct PendingQuery {
+    const char* name;
+    int64_t submit_ns;
+    uint64_t frame;
+  };
+
+  mutable std::mutex threads_mutex_{};
+  std::vector<std::unique_ptr<ThreadBuffer>> threads_{};
+  // buffers of exited threads, handed to the next new thread
+  std::vector<ThreadBuffer*> free_threads_{};
+
+  mutable std::mutex frames_mutex_{};
+  std::deque<ProfiledFrame> frames_{};
+  uint64_t frame_index_{};
+  int64_t frame_start_ns_{};
+
+  // ring of GPU_QUERIES queries, [query_tail_, query_head_) are in flight
+  std::vector<GLuint> queries_{};
+  std::vector<PendingQuery> pending_{};
+  uint64_t query_head_{};
+  uint64_t query_tail_{};
+  uint32_t frame_gpu_pending_{};
+  bool gpu_zone_open_{};
+  uint64_t dropped_gpu_zones_{};
+
+  Profiler();
+
+  ThreadBuffer& thread_buffer();
+  bool begin_gpu_zone(const char* name);
+  void end_gpu_zone();
+  // frames_mutex_ held
+  void poll_queries();
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::CpuZone PROFILE_CONCAT(profile_zone_, __LINE__){name}
+#define PROFILE_GPU_ZONE(name) Profiler::GpuZone PROFILE_CONCAT(profile_gpu_zone_, __LINE__){name}
+#define PROFILE_THREAD(name) Profiler::instance().set_thread_name(name)
+#define PROFILE_FRAME() Profiler::instance().end_frame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
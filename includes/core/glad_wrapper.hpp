@@ -1,14 +1,111 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 
 namespace glad {
+// counters of the gl calls issued through the wrappers
+struct CallStats {
+  uint64_t uniform_uploads{};
+  uint64_t buffer_uploads{};
+  uint64_t draw_calls{};
+  uint64_t binds{};
+  // binds dropped by ContextState because the object was already bound
+  uint64_t elided_binds{};
+
+  uint64_t total() const { return uniform_uploads + buffer_uploads + draw_calls + binds; }
+};
+
+CallStats& call_stats();
+void reset_call_stats();
+
+// Shadow copy of the bindings of one gl context. Binds that would not change
+// anything are dropped and counted in CallStats::elided_binds.
+// Every wrapper binds through ContextState::current(), code that calls gl
+// directly has to invalidate() afterwards.
+class ContextState {
+public:
+  void use_program(GLuint program);
+  void bind_vertex_array(GLuint vao);
+  // GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER or GL_UNIFORM_BUFFER
+  void bind_buffer(GLenum target, GLuint buffer);
+  void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+  void active_texture(GLuint unit);
+  // GL_TEXTURE_2D (or target) binding of a texture unit
+  void bind_texture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+  // bind to the unit the texture is resident on, or to the least recently used unit
+  // that is not taken by the current draw. returns the unit for the sampler uniform.
+  // a resident texture's unit is not made active, only sample the texture afterwards
+  GLuint bind_texture(GLuint texture);
+  // same for the GL_TEXTURE_BUFFER target
+  GLuint bind_buffer_texture(GLuint texture);
+  // bind_texture(texture) that always leaves the texture's unit active, for glTex*
+  // calls that change the texture
+  GLuint edit_texture(GLuint texture, GLenum target = GL_TEXTURE_2D);
+  // like bind_texture(texture), but the unit is never handed to another texture
+  // until this one is forgotten. for textures that every draw samples
+  GLuint bind_pinned_texture(GLuint texture, GLenum target = GL_TEXTURE_2D);
+  // units bound from now on belong to a new draw, the previous ones may be reused
+  void next_draw();
+  // GL_FRAMEBUFFER sets both the read and the draw binding
+  void bind_framebuffer(GLenum target, GLuint framebuffer);
+
+  // a deleted name can be handed out again, forget it so the next bind is issued
+  void forget_program(GLuint program);
+  void forget_vertex_array(GLuint vao);
+  void forget_buffer(GLuint buffer);
+  void forget_texture(GLuint texture);
+  void forget_framebuffer(GLuint framebuffer);
+
+  // forget every cached binding
+  void invalidate();
+
+  // state of the context that is current on this thread, a process wide
+  // fallback is used before any window made its state current
+  static ContextState& current();
+  static void make_current(ContextState* state);
+
+private:
+  constexpr static GLuint UNKNOWN = ~0u;
+
+  GLuint program_{UNKNOWN};
+  GLuint vao_{UNKNOWN};
+  GLuint array_buffer_{UNKNOWN};
+  // element buffer binding is part of the vao, it is reset whenever the vao changes
+  GLuint element_buffer_{UNKNOWN};
+  GLuint uniform_buffer_{UNKNOWN};
+  GLuint read_framebuffer_{UNKNOWN};
+  GLuint draw_framebuffer_{UNKNOWN};
+  GLuint active_unit_{UNKNOWN};
+  std::unordered_map<GLuint, GLuint> uniform_buffer_bases_{};
+
+  struct TextureUnit {
+    GLuint texture{UNKNOWN};
+    uint64_t last_use{};
+    bool pinned{};
+  };
+  // sized to GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS on first use
+  std::vector<TextureUnit> units_{};
+  std::unordered_map<GLuint, GLuint> texture_units_{};
+  uint64_t use_clock_{1};
+  // units used at or after this tick are pinned by the current draw
+  uint64_t draw_start_{1};
+
+  GLuint* buffer_slot(GLenum target);
+  void init_units();
+  GLuint bind_free_unit(GLuint texture, GLenum target);
+};
+
 enum class ArrtibuteType : uint8_t {
   // (x, y, z)
   Position = 3,
@@ -20,6 +117,12 @@ enum class ArrtibuteType : uint8_t {
   Bitangent = 3,
   BonesID = 4,
   Weight = 4,
+  // (x, y, z, w) packed into one GL_INT_2_10_10_10_REV word
+  PackedNormal = 4,
+  // w holds the bitangent sign
+  PackedTangent = 4,
+  // per-instance transform, occupies four consecutive vec4 locations
+  Mat4 = 16,
 };
 
 enum class DrawMode : uint8_t {
@@ -33,6 +136,14 @@ struct VertexAttribute {
   ArrtibuteType type;
   bool is_normalize{false};
   GLenum data_type{GL_FLOAT};
+  // 0 advances per vertex, n advances once every n instances
+  GLuint divisor{0};
+  // read as ivec/uvec in the shader through glVertexAttribIPointer
+  bool is_integer{false};
+
+  GLint component_count() const { return static_cast<GLint>(type); }
+  // bytes taken in the vertex
+  size_t byte_size() const;
 };
 
 class VertexBufferLayout {
@@ -52,56 +163,119 @@ private:
 template <typename T>
 class VertexBuffer {
 public:
-  VertexBuffer(std::span<T> vertices, std::shared_ptr<VertexBufferLayout> layout)
-    : layout_(std::move(layout)) {
+  VertexBuffer(std::span<const T> vertices, std::shared_ptr<VertexBufferLayout> layout,
+               GLenum usage = GL_STATIC_DRAW)
+    : usage_(usage), count_(vertices.size()), capacity_(vertices.size()), layout_(std::move(layout)) {
+    glGenBuffers(1, &ID);
+    ContextState::current().bind_buffer(GL_ARRAY_BUFFER, ID);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(T), vertices.data(), usage_);
+
+    calculate_stride();
+  }
+
+  // uninitialised storage for capacity vertices, filled with write()
+  VertexBuffer(size_t capacity, std::shared_ptr<VertexBufferLayout> layout,
+               GLenum usage = GL_STATIC_DRAW)
+    : usage_(usage), count_(capacity), capacity_(capacity), layout_(std::move(layout)) {
     glGenBuffers(1, &ID);
-    glBindBuffer(GL_ARRAY_BUFFER, ID);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(T), vertices.data(), GL_STATIC_DRAW);
+    ContextState::current().bind_buffer(GL_ARRAY_BUFFER, ID);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(T), nullptr, usage_);
 
     calculate_stride();
   }
 
   ~VertexBuffer() {
+    ContextState::current().forget_buffer(ID);
     glDeleteBuffers(1, &ID);
   }
 
   void bind() {
-    glBindBuffer(GL_ARRAY_BUFFER, ID);
+    ContextState::current().bind_buffer(GL_ARRAY_BUFFER, ID);
   }
 
   void unbind() {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ContextState::current().bind_buffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // replace the contents, the buffer only grows when the data does not fit
+  void update(std::span<const T> data) {
+    ContextState::current().bind_buffer(GL_ARRAY_BUFFER, ID);
+    if (data.size() > capacity_) {
+      glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), usage_);
+      capacity_ = data.size();
+    } else {
+      // orphan the old storage so the driver does not stall on in-flight draws
+      glBufferData(GL_ARRAY_BUFFER, capacity_ * sizeof(T), nullptr, usage_);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, data.size() * sizeof(T), data.data());
+    }
+    count_ = data.size();
+    call_stats().buffer_uploads++;
+  }
+
+  // overwrite part of the buffer, does not touch the array buffer binding
+  void write(size_t first, std::span<const T> data) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(T), data.size() * sizeof(T), data.data());
+    call_stats().buffer_uploads++;
   }
 
   auto get_vbo_layout() -> std::shared_ptr<VertexBufferLayout> { return layout_; }
+  // bytes between two vertices
   size_t stride() const { return stride_; }
+  size_t count() const { return count_; }
 
 private:
   unsigned int ID{};
+  GLenum usage_{};
+  size_t count_{};
+  size_t capacity_{};
   size_t stride_{};
   std::shared_ptr<VertexBufferLayout> layout_{nullptr};
 
   void calculate_stride() {
     for (auto attribute : *layout_) {
-      stride_ += static_cast<uint8_t>(attribute.type);
+      stride_ += attribute.byte_size();
     }
   }
 };
 
+enum class IndexFormat : uint8_t {
+  U8,
+  U16,
+  U32,
+};
+
+GLenum index_type(IndexFormat format);
+size_t index_size(IndexFormat format);
+// smallest format that can address vertex_count vertices, never below min_format.
+// 8-bit indices are emulated by several drivers, so U16 is the default floor
+IndexFormat narrowest_index_format(size_t vertex_count, IndexFormat min_format = IndexFormat::U16);
+// convert 32-bit indices to the given format, every index has to fit
+std::vector<std::byte> encode_indices(std::span<const unsigned int> indices, IndexFormat format);
+
 // EBO Wrapper
 class IndexBuffer {
 public:
-  explicit IndexBuffer(std::span<unsigned int> vertices);
+  explicit IndexBuffer(std::span<const unsigned int> indices);
+  // indices already encoded in format
+  IndexBuffer(std::span<const std::byte> indices, IndexFormat format);
+  // uninitialised storage of byte_size bytes, filled with write().
+  // used as a pool, format only applies to draws of the whole buffer
+  IndexBuffer(size_t byte_size, IndexFormat format);
   ~IndexBuffer();
 
   void bind();
   void unbind();
+  // overwrite part of the buffer, does not touch the element buffer of the bound vao
+  void write(size_t byte_offset, std::span<const std::byte> indices);
 
   size_t index_num() const;
+  IndexFormat format() const;
 
 private:
   unsigned int ID{};
   size_t index_num_{};
+  IndexFormat format_{};
 };
 
 // VAO Wrapper
@@ -113,37 +287,86 @@ public:
   }
 
   ~VertexArray() {
+    ContextState::current().forget_vertex_array(ID);
     glDeleteVertexArrays(1, &ID);
   }
 
   void bind() {
-    glBindVertexArray(ID);
+    ContextState::current().bind_vertex_array(ID);
   }
 
   void unbind() {
-    glBindVertexArray(0);
+    ContextState::current().bind_vertex_array(0);
   }
 
   void set_vbo(std::shared_ptr<VertexBuffer<T>> vbo) {
     vertex_buffer_ = std::move(vbo);
-    config_attribute_pointer();
+    config_attribute_pointer(*vertex_buffer_, 0);
   }
 
-  void set_vbo(std::span<T> vertices, std::shared_ptr<VertexBufferLayout> layout) {
+  void set_vbo(std::span<const T> vertices, std::shared_ptr<VertexBufferLayout> layout) {
     vertex_buffer_ = std::make_shared<VertexBuffer<T>>(vertices, layout);
-    config_attribute_pointer();
+    config_attribute_pointer(*vertex_buffer_, 0);
   }
 
-  void set_ebo(std::shared_ptr<IndexBuffer> ebo) { index_buffer_ = std::move(ebo); }
+  // attributes of an instance buffer advance per instance (divisor 1 unless the layout says otherwise)
+  template <typename U>
+  void add_instance_vbo(std::shared_ptr<VertexBuffer<U>> vbo) {
+    config_attribute_pointer(*vbo, 1);
+    instance_buffers_.push_back(std::move(vbo));
+  }
+
+  void set_ebo(std::shared_ptr<IndexBuffer> ebo) {
+    index_buffer_ = std::move(ebo);
+    index_buffer_->bind();
+  }
 
-  void set_ebo(std::span<unsigned int> vertices) {
+  void set_ebo(std::span<const unsigned int> vertices) {
     index_buffer_ = std::make_shared<IndexBuffer>(vertices);
   }
 
   void draw_arrays(DrawMode mode, GLint first, GLsizei count) const {
     glDrawArrays(draw_mode_map.at(mode), first, count);
+    call_stats().draw_calls++;
+  }
+
+  void draw_arrays_instanced(DrawMode mode, GLint first, GLsizei count,
+                             GLsizei instance_count) const {
+    glDrawArraysInstanced(draw_mode_map.at(mode), first, count, instance_count);
+    call_stats().draw_calls++;
+  }
+
+  void draw_elements(DrawMode mode) const {
+    glDrawElements(draw_mode_map.at(mode), static_cast<GLsizei>(index_buffer_->index_num()),
+                   index_type(index_buffer_->format()), nullptr);
+    call_stats().draw_calls++;
+  }
+
+  // draw a sub range of a shared index buffer, indices are relative to base_vertex
+  void draw_elements(DrawMode mode, GLsizei count, IndexFormat format, size_t byte_offset,
+                     GLint base_vertex) const {
+    glDrawElementsBaseVertex(draw_mode_map.at(mode), count, index_type(format),
+                             reinterpret_cast<void*>(byte_offset), base_vertex);
+    call_stats().draw_calls++;
+  }
+
+  void draw_elements_instanced(DrawMode mode, GLsizei count, IndexFormat format,
+                               size_t byte_offset, GLint base_vertex,
+                               GLsizei instance_count) const {
+    glDrawElementsInstancedBaseVertex(draw_mode_map.at(mode), count, index_type(format),
+                                      reinterpret_cast<void*>(byte_offset), instance_count,
+                                      base_vertex);
+    call_stats().draw_calls++;
   }
 
+  void draw_elements_instanced(DrawMode mode, GLsizei instance_count) const {
+    glDrawElementsInstanced(draw_mode_map.at(mode),
+                            static_cast<GLsizei>(index_buffer_->index_num()),
+                            index_type(index_buffer_->format()), nullptr, instance_count);
+    call_stats().draw_calls++;
+  }
+
+  unsigned int id() const { return ID; }
   auto vbo() const -> std::shared_ptr<VertexBuffer<T>> { return vertex_buffer_; }
   auto ebo() const -> std::shared_ptr<IndexBuffer> { return index_buffer_; }
 
@@ -151,25 +374,201 @@ private:
   unsigned int ID{};
   std::shared_ptr<VertexBuffer<T>> vertex_buffer_{nullptr};
   std::shared_ptr<IndexBuffer> index_buffer_{nullptr};
+  std::vector<std::shared_ptr<void>> instance_buffers_{};
 
   inline const static std::unordered_map<DrawMode, GLenum> draw_mode_map{
     {DrawMode::Triangles, GL_TRIANGLES},
   };
 
-  void config_attribute_pointer() {
-    int offset{};
-    for (auto attribute : *vertex_buffer_->get_vbo_layout()) {
-      auto size = static_cast<uint8_t>(attribute.type);
+  template <typename U>
+  void config_attribute_pointer(VertexBuffer<U>& vbo, GLuint min_divisor) {
+    vbo.bind();
+
+    size_t offset{};
+    auto stride = static_cast<GLsizei>(vbo.stride());
+    for (auto attribute : *vbo.get_vbo_layout()) {
+      auto divisor = std::max(attribute.divisor, min_divisor);
+
+      // a matrix is fed as one vec4 column per location
+      int columns = attribute.type == ArrtibuteType::Mat4 ? 4 : 1;
+      auto column_components = attribute.component_count() / columns;
+      auto column_size = attribute.byte_size() / columns;
+      for (int column = 0; column < columns; column++) {
+        auto index = attribute.index + column;
+        auto pointer = reinterpret_cast<void*>(static_cast<uintptr_t>(offset));
+        glEnableVertexAttribArray(index);
+        if (attribute.is_integer) {
+          glVertexAttribIPointer(index, column_components, attribute.data_type, stride, pointer);
+        } else {
+          glVertexAttribPointer(index, column_components, attribute.data_type,
+                                attribute.is_normalize ? GL_TRUE : GL_FALSE, stride, pointer);
+        }
+        glVertexAttribDivisor(index, divisor);
+
+        offset += column_size;
+      }
+    }
+  }
+};
 
-      glEnableVertexAttribArray(attribute.index);
-      glVertexAttribPointer(attribute.index, size, attribute.data_type,
-                            attribute.is_normalize ? GL_TRUE : GL_FALSE,
-                            vertex_buffer_->stride() * sizeof(float),
-                            reinterpret_cast<void*>(static_cast<uintptr_t>(offset)));
+// Packs values with the std140 rules of a uniform block.
+// a C++ block type provides write_std140(Std140Writer&, const T&) writing its
+// members in declaration order
+class Std140Writer {
+public:
+  void write(float value);
+  void write(int value);
+  void write(const glm::vec2& value);
+  void write(const glm::vec3& value);
+  void write(const glm::vec4& value);
+  void write(const glm::mat4& value);
 
-      offset += size * sizeof(float);
-    }
+  // structs (and every struct array element) start and end on a 16 byte boundary
+  void begin_struct();
+  void end_struct();
+
+  void reset();
+  auto data() const -> std::span<const std::byte>;
+
+private:
+  std::vector<std::byte> buf_{};
+
+  void write_bytes(const void* data, size_t size, size_t alignment);
+  void align(size_t alignment);
+};
+
+// binding point shared by every program declaring the named uniform block
+GLuint uniform_block_binding(std::string_view block_name);
+
+// UBO Wrapper
+class UniformBuffer {
+public:
+  explicit UniformBuffer(std::string_view block_name);
+  ~UniformBuffer();
+
+  UniformBuffer(const UniformBuffer&) = delete;
+  UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+  void update(std::span<const std::byte> data);
+
+  template <typename T>
+  void update(const T& block) {
+    writer_.reset();
+    write_std140(writer_, block);
+    update(writer_.data());
+  }
+
+  GLuint binding() const;
+
+private:
+  unsigned int ID{};
+  GLuint binding_{};
+  size_t size_{};
+  Std140Writer writer_{};
+};
+
+// Buffer texture, read with texelFetch from a samplerBuffer. Holds arrays too
+// large for a uniform block, like the light lists of LightClusters
+class TextureBuffer {
+public:
+  // texel format, e.g. GL_RGBA32F or GL_R32UI
+  explicit TextureBuffer(GLenum internal_format);
+  ~TextureBuffer();
+
+  TextureBuffer(const TextureBuffer&) = delete;
+  TextureBuffer& operator=(const TextureBuffer&) = delete;
+
+  // replace the contents, the storage only grows
+  void update(std::span<const std::byte> data);
+
+  template <typename T>
+  void update(std::span<const T> data) {
+    update(std::as_bytes(data));
   }
+
+  // bind to a pinned unit, reserved for the buffer until it is destroyed so the
+  // textures of later draws can not take it. returns the unit for the sampler uniform
+  GLuint bind() const;
+  GLuint id() const { return texture_; }
+
+  // GL_MAX_TEXTURE_BUFFER_SIZE, at least 65536 texels
+  static size_t max_texels();
+
+private:
+  GLuint buffer_{};
+  GLuint texture_{};
+  GLenum internal_format_;
+  size_t capacity_{};
+};
+
+// Texture a framebuffer renders into, sampled by later passes. Color formats
+// like GL_RGBA16F, or GL_DEPTH24_STENCIL8 / GL_DEPTH_COMPONENT24 for depth
+class RenderTarget {
+public:
+  RenderTarget(int width, int height, GLenum internal_format);
+  ~RenderTarget();
+
+  RenderTarget(const RenderTarget&) = delete;
+  RenderTarget& operator=(const RenderTarget&) = delete;
+
+  // reallocates the storage, the contents are lost. no-op for the current size
+  void resize(int width, int height);
+  // bind for the current draw, returns the unit for the sampler uniform
+  GLuint bind() const;
+
+  GLuint id() const { return texture_; }
+  GLenum internal_format() const { return internal_format_; }
+  bool is_depth() const;
+  bool has_stencil() const;
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+private:
+  GLuint texture_{};
+  GLenum internal_format_;
+  int width_{};
+  int height_{};
+
+  void allocate();
+};
+
+// FBO Wrapper. Attachments are shared, e.g. two framebuffers testing against
+// the same depth target
+class Framebuffer {
+public:
+  Framebuffer();
+  ~Framebuffer();
+
+  Framebuffer(const Framebuffer&) = delete;
+  Framebuffer& operator=(const Framebuffer&) = delete;
+
+  // color attachments are drawn to in index order, fragment output location i
+  void attach_color(size_t index, std::shared_ptr<RenderTarget> target);
+  void attach_depth(std::shared_ptr<RenderTarget> target);
+  // throws std::runtime_error when the driver reports the framebuffer incomplete
+  void validate();
+
+  // resize every attachment, shared ones included
+  void resize(int width, int height);
+  // draw into the attachments with a viewport covering them
+  void bind();
+  static void bind_default(int width, int height);
+
+  // copy to the default framebuffer, depth needs the same depth format on both sides
+  void blit_to_default(GLbitfield mask, int width, int height) const;
+
+  const RenderTarget& color(size_t index) const { return *colors_.at(index); }
+  const RenderTarget& depth() const { return *depth_; }
+  int width() const;
+  int height() const;
+  GLuint id() const { return ID; }
+
+private:
+  unsigned int ID{};
+  std::vector<std::shared_ptr<RenderTarget>> colors_{};
+  std::shared_ptr<RenderTarget> depth_{};
+
+  void attach(GLenum attachment, const RenderTarget& target);
 };
 
 void enable_depth_test();
@@ -4,8 +4,20 @@
 #include <GLFW/glfw3.h>
 #include <string_view>
 #include <functional>
+#include <memory>
+
+#include "glad_wrapper.hpp"
 
 namespace glfw {
+// hidden windows still need a display. headless ones use the null platform of
+// GLFW 3.4 with an EGL surfaceless (or OSMesa) context, no display or gpu needed,
+// Mesa llvmpipe renders. both draw into offscreen_target() instead of the window
+enum class window_mode {
+  visible,
+  hidden,
+  headless,
+};
+
 class window {
 public:
   using key_callback = std::function<void(window*, int, int, int, int)>;
@@ -14,7 +26,8 @@ public:
   using resize_callback = std::function<void(window*, int, int)>;
   using update_callback = std::function<void(window*, float)>;
 
-  window(std::string_view title, int width, int height);
+  window(std::string_view title, int width, int height,
+         window_mode mode = window_mode::visible);
   ~window();
 
   window(const window&) = delete;
@@ -42,6 +55,14 @@ public:
   int height() const;
   float aspect_ratio() const;
   GLFWwindow* native_window() const;
+  // bindings cached for the context of this window
+  glad::ContextState& context_state();
+  window_mode mode() const;
+  bool offscreen() const;
+  // color and depth targets of the window size, created on the first call once gl is loaded
+  glad::Framebuffer& offscreen_target();
+  // the offscreen target of hidden and headless windows, the default framebuffer otherwise
+  void bind_render_target();
 
   // check input status
   bool is_key_pressed(int key) const;
@@ -54,6 +75,9 @@ public:
 
 private:
   GLFWwindow* m_window{};
+  glad::ContextState m_context_state{};
+  window_mode m_mode{};
+  std::unique_ptr<glad::Framebuffer> m_offscreen_target{};
 
   int m_width{};
   int m_height{};
@@ -67,7 +91,7 @@ private:
 
   static bool glfw_initialized;
 
-  static void init_glfw();
+  static void init_glfw(window_mode mode);
   static void terminate_glfw();
 
   static void key_callback_wrapper(GLFWwindow* glfw_window, int key, int scancode, int action,
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "Texture.hpp"
+
+// CPU block compression of decoded images, no gl calls.
+//
+// Endpoints come from the bounding box of a block, its diagonal flipped along
+// the channel correlations and inset slightly, indices from a search over the
+// decoded palette. BC7 only uses mode 6 (one subset, rgba endpoints, 4-bit
+// indices). Fast rather than optimal, the result is meant to be cached.
+
+// normal maps -> BC5, single channel -> BC4, alpha -> BC7, anything else -> BC1
+BlockFormat block_format(TextureType type, int nr_channels);
+
+// every level of mips, rows of blocks are spread over ThreadPool::shared()
+CompressedImage compress(const MipChain& mips, BlockFormat format);
+
+// single 4x4 blocks, texels are 16 rgba texels row by row
+void encode_bc1(std::span<const uint8_t, 64> texels, std::byte* block);
+void encode_bc3(std::span<const uint8_t, 64> texels, std::byte* block);
+void encode_bc4(std::span<const uint8_t, 64> texels, int channel, std::byte* block);
+void encode_bc5(std::span<const uint8_t, 64> texels, std::byte* block);
+void encode_bc7(std::span<const uint8_t, 64> texels, std::byte* block);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Shader.hpp"
+#include "UniformBlocks.hpp"
+#include "glad_wrapper.hpp"
+
+// Deferred shading on top of glad::Framebuffer.
+//
+// opaque geometry is drawn once into the g-buffer (shader/deferred/gbuffer.*):
+//   0: RGBA16F world position, w = 1 where covered
+//   1: RGBA16F world normal, w = shininess
+//   2: RGBA8   albedo, a = specular intensity
+// the lights are then added into a light buffer sharing the g-buffer depth. the
+// directional light of the Lights block is a fullscreen pass, point and spot lights
+// are instanced sphere and cone volumes that only shade pixels whose geometry lies
+// in front of the volume's back faces.
+struct DeferredArgs {
+  std::string shader_directory = "../../shader/deferred";
+  glm::vec3 clear_color{0.1f};
+  // point and spot volumes end where a light falls below this fraction of its brightest channel
+  float light_cutoff = 5.0f / 256.0f;
+};
+
+class DeferredRenderer {
+public:
+  struct Stats {
+    size_t point_lights;
+    size_t spot_lights;
+  };
+
+  DeferredRenderer(int width, int height, DeferredArgs args = {});
+  ~DeferredRenderer();
+
+  DeferredRenderer(const DeferredRenderer&) = delete;
+  DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+  // no-op for the current size
+  void resize(int width, int height);
+  // bind and clear the g-buffer, opaque geometry is drawn with a g-buffer shader next
+  void begin_geometry();
+  // accumulate every light into the light buffer, reads the Camera and Lights blocks
+  void light(std::span<const PointLight> point_lights, std::span<const SpotLight> spot_lights);
+  // copy the lit image and the depth to the default framebuffer, forward passes can follow
+  void present(int width, int height);
+
+  glad::Framebuffer& gbuffer() { return gbuffer_; }
+  glad::Framebuffer& light_buffer() { return light_buffer_; }
+  const Stats& stats() const { return stats_; }
+
+  // distance at which the attenuation of a light with the given peak brightness
+  // drops to cutoff
+  static float light_radius(float constant, float linear, float quadratic, float brightness,
+                            float cutoff);
+
+private:
+  struct Volume;
+
+  DeferredArgs args_;
+  glad::Framebuffer gbuffer_{};
+  glad::Framebuffer light_buffer_{};
+  std::unique_ptr<Shader> directional_shader_;
+  std::unique_ptr<Shader> point_shader_;
+  std::unique_ptr<Shader> spot_shader_;
+  std::unique_ptr<Volume> sphere_;
+  std::unique_ptr<Volume> cone_;
+  // the fullscreen triangle has no attributes, core profile still wants a vao
+  glad::VertexArray<float> empty_vao_{};
+  glad::TextureBuffer point_data_{GL_RGBA32F};
+  glad::TextureBuffer spot_data_{GL_RGBA32F};
+  std::vector<glm::vec4> texels_{};
+  Stats stats_{};
+
+  void bind_gbuffer(const Shader& shader) const;
+  void draw_point_lights(std::span<const PointLight> lights);
+  void draw_spot_lights(std::span<const SpotLight> lights);
+};
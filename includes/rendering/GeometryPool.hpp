@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "glad_wrapper.hpp"
+#include "utils/RangeAllocator.hpp"
+
+struct GeometryPoolArgs {
+  // capacity of a regular page, a larger mesh gets a page of its own
+  size_t page_vertex_count = 1 << 18;
+  size_t page_index_bytes = 1 << 22;
+};
+
+struct GeometryPoolStats {
+  size_t page_count;
+  size_t vertex_capacity;
+  size_t vertex_used;
+  // index storage is shared by every index format, counted in bytes
+  size_t index_capacity;
+  size_t index_used;
+  size_t free_blocks;
+  // worst page, see RangeAllocator::fragmentation
+  float vertex_fragmentation;
+  float index_fragmentation;
+};
+
+// Large vertex/index buffer pairs shared by many meshes of one vertex format.
+// Each page owns one vao, meshes on the same page are drawn without a vao switch
+// through glDrawElementsBaseVertex. Vertices are stored as raw bytes, the layout
+// decides the format.
+class GeometryPool : public std::enable_shared_from_this<GeometryPool> {
+public:
+  using VertexArray = glad::VertexArray<std::byte>;
+
+  // location of a mesh inside the pool
+  struct Range {
+    uint32_t page;
+    uint32_t base_vertex;
+    uint32_t vertex_count;
+    // bytes into the page index buffer
+    uint32_t index_offset;
+    uint32_t index_count;
+    glad::IndexFormat index_format;
+  };
+
+  // returns its range to the pool when destroyed, keeps the pool alive
+  class Allocation {
+  public:
+    Allocation() = default;
+    Allocation(std::shared_ptr<GeometryPool> pool, Range range);
+    ~Allocation();
+
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+
+    const Range& range() const { return range_; }
+    GeometryPool& pool() const { return *pool_; }
+
+  private:
+    std::shared_ptr<GeometryPool> pool_{};
+    Range range_{};
+
+    void release();
+  };
+
+  GeometryPool(std::shared_ptr<glad::VertexBufferLayout> layout, size_t vertex_size,
+               GeometryPoolArgs args = {});
+
+  GeometryPool(const GeometryPool&) = delete;
+  GeometryPool& operator=(const GeometryPool&) = delete;
+
+  // copy the mesh into the first page with room for it, indices are stored in index_format.
+  // vertices.size() has to be a multiple of vertex_size()
+  auto allocate(std::span<const std::byte> vertices, std::span<const unsigned int> indices,
+                glad::IndexFormat index_format) -> Allocation;
+
+  // the vao every mesh of the page is drawn with
+  auto vertex_array(uint32_t page) -> VertexArray&;
+
+  // a separate vao over the buffers of a page, for per-instance attributes that
+  // must not leak into the shared vao
+  auto make_vertex_array(uint32_t page) -> std::unique_ptr<VertexArray>;
+
+  size_t vertex_size() const { return vertex_size_; }
+  GeometryPoolStats stats() const;
+
+private:
+  // index ranges are handed out in words so every format stays aligned
+  constexpr static size_t INDEX_GRANULARITY = 4;
+
+  struct Page {
+    std::unique_ptr<VertexArray> vao;
+    RangeAllocator vertices;
+    // in INDEX_GRANULARITY units
+    RangeAllocator indices;
+  };
+
+  std::shared_ptr<glad::VertexBufferLayout> layout_{};
+  size_t vertex_size_{};
+  GeometryPoolArgs args_{};
+  // released pages leave a hole so page indices stay stable
+  std::vector<std::unique_ptr<Page>> pages_{};
+
+  bool try_place(uint32_t page_index, Range& range);
+  static size_t index_words(const Range& range);
+  uint32_t add_page(size_t vertex_count, size_t index_bytes);
+  void free(const Range& range);
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Shader.hpp"
+#include "glad_wrapper.hpp"
+
+// Clustered forward lighting.
+//
+// the view frustum is cut into tiles_x * tiles_y screen tiles and slices spaced
+// exponentially in depth. bin() assigns every light to the clusters its sphere
+// touches on the cpu, the fragment shader (CLUSTERED, shader/include/clusters.glsl)
+// then only loops over the lights of its own cluster.
+
+// two RGBA32F texels on the gpu, keep the layout
+struct ClusterLight {
+  glm::vec3 position;
+  // the light has no effect past this distance
+  float radius;
+  glm::vec3 color;
+  float intensity;
+};
+
+struct ClusterArgs {
+  uint32_t tiles_x = 16;
+  uint32_t tiles_y = 9;
+  uint32_t slices = 24;
+  // lights past this count are dropped from a cluster, in light order
+  uint32_t max_lights_per_cluster = 256;
+  // sphere tests 4 lights at a time with sse when available
+  bool simd = true;
+  // bin the depth slices on ThreadPool::shared()
+  bool parallel = true;
+};
+
+class LightClusters {
+public:
+  struct Stats {
+    size_t lights;
+    // light indices written over all clusters
+    size_t references;
+    uint32_t max_cluster_lights;
+    // clusters that hit max_lights_per_cluster
+    size_t overflowed_clusters;
+    double bin_ms;
+  };
+
+  explicit LightClusters(const ClusterArgs& args = {});
+  ~LightClusters();
+
+  LightClusters(const LightClusters&) = delete;
+  LightClusters& operator=(const LightClusters&) = delete;
+
+  // perspective projection of the camera, fov_y in radians, viewport in pixels.
+  // the cluster bounds are only rebuilt when something changed
+  void set_projection(float fov_y, float near, float far, const glm::vec2& viewport);
+  // world space lights, no gl calls
+  void bin(std::span<const ClusterLight> lights, const glm::mat4& view);
+  // light list, cluster ranges and light indices into texture buffers
+  void upload();
+  // bind the buffers and set the cluster uniforms of a program built with CLUSTERED
+  void bind(const Shader& shader) const;
+
+  uint32_t cluster_count() const { return args_.tiles_x * args_.tiles_y * args_.slices; }
+  uint32_t cluster_index(uint32_t x, uint32_t y, uint32_t slice) const {
+    return (slice * args_.tiles_y + y) * args_.tiles_x + x;
+  }
+  // view space bounds with z as the positive distance in front of the camera
+  const Aabb& cluster_bounds(uint32_t cluster) const { return bounds_[cluster]; }
+  // offset into light_indices() and light count of every cluster
+  auto cluster_ranges() const -> std::span<const glm::uvec2> { return ranges_; }
+  auto light_indices() const -> std::span<const uint32_t> { return indices_; }
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Slice;
+
+  ClusterArgs args_;
+  float fov_y_{};
+  float near_{};
+  float far_{};
+  glm::vec2 viewport_{};
+  // tile bounds of every cluster and the union of every tile row of a slice
+  std::vector<Aabb> bounds_{};
+  std::vector<Aabb> row_bounds_{};
+
+  std::vector<ClusterLight> lights_{};
+  // view space centers, z is the distance in front of the camera
+  std::vector<glm::vec4> view_lights_{};
+  std::vector<Slice> slices_;
+  std::vector<glm::uvec2> ranges_{};
+  std::vector<uint32_t> indices_{};
+  Stats stats_{};
+
+  // created on the first upload, binning works without a context
+  struct Buffers;
+  std::unique_ptr<Buffers> buffers_;
+
+  float slice_depth(uint32_t slice) const;
+  void build_bounds();
+  void bin_slice(uint32_t slice);
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "Camera.hpp"
+
+// one level of detail of a mesh, a range of the mesh's own index list.
+// lod 0 is the full mesh, error grows with every level
+struct MeshLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  // geometric deviation from lod 0 in object space units
+  float error;
+};
+
+struct LodSettings {
+  float viewport_height = 600.0f;
+  // vertical field of view in radians
+  float fov_y = glm::radians(Camera::ZOOM);
+  // coarsest lod whose error projects to at most this many pixels
+  float max_pixel_error = 1.0f;
+  // a coarser lod has to fit into (1 - hysteresis) * max_pixel_error before it
+  // replaces the current one, so meshes near a threshold do not flicker
+  float hysteresis = 0.25f;
+  bool enabled = true;
+
+  static LodSettings from_camera(const Camera& camera, float viewport_height);
+};
+
+// size in pixels of an object space error seen at distance
+float projected_error(float error, float distance, const LodSettings& settings);
+
+// next lod of a mesh that currently draws current, error_scale maps object space
+// errors into the space distance was measured in
+uint32_t select_lod(std::span<const MeshLod> lods, uint32_t current, float distance,
+                    float error_scale, const LodSettings& settings);
@@ -3,14 +3,26 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
 #include <vector>
 #include <memory>
 
 #include "Shader.hpp"
 #include "glad_wrapper.hpp"
 #include "Texture.hpp"
+#include "GeometryPool.hpp"
+#include "Bounds.hpp"
+#include "Lod.hpp"
+
+struct DrawPacket;
 
 constexpr int MAX_BONE_INFLUENCE = 4;
+// first of the four locations taken by the per-instance model matrix
+constexpr GLuint INSTANCE_MODEL_LOCATION = 7;
 
 struct Vertex {
   glm::vec3 Position;
@@ -22,18 +34,128 @@ struct Vertex {
   float w_Weights[MAX_BONE_INFLUENCE];
 };
 
-class Mesh {
-public:
+// compressed Vertex, same attribute locations so the shaders do not change.
+// normal/tangent are snorm 2_10_10_10. the bitangent is not stored, tangent.w
+// only keeps the handedness sign of the tangent frame
+struct PackedVertex {
+  glm::vec3 Position;
+  uint32_t Normal;
+  // two half floats
+  uint32_t TexCoords;
+  uint32_t Tangent;
+  uint8_t m_BoneIDs[MAX_BONE_INFLUENCE];
+  // unorm8, normalised to sum up to 1
+  uint8_t w_Weights[MAX_BONE_INFLUENCE];
+};
+static_assert(sizeof(PackedVertex) == 32);
+
+enum class VertexFormat : uint8_t {
+  // Vertex
+  Full,
+  // PackedVertex
+  Packed,
+};
+
+PackedVertex pack_vertex(const Vertex& vertex);
+std::vector<PackedVertex> pack_vertices(std::span<const Vertex> vertices);
+
+// material texture referenced by a mesh, path is relative to the model directory
+struct TextureRef {
+  TextureType type;
+  // 1-based index within the texture type, e.g. texture_diffuse{slot}
+  uint32_t slot;
+  std::string path;
+};
+
+// cpu side mesh produced by the importer
+struct MeshData {
   std::vector<Vertex> vertices{};
   std::vector<unsigned int> indices{};
+  std::vector<TextureRef> textures{};
+  // scene node the mesh is attached to
+  uint32_t node{};
+  // ranges of indices, empty means a single level covering every index
+  std::vector<MeshLod> lods{};
+};
+
+// non-owning view of a mesh, backed by MeshData or a mapped cache file
+struct MeshView {
+  std::span<const Vertex> vertices{};
+  std::span<const unsigned int> indices{};
+  std::vector<TextureRef> textures{};
+  uint32_t node{};
+  std::span<const MeshLod> lods{};
+};
+
+// aiNode without its meshes, parents come before their children
+struct NodeData {
+  uint32_t parent;
+  glm::mat4 local;
+};
+
+struct ModelData {
+  std::vector<NodeData> nodes{};
+  std::vector<MeshData> meshes{};
+  // every file the importer read, the model itself first, then .mtl and the like
+  std::vector<std::string> source_files{};
+};
+
+// object space bounds, the sphere is centered on the box and encloses every vertex
+struct MeshBounds {
+  Aabb aabb{};
+  BoundingSphere sphere{};
+};
+
+MeshBounds compute_bounds(std::span<const Vertex> vertices);
+
+// split a triangle list into parts of at most max_vertices vertices each,
+// so every part can use narrower indices. only lod 0 is kept
+std::vector<MeshData> split_mesh(const MeshView& mesh, size_t max_vertices);
+
+// texture bound by a mesh, the sampler name belongs to the mesh because the
+// same texture can be shared between meshes and models
+struct MeshTexture {
+  std::shared_ptr<Texture> texture;
+  std::string uniform_name;
+};
+
+class Mesh {
+public:
   // avoid generate the same texture id
-  std::vector<std::shared_ptr<Texture>> textures{};
+  std::vector<MeshTexture> textures{};
+
+  // vertices and indices are copied into the pool, vertices are in the pool's format
+  // and indices are narrowed to index_format. every lod shares the same allocation
+  Mesh(GeometryPool& pool, std::span<const std::byte> vertices,
+       std::span<const unsigned int> indices, glad::IndexFormat index_format,
+       const MeshBounds& bounds, std::span<const MeshLod> lods,
+       std::vector<MeshTexture> textures);
+  void draw(const Shader& shader, uint32_t lod = 0);
+  // draw instance_count copies with a vao of the same pool page that has the
+  // per-instance attributes attached, see GeometryPool::make_vertex_array
+  void draw_instanced(const Shader& shader, GeometryPool::VertexArray& vao,
+                      GLsizei instance_count, uint32_t lod = 0);
+
+  // program, textures and vao of this mesh for the RenderQueue, the caller fills in
+  // transform, depth and layer
+  auto packet(Shader& shader, uint32_t lod = 0) const -> DrawPacket;
+
+  // indices of every lod
+  size_t index_count() const { return geometry_.range().index_count; }
+  const std::vector<MeshLod>& lods() const { return lods_; }
+  glad::IndexFormat index_format() const { return geometry_.range().index_format; }
+  uint32_t geometry_page() const { return geometry_.range().page; }
+  const MeshBounds& bounds() const { return bounds_; }
 
-  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-       std::vector<std::shared_ptr<Texture>> textures);
-  void draw(const Shader& shader);
+  // one pool per vertex format, alive as long as a mesh or a caller holds it
+  static auto geometry_pool(VertexFormat format) -> std::shared_ptr<GeometryPool>;
+  static auto vertex_layout(VertexFormat format) -> std::shared_ptr<glad::VertexBufferLayout>;
 
 private:
-  std::unique_ptr<glad::VertexArray<Vertex>> vao_{};
-  void setup_mesh();
+  GeometryPool::Allocation geometry_{};
+  MeshBounds bounds_{};
+  std::vector<MeshLod> lods_{};
+  void bind_textures(const Shader& shader);
+  // byte offset of the lod in the shared index buffer
+  size_t index_offset(const MeshLod& lod) const;
 };
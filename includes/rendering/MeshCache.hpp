@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "Mesh.hpp"
+#include "utils/MappedFile.hpp"
+
+// Versioned binary cache of an imported model, stored next to the source file.
+//
+// layout: CacheHeader | MeshRecord[mesh_count] | NodeRecord[node_count] | source paths |
+//         per mesh: texture refs | MeshLod[] | vertex array | index array
+// vertex and index arrays are 16 byte aligned so they can be uploaded straight
+// from the mapping. the header hash covers the import options and the contents of
+// every file the importer read, their paths are stored so open() can rehash them.
+class MeshCache {
+public:
+  constexpr static uint32_t VERSION = 5;
+
+  static std::string cache_path(std::string_view source_path);
+  // contents of every file, a missing file hashes differently from any contents
+  static uint64_t source_hash(std::span<const std::string> source_files);
+
+  // keyed on model.source_files and options_hash
+  static void write(std::string_view cache_path, uint64_t options_hash, const ModelData& model);
+  // returns std::nullopt when the cache is missing, stale or was written by another version
+  static auto open(std::string_view cache_path, uint64_t options_hash) -> std::optional<MeshCache>;
+
+  size_t mesh_count() const;
+  auto mesh(size_t index) const -> MeshView;
+  auto nodes() const -> std::vector<NodeData>;
+
+private:
+  struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t vertex_size;
+    uint32_t mesh_count;
+    uint32_t node_count;
+    uint32_t source_count;
+  };
+
+  struct MeshRecord {
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint64_t texture_offset;
+    uint64_t lod_offset;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t texture_count;
+    uint32_t node;
+    uint32_t lod_count;
+    uint32_t padding;
+  };
+
+  struct NodeRecord {
+    uint32_t parent;
+    float local[16];
+  };
+
+  constexpr static char MAGIC[4] = {'O', 'G', 'L', 'M'};
+
+  MappedFile file_{};
+  uint32_t mesh_count_{};
+  uint32_t node_count_{};
+
+  explicit MeshCache(MappedFile file, uint32_t mesh_count, uint32_t node_count);
+  size_t node_offset() const;
+  auto record(size_t index) const -> MeshRecord;
+};
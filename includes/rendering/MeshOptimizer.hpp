@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Import time reordering of MeshData for the gpu, no gl calls.
+//
+// weld -> vertex cache (Tipsify) -> overdraw (cluster sort) -> vertex fetch.
+// every step keeps the triangle list valid on its own, so stages can be skipped.
+
+struct MeshOptimizeArgs {
+  // merge bitwise identical vertices
+  bool weld = true;
+  bool vertex_cache = true;
+  bool overdraw = true;
+  // clusters may cost up to this factor of the cache optimized ACMR
+  float overdraw_threshold = 1.05f;
+  // reorder vertices by first use
+  bool vertex_fetch = true;
+  // post-transform cache size the orderings are tuned for
+  uint32_t cache_size = 16;
+};
+
+struct VertexCacheStats {
+  // average cache miss ratio, transformed vertices per triangle (0.5 is ideal on large meshes)
+  float acmr;
+  // average transformed to vertex ratio, transformed vertices per referenced vertex (1 is ideal)
+  float atvr;
+};
+
+// simulate a FIFO post-transform cache over a triangle list
+VertexCacheStats analyze_vertex_cache(std::span<const unsigned int> indices, size_t vertex_count,
+                                      uint32_t cache_size = 16);
+
+// returns the number of vertices removed
+size_t weld_vertices(MeshData& mesh);
+void optimize_vertex_cache(std::span<unsigned int> indices, size_t vertex_count,
+                           uint32_t cache_size = 16);
+// expects indices already ordered by optimize_vertex_cache
+void optimize_overdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices,
+                       float threshold = 1.05f, uint32_t cache_size = 16);
+// drops unreferenced vertices
+void optimize_vertex_fetch(MeshData& mesh);
+
+void optimize_mesh(MeshData& mesh, const MeshOptimizeArgs& args = {});
+// meshes are independent, they are spread over ThreadPool::shared()
+void optimize_meshes(std::span<MeshData> meshes, const MeshOptimizeArgs& args = {});
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Quadric error edge collapse on the index list only, every lod keeps
+// referencing the vertices of lod 0.
+//
+// vertices sharing a position with different attributes (uv/normal seams) and
+// non-manifold vertices never move, open borders only collapse along themselves.
+
+struct LodArgs {
+  // including lod 0
+  uint32_t max_lods = 4;
+  // index count of every level relative to the previous one
+  float reduction = 0.5f;
+  // stop once a level keeps more than this share of the previous level's indices
+  float min_reduction = 0.85f;
+  // largest error of a single level relative to the mesh's bounding box diagonal
+  float max_error = 0.02f;
+};
+
+// returns at most target_index_count indices unless max_error is reached first,
+// error receives the largest collapse error in object space units
+std::vector<unsigned int> simplify(std::span<const Vertex> vertices,
+                                   std::span<const unsigned int> indices,
+                                   size_t target_index_count, float max_error,
+                                   float* error = nullptr);
+
+// appends the lod chain to mesh.indices and fills mesh.lods
+void generate_lods(MeshData& mesh, const LodArgs& args = {});
+// meshes are independent, they are spread over ThreadPool::shared()
+void generate_lods(std::span<MeshData> meshes, const LodArgs& args = {});
@@ -7,29 +7,185 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "Shader.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "RenderQueue.hpp"
+#include "FrustumCuller.hpp"
+#include "SceneGraph.hpp"
+
+struct ModelArgs {
+  std::string load_path;
+  bool gamma_correction = false;
+  // read/write <load_path>.meshcache instead of parsing with assimp every launch
+  bool use_mesh_cache = true;
+  // decode every unique texture on worker threads before the gl upload
+  bool parallel_texture_decode = true;
+  // weld and reorder imported meshes for the vertex cache, overdraw and vertex fetch
+  bool optimize_meshes = true;
+  // build a chain of simplified index lists per mesh, see select_lods
+  bool generate_lods = true;
+  // upload only the mip tails and let TextureStreamer bring finer levels in,
+  // see request_texture_sizes
+  bool stream_textures = false;
+  // transcode decoded images to BCn once, cached next to the source as <image>.bcn.dds.
+  // dds and ktx2 files are always uploaded compressed, neither kind streams
+  bool compress_textures = false;
+  // upload PackedVertex (32 bytes) instead of Vertex (88 bytes)
+  VertexFormat vertex_format = VertexFormat::Full;
+  // meshes pick the narrowest index type that fits, when false meshes with more
+  // than 65536 vertices are split instead of falling back to 32-bit indices
+  bool allow_32bit_indices = true;
+};
+
+class ModelLoader;
 
 class Model {
 public:
   explicit Model(std::string_view path, bool gamma = false);
+  explicit Model(ModelArgs args);
+
+  // sets the "model" uniform to transform * node world matrix for every mesh
+  void draw(const Shader& shader, const glm::mat4& transform = glm::mat4{1.0f});
+  // only meshes whose bounds touch the frustum
+  void draw(const Shader& shader, const Frustum& frustum, const glm::mat4& transform);
+  // one draw call per mesh for every transform, the shader reads the model
+  // matrix from the instance attribute at INSTANCE_MODEL_LOCATION
+  void draw_instanced(const Shader& shader, std::span<const glm::mat4> transforms);
+  // record one packet per mesh, depth is the view space distance used for ordering
+  void enqueue(RenderQueue& queue, Shader& shader, const glm::mat4& transform, float depth,
+               RenderLayer layer = RenderLayer::Opaque) const;
+  void enqueue(RenderQueue& queue, Shader& shader, const glm::mat4& transform, float depth,
+               const Frustum& frustum, RenderLayer layer = RenderLayer::Opaque) const;
+
+  // indices of the meshes visible in a world space frustum, valid until the next call
+  auto cull(const Frustum& frustum, const glm::mat4& transform) const -> std::span<const uint32_t>;
+  // pick the lod of every mesh from its projected error as seen from camera_position,
+  // the choice is kept for the following draw/enqueue calls
+  void select_lods(const LodSettings& settings, const glm::vec3& camera_position,
+                   const glm::mat4& transform);
+  // triangles of every mesh at the selected lods
+  size_t triangle_count() const;
+  // tell streaming textures how large their meshes are on screen this frame,
+  // assuming a texture covers its mesh once
+  void request_texture_sizes(const LodSettings& settings, const glm::vec3& camera_position,
+                             const glm::mat4& transform) const;
+
+  // texture_defines of all meshes merged, for a ShaderVariants shared by the whole model
+  ShaderDefines texture_defines() const;
+
+  // model space bounds of every mesh
+  const Aabb& bounds() const { return bounds_; }
+
+  // node hierarchy of the source file, mesh transforms and bounds follow
+  // edits made here after the next update_scene()
+  SceneGraph& scene() { return scene_; }
+  const SceneGraph& scene() const { return scene_; }
+  void update_scene();
 
-  void draw(const Shader& shader);
+  // parse the source file with assimp, no gl calls
+  static auto import_model(std::string_view path) -> std::optional<ModelData>;
 
 private:
-  std::vector<std::shared_ptr<Texture>> textures_loaded_;
+  friend class ModelLoader;
+
+  constexpr static size_t MAX_16BIT_VERTICES = 65536;
+
+  struct PendingTexture {
+    TextureRef ref;
+    std::string load_path;
+    std::string canonical_path;
+    uint64_t content_hash;
+    // registry variant of the load settings, see TextureRegistry
+    uint64_t variant;
+    // set when the registry already holds the texture, nothing to upload
+    std::shared_ptr<Texture> texture;
+    // an earlier texture of the batch with the same contents, only that one is decoded and uploaded
+    std::optional<size_t> duplicate_of;
+    ImageData image;
+    // instead of image when streaming
+    MipChain mips;
+    // dds/ktx2 sources and BCn transcoded images
+    std::optional<CompressedImage> compressed;
+  };
+
+  // everything prepare() produces off the context thread, upload_next() turns it
+  // into gl objects one texture or mesh at a time
+  struct Source {
+    // meshes point into either the cache mapping or the imported data
+    std::optional<MeshCache> cache{};
+    std::optional<ModelData> data{};
+    // split meshes, a deque so views into them stay valid
+    std::deque<MeshData> parts{};
+    std::vector<MeshView> meshes{};
+    std::vector<NodeData> nodes{};
+    std::vector<MeshBounds> bounds{};
+    // per mesh, empty unless the vertex format is packed
+    std::vector<std::vector<PackedVertex>> packed{};
+    std::vector<PendingTexture> textures{};
+    size_t next_texture{};
+    size_t next_mesh{};
+    size_t uploaded_textures{};
+  };
+
+  struct Deferred {};
+
+  // texture handles by material path, the textures themselves live in TextureRegistry
+  std::unordered_map<std::string, std::shared_ptr<Texture>> textures_loaded_;
+  VertexFormat vertex_format_{};
+  bool stream_textures_{};
+  std::shared_ptr<GeometryPool> geometry_pool_{};
   std::vector<Mesh> meshes_;
-  std::string_view directory;
+  SceneGraph scene_{};
+  // scene node and selected lod of every mesh
+  std::vector<uint32_t> mesh_nodes_{};
+  std::vector<uint32_t> mesh_lods_{};
+  Aabb bounds_{};
+  // model space mesh spheres, the frustum is moved into model space instead
+  FrustumCuller culler_{};
+  mutable std::vector<uint32_t> visible_{};
+  // shared by every mesh, created on the first instanced draw
+  std::shared_ptr<glad::VertexBuffer<glm::mat4>> instance_buffer_{};
+  std::vector<glm::mat4> instance_transforms_{};
+  // per pool page, the shared page vao must not carry this model's instance attributes
+  std::unordered_map<uint32_t, std::unique_ptr<GeometryPool::VertexArray>> instanced_vaos_{};
+  std::string directory_;
   bool gamma_correction{};
 
-  void load_model(std::string_view path);
-  void process_node(aiNode* node, const aiScene* scene);
-  Mesh process_mesh(aiMesh* mesh, const aiScene* scene);
-  auto load_material_textures(aiMaterial* mat, aiTextureType type) -> std::vector<std::shared_ptr<Texture>>;
+  // members only, the gl upload is driven by load_model or ModelLoader
+  Model(const ModelArgs& args, Deferred);
+
+  void load_model(const ModelArgs& args);
+  void begin_upload(const Source& source);
+  // upload one texture or mesh, returns false once nothing is left
+  bool upload_next(Source& source);
+  void finish_upload(const Source& source);
+  void add_mesh(const MeshView& mesh, const MeshBounds& bounds,
+                std::span<const PackedVertex> packed);
+  auto texture_args(const TextureRef& ref) const -> TextureArgs;
+
+  // cache lookup or import, mesh processing and texture decode, no gl calls
+  static auto prepare(const ModelArgs& args) -> std::optional<Source>;
+  static void prepare_meshes(Source& source, const ModelArgs& args);
+  static void prepare_textures(Source& source, std::string_view directory, const ModelArgs& args);
+  static std::string_view directory(std::string_view path);
+
+  static void process_node(aiNode* node, const aiScene* scene, uint32_t parent, ModelData& model);
+  static MeshData process_mesh(aiMesh* mesh, const aiScene* scene);
+  static void load_material_textures(aiMaterial* mat, aiTextureType type,
+                                     std::vector<TextureRef>& textures);
 
-  static std::string_view uniform_name_prefix(aiTextureType type);
+  static std::string_view uniform_name_prefix(TextureType type);
   static TextureType texture_type(aiTextureType type);
 };
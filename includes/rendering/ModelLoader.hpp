@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Model.hpp"
+
+// Model loading in the background.
+//
+// Cache lookup, assimp import, mesh processing and texture decode run on
+// ThreadPool::shared(). The gl uploads stay on the context thread and are
+// drip-fed by update() within a per-frame time budget, one texture or mesh at a
+// time, so the render loop keeps its frame time while assets stream in.
+class AsyncModel {
+public:
+  enum class State : uint8_t {
+    // parsing and decoding on the workers
+    Loading,
+    // gl uploads spread over ModelLoader::update calls
+    Uploading,
+    Ready,
+    Failed,
+  };
+
+  State state() const { return state_; }
+  bool ready() const { return state_ == State::Ready; }
+  bool failed() const { return state_ == State::Failed; }
+  std::string_view path() const { return path_; }
+
+  // only valid once ready
+  Model& get() { return *model_; }
+  const Model& get() const { return *model_; }
+
+private:
+  friend class ModelLoader;
+
+  State state_{State::Loading};
+  std::string path_;
+  std::unique_ptr<Model> model_{};
+};
+
+class ModelLoader {
+public:
+  ModelLoader() = default;
+  // waits for the loads still running on the workers
+  ~ModelLoader();
+  ModelLoader(const ModelLoader&) = delete;
+  ModelLoader& operator=(const ModelLoader&) = delete;
+
+  // returns immediately, draw a placeholder until the handle is ready
+  auto load(ModelArgs args) -> std::shared_ptr<AsyncModel>;
+
+  // upload pending textures and meshes until budget is spent, at least one per
+  // call so loading always progresses. call once per frame on the context thread
+  void update(std::chrono::microseconds budget = DEFAULT_BUDGET);
+
+  // models not ready yet, including dropped ones whose prepare still runs
+  size_t pending() const { return loads_.size(); }
+
+  constexpr static std::chrono::microseconds DEFAULT_BUDGET{2000};
+
+private:
+  struct Load {
+    std::shared_ptr<AsyncModel> handle;
+    ModelArgs args;
+    std::future<std::optional<Model::Source>> future;
+    std::optional<Model::Source> source{};
+    std::chrono::steady_clock::time_point start;
+    // frames the upload was spread over and the longest single update slice
+    size_t upload_frames{};
+    std::chrono::steady_clock::duration max_slice{};
+  };
+
+  std::vector<Load> loads_{};
+
+  // false once the load left the queue
+  bool poll(Load& load);
+  // finishes a load nobody waits for, on the context thread
+  void drop(Load& load);
+  bool upload(Load& load, std::chrono::steady_clock::time_point deadline);
+};
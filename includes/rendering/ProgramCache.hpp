@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+//
+// A program is keyed by its stage sources and the vendor, renderer and version
+// strings of the driver, so a driver update never sees binaries of another one.
+// Binaries the driver rejects anyway are deleted and the caller compiles from
+// source. Context thread only.
+class ProgramCache {
+public:
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    // binaries found on disk that the driver refused
+    uint64_t rejected;
+    uint64_t stores;
+  };
+
+  static ProgramCache& instance();
+
+  // "shader_cache" next to the working directory by default
+  void set_directory(std::filesystem::path directory);
+  const std::filesystem::path& directory() const { return directory_; }
+  // off, or no binary formats offered by the driver, turns load/store into no-ops
+  void set_enabled(bool enabled);
+  bool enabled() const;
+
+  uint64_t key(std::string_view vertex_source, std::string_view fragment_source);
+  // a linked program restored from the cache, 0 on a miss
+  GLuint load(uint64_t key);
+  // ask the driver to keep the binary retrievable, call before glLinkProgram
+  void prepare(GLuint program);
+  void store(uint64_t key, GLuint program);
+
+  // remove every cached binary, the directory itself stays
+  void clear();
+  Stats stats() const { return stats_; }
+  void reset_stats() { stats_ = {}; }
+
+private:
+  struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binary_format;
+    uint32_t binary_length;
+  };
+
+  constexpr static char MAGIC[4] = {'O', 'G', 'L', 'P'};
+  constexpr static uint32_t VERSION = 1;
+
+  std::filesystem::path directory_{"shader_cache"};
+  bool enabled_{true};
+  // -1 until the context was asked
+  int binary_formats_{-1};
+  uint64_t driver_hash_{};
+  Stats stats_{};
+
+  ProgramCache() = default;
+
+  bool supported();
+  std::filesystem::path file_path(uint64_t key) const;
+};
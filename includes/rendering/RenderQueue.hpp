@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "Shader.hpp"
+
+enum class RenderLayer : uint8_t {
+  Opaque,
+  Transparent,
+};
+
+// everything needed to issue one indexed draw, recorded during the frame and
+// executed by RenderQueue::submit
+struct DrawPacket {
+  Shader* shader{nullptr};
+  GLuint program{};
+  // identifies the texture set, packets with the same value share their binds
+  uint64_t material{};
+  std::span<const MeshTexture> textures{};
+  GLuint vao{};
+  GLsizei index_count{};
+  // sub range of a shared index buffer, see GeometryPool
+  GLenum index_type{GL_UNSIGNED_INT};
+  size_t index_offset{};
+  GLint base_vertex{};
+  GLsizei instance_count{1};
+  glm::mat4 transform{1.0f};
+  // view space distance to the camera
+  float depth{};
+  RenderLayer layer{RenderLayer::Opaque};
+};
+
+// Collects the draws of a frame and submits them ordered by a 64-bit key so
+// that consecutive packets share as much gl state as possible.
+//
+// opaque:      0 | program:12 | material:16 | vao:16 | depth:19   (front to back)
+// transparent: 1 | ~depth:24  | program:12  | material:16 | vao:11 (back to front)
+class RenderQueue {
+public:
+  struct Stats {
+    size_t packets;
+    size_t draw_calls;
+    size_t program_binds;
+    size_t material_binds;
+    size_t texture_binds;
+    size_t vao_binds;
+    // binds an unsorted submission would issue minus the binds that were issued
+    size_t binds_avoided;
+    double sort_ms;
+  };
+
+  void push(const DrawPacket& packet);
+
+  // sort the recorded packets, issue them and start a new frame.
+  // with execute = false no gl call is made, the stats are still collected
+  void submit(bool execute = true);
+  void clear();
+
+  size_t size() const { return packets_.size(); }
+  const Stats& stats() const { return stats_; }
+
+  static uint64_t sort_key(const DrawPacket& packet);
+
+private:
+  struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  std::vector<DrawPacket> packets_{};
+  std::vector<SortEntry> entries_{};
+  std::vector<SortEntry> scratch_{};
+  Stats stats_{};
+
+  void sort();
+  void execute(bool issue_gl_calls);
+};
@@ -3,26 +3,101 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "glad_wrapper.hpp"
+#include "ShaderPreprocessor.hpp"
 
 enum class ShaderType : uint8_t {
   Vertex,
   Fragment,
 };
 
+class Shader;
+
+// Pre-resolved uniform of a linked program, setting it needs no name lookup.
+// A handle to an inactive uniform is valid and does nothing, like location -1.
+template <typename T>
+class Uniform {
+public:
+  Uniform() = default;
+
+  void set(const T& value) const;
+  bool is_active() const { return shader_ != nullptr && slot_ >= 0; }
+
+private:
+  friend class Shader;
+
+  const Shader* shader_{nullptr};
+  int slot_{-1};
+
+  Uniform(const Shader* shader, int slot) : shader_(shader), slot_(slot) {}
+};
+
 class Shader {
 private:
   constexpr static int INFO_BUF_SIZE = 512;
+  constexpr static size_t MAX_UNIFORM_SIZE = sizeof(glm::mat4);
   bool is_delete = false;
 
-  std::string read_file(std::string_view file_path);
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+  };
+
+  struct UniformSlot {
+    GLint location;
+    GLenum type;
+    bool has_value;
+    std::array<std::byte, MAX_UNIFORM_SIZE> value;
+  };
+
+  // filled once after linking, values are only a cache of what was uploaded
+  mutable std::vector<UniformSlot> uniforms_{};
+  std::unordered_map<std::string, int, StringHash, std::equal_to<>> uniform_slots_{};
+  bool skip_redundant_uniforms_{false};
+
   int compile_shader(ShaderType shader_type, const char* shader_code);
   void link_shader(unsigned int& shader_id, unsigned int vertex, unsigned int fragment);
+  void load_uniforms();
+  void bind_uniform_blocks();
+
+  int find_slot(std::string_view name) const;
+  // -1 when the uniform is declared with another type than type
+  int find_slot(std::string_view name, GLenum type) const;
+  template <typename T>
+  void upload(int slot, const T& value, bool skip_redundant = false) const;
+
+  static void upload_uniform(GLint location, bool value);
+  static void upload_uniform(GLint location, int value);
+  static void upload_uniform(GLint location, float value);
+  static void upload_uniform(GLint location, const glm::vec2& value);
+  static void upload_uniform(GLint location, const glm::vec3& value);
+  static void upload_uniform(GLint location, const glm::vec4& value);
+  static void upload_uniform(GLint location, const glm::mat3& value);
+  static void upload_uniform(GLint location, const glm::mat4& value);
+
+  // the glGetActiveUniform type a value of T is uploaded to
+  template <typename T>
+  static constexpr GLenum uniform_type();
+
+  template <typename T>
+  friend class Uniform;
 
 public:
   unsigned int ID;
 
-  Shader(std::string_view vertex_path, std::string_view fragment_path);
+  // both stages are preprocessed, see preprocess_shader
+  Shader(std::string_view vertex_path, std::string_view fragment_path,
+         const ShaderDefines& defines = {});
   ~Shader();
   void use();
 
@@ -32,6 +107,66 @@ public:
   void set_vec3(std::string_view name, float x, float y, float z) const;
   void set_vec3(std::string_view name, const glm::vec3& vec) const;
   void set_mat4(std::string_view name, const glm::mat4& martix) const;
+  // texture unit of a sampler, only uploaded when the unit changed
+  void set_sampler(std::string_view name, int unit) const;
+
+  // a uniform declared with another type than T gives an inactive handle
+  template <typename T>
+  auto uniform(std::string_view name) const -> Uniform<T> {
+    return Uniform<T>{this, find_slot(name, uniform_type<T>())};
+  }
+
+  // skip glUniform* when the value equals the last one uploaded through this Shader,
+  // only valid as long as nobody sets the same uniforms behind its back
+  void set_skip_redundant_uniforms(bool skip);
 
   void clear();
 };
+
+template <typename T>
+constexpr GLenum Shader::uniform_type() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return GL_BOOL;
+  } else if constexpr (std::is_same_v<T, int>) {
+    return GL_INT;
+  } else if constexpr (std::is_same_v<T, float>) {
+    return GL_FLOAT;
+  } else if constexpr (std::is_same_v<T, glm::vec2>) {
+    return GL_FLOAT_VEC2;
+  } else if constexpr (std::is_same_v<T, glm::vec3>) {
+    return GL_FLOAT_VEC3;
+  } else if constexpr (std::is_same_v<T, glm::vec4>) {
+    return GL_FLOAT_VEC4;
+  } else if constexpr (std::is_same_v<T, glm::mat3>) {
+    return GL_FLOAT_MAT3;
+  } else {
+    static_assert(std::is_same_v<T, glm::mat4>, "no glUniform* upload for this type");
+    return GL_FLOAT_MAT4;
+  }
+}
+
+template <typename T>
+void Shader::upload(int slot, const T& value, bool skip_redundant) const {
+  static_assert(sizeof(T) <= MAX_UNIFORM_SIZE);
+  if (slot < 0) {
+    return;
+  }
+
+  auto& uniform = uniforms_[slot];
+  if ((skip_redundant || skip_redundant_uniforms_) && uniform.has_value &&
+      std::memcmp(uniform.value.data(), &value, sizeof(T)) == 0) {
+    return;
+  }
+
+  std::memcpy(uniform.value.data(), &value, sizeof(T));
+  uniform.has_value = true;
+  upload_uniform(uniform.location, value);
+  glad::call_stats().uniform_uploads++;
+}
+
+template <typename T>
+void Uniform<T>::set(const T& value) const {
+  if (shader_) {
+    shader_->upload(slot_, value);
+  }
+}
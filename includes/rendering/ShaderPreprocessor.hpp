@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// #define NAME VALUE lines injected after #version. Kept sorted by name, so two sets
+// with the same defines compare and hash equal whatever order they were set in.
+class ShaderDefines {
+public:
+  using Define = std::pair<std::string, std::string>;
+
+  ShaderDefines() = default;
+  ShaderDefines(std::initializer_list<Define> defines);
+
+  ShaderDefines& set(std::string_view name, std::string_view value = "1");
+  ShaderDefines& set(std::string_view name, int value);
+  void erase(std::string_view name);
+  bool contains(std::string_view name) const;
+
+  bool empty() const { return defines_.empty(); }
+  uint64_t hash() const { return hash_; }
+  auto begin() const { return defines_.begin(); }
+  auto end() const { return defines_.end(); }
+
+  bool operator==(const ShaderDefines& other) const { return defines_ == other.defines_; }
+
+private:
+  std::vector<Define> defines_{};
+  uint64_t hash_{};
+
+  void rehash();
+};
+
+struct ShaderSource {
+  std::string code;
+  // indexed by the source string number of the emitted #line directives, 0 is the stage file
+  std::vector<std::filesystem::path> files;
+};
+
+// Expand #include "file" relative to the including file and inject defines.
+//
+// every file is included once per stage, like #pragma once, which also breaks
+// include cycles. includes are expanded even inside #if blocks that end up inactive.
+// throws std::runtime_error when a file can not be read
+ShaderSource preprocess_shader(const std::filesystem::path& path,
+                               const ShaderDefines& defines = {});
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "Shader.hpp"
+#include "ShaderPreprocessor.hpp"
+
+// Permutation cache of one vertex/fragment pair, keyed by the define set.
+//
+// a variant is compiled the first time its defines are asked for. resolve the
+// index once, per material or per scene, then get(index) at draw time is a
+// plain vector lookup without hashing
+class ShaderVariants {
+public:
+  using Index = uint32_t;
+
+  ShaderVariants(std::string vertex_path, std::string fragment_path);
+
+  Index variant(const ShaderDefines& defines);
+  Shader& get(Index index) { return *shaders_[index]; }
+  Shader& get(const ShaderDefines& defines) { return get(variant(defines)); }
+
+  // compiled variants so far
+  size_t size() const { return shaders_.size(); }
+
+private:
+  struct DefinesHash {
+    size_t operator()(const ShaderDefines& defines) const { return defines.hash(); }
+  };
+
+  std::string vertex_path_;
+  std::string fragment_path_;
+  // Uniform handles point at their Shader, the address has to stay put
+  std::vector<std::unique_ptr<Shader>> shaders_{};
+  std::unordered_map<ShaderDefines, Index, DefinesHash> variants_{};
+};
+
+// HAS_DIFFUSE_MAP, HAS_SPECULAR_MAP, HAS_NORMAL_MAP and HAS_HEIGHT_MAP for the
+// texture types present in a mesh
+ShaderDefines texture_defines(std::span<const MeshTexture> textures);
@@ -3,7 +3,14 @@
 #include <assimp/types.h>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 enum class TextureFormat : uint8_t {
   RGB,
@@ -27,23 +34,109 @@ struct TextureArgs {
   TextureFormat format;
   bool auto_format = false;
   bool generate_mipmap = true;
+  // upload only the mip tail, TextureStreamer brings finer levels in later
+  bool streaming = false;
   GLint min_filter = GL_LINEAR;
   GLint mag_filter = GL_LINEAR;
   GLint wrap_s = GL_REPEAT;
   GLint wrap_t = GL_REPEAT;
 };
 
+struct ImageDeleter {
+  void operator()(unsigned char* pixels) const;
+};
+
+// pixels decoded by stb_image, safe to produce on any thread
+struct ImageData {
+  std::unique_ptr<unsigned char, ImageDeleter> pixels{};
+  int width{};
+  int height{};
+  int nr_channels{};
+};
+
+// every mip level of an image, box filtered on the cpu so the levels can be
+// uploaded one at a time. rows are tightly packed
+struct MipChain {
+  std::vector<std::vector<unsigned char>> levels{};
+  int width{};
+  int height{};
+  int nr_channels{};
+
+  int level_count() const { return static_cast<int>(levels.size()); }
+  int level_width(int level) const { return std::max(1, width >> level); }
+  int level_height(int level) const { return std::max(1, height >> level); }
+};
+
+enum class BlockFormat : uint8_t {
+  // rgb, 4 bpp
+  BC1,
+  // rgba, bc1 color with bc4 alpha, 8 bpp
+  BC3,
+  // single channel, 4 bpp
+  BC4,
+  // two channels, normal maps, 8 bpp
+  BC5,
+  // rgba, 8 bpp
+  BC7,
+};
+
+// bytes of one 4x4 block
+constexpr size_t block_bytes(BlockFormat format) {
+  return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+// block compressed image with every mip level, level 0 first
+struct CompressedImage {
+  BlockFormat format{};
+  bool srgb{};
+  int width{};
+  int height{};
+  std::vector<std::vector<std::byte>> levels{};
+
+  int level_count() const { return static_cast<int>(levels.size()); }
+  int level_width(int level) const { return std::max(1, width >> level); }
+  int level_height(int level) const { return std::max(1, height >> level); }
+};
+
+class TextureStreamer;
+
 class Texture {
 public:
   explicit Texture(TextureArgs args);
+  // upload already decoded pixels, must run on the gl context thread
+  Texture(TextureArgs args, ImageData image);
+  // streaming upload: levels up to STREAM_TAIL_SIZE are resident at once, finer
+  // levels follow through TextureStreamer while base level clamps sampling
+  Texture(TextureArgs args, MipChain mips);
+  // upload every level with glCompressedTexImage2D, format and mips come from the image
+  Texture(TextureArgs args, CompressedImage image);
   ~Texture();
 
-  void bind() const;
+  // bind to a texture unit picked by the context state, returns the unit
+  // for the sampler uniform
+  int bind() const;
   GLuint id() const;
-  int unit_index() const;
   std::string_view unform_name() const;
   TextureType texture_type() const;
   std::string_view cmp_path() const;
+  // approximate gpu memory of the texture including its mip chain
+  size_t byte_size() const;
+  // gpu memory of the levels uploaded so far, byte_size() unless streaming
+  size_t resident_bytes() const;
+
+  bool streaming() const { return mips_ != nullptr; }
+  // finest uploaded level, the current GL_TEXTURE_BASE_LEVEL
+  int resident_level() const { return resident_level_; }
+  // largest size in pixels the texture covers on screen this frame, streaming
+  // textures nobody asks for fall back to their mip tail
+  void request_size(float pixels) const;
+
+  static ImageData decode(std::string_view load_path);
+  static ImageData decode(std::span<const std::byte> encoded, std::string_view name);
+  static MipChain build_mips(ImageData image);
+
+  // largest edge of the levels a streaming texture starts with
+  constexpr static int STREAM_TAIL_SIZE = 64;
 
 private:
   std::string uniform_name_;
@@ -54,10 +147,31 @@ private:
   int width_{};
   int height_{};
   int nr_channels_{};
-  int unit_index_{};
+  bool has_mipmap_{};
+  GLint internal_format_{};
+  GLint format_{};
+  // gpu size of a block compressed texture
+  size_t compressed_bytes_{};
+
+  // streaming state, kept on the cpu so evicted levels can come back
+  friend class TextureStreamer;
+  std::unique_ptr<MipChain> mips_{};
+  int resident_level_{};
+  mutable float requested_size_{};
+  // consecutive streamer updates the texture wanted fewer levels than resident
+  int idle_updates_{};
+
+  // finest level worth having for the requested size
+  int wanted_level() const;
+  // finest level of the tail
+  int tail_level() const;
+  size_t level_bytes(int level) const;
+  void upload_level(int level);
+  // drop every level finer than level
+  void evict_to(int level);
 
   std::pair<GLint, GLint> handle_format(bool auto_format, int nr_channels,
                                         TextureFormat internal_format, TextureFormat format);
   GLint texture_format(TextureFormat format);
-  static int init_unit_index();
+  static GLint compressed_format(BlockFormat format, bool srgb);
 };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "Texture.hpp"
+
+// DDS and KTX2 containers of block compressed textures.
+//
+// DDS is read with legacy FourCC (DXT1, DXT5, ATI1/BC4U, ATI2/BC5U) and DX10
+// headers, KTX2 with BCn vkFormats and no supercompression. Only the first
+// layer/face of every level is read.
+
+// .dds and .ktx2 files go through read_compressed_texture instead of stb_image
+bool is_compressed_container(std::string_view path);
+
+// throws when the file is malformed or holds a format other than BC1/3/4/5/7
+CompressedImage read_compressed_texture(std::span<const std::byte> bytes, std::string_view name);
+
+// BCn cache of a source image, a DDS tagged with the hash of the source bytes
+std::string bcn_cache_path(std::string_view source_path);
+void write_dds(std::string_view path, const CompressedImage& image, uint64_t source_hash);
+// the hash a DDS was tagged with by write_dds
+std::optional<uint64_t> dds_source_hash(std::span<const std::byte> bytes);
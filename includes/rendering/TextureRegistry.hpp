@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Texture.hpp"
+
+// Process-wide cache of uploaded textures, shared by every Model.
+//
+// Textures are keyed by canonical file path, a content hash catches the same
+// image stored under different paths. Both keys also carry a variant, a hash of
+// the load settings that change the upload (texture type, srgb, streaming, block
+// compression), so the same file loaded differently gets its own texture.
+// The registry only keeps weak references, an entry is evicted as soon as the
+// last handle is released. Sampling parameters come from whoever loaded the
+// texture first.
+class TextureRegistry {
+public:
+  struct Stats {
+    size_t texture_count;
+    size_t resident_bytes;
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  static TextureRegistry& instance();
+
+  static std::string canonical_path(std::string_view load_path);
+
+  // both lookups are thread safe and count towards hit/miss stats
+  auto find(const std::string& canonical_path, uint64_t variant) -> std::shared_ptr<Texture>;
+  auto find_by_hash(uint64_t content_hash, uint64_t variant) -> std::shared_ptr<Texture>;
+
+  // take ownership of a freshly uploaded texture and hand out the shared handle.
+  // when the path or content was registered in the meantime the existing texture is returned
+  auto insert(const std::string& canonical_path, uint64_t content_hash, uint64_t variant,
+              std::unique_ptr<Texture> texture) -> std::shared_ptr<Texture>;
+
+  Stats stats() const;
+
+private:
+  struct PathKey {
+    std::string path;
+    uint64_t variant;
+    bool operator==(const PathKey&) const = default;
+  };
+
+  struct HashKey {
+    uint64_t content_hash;
+    uint64_t variant;
+    bool operator==(const HashKey&) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(const PathKey& key) const;
+    size_t operator()(const HashKey& key) const;
+  };
+
+  struct Entry {
+    std::weak_ptr<Texture> texture;
+    const Texture* raw;
+  };
+
+  mutable std::mutex mutex_{};
+  std::unordered_map<PathKey, Entry, KeyHash> by_path_{};
+  std::unordered_map<HashKey, Entry, KeyHash> by_hash_{};
+  size_t resident_bytes_{};
+  uint64_t hits_{};
+  uint64_t misses_{};
+
+  TextureRegistry() = default;
+
+  void evict(const PathKey& path_key, const HashKey& hash_key, const Texture* texture);
+};
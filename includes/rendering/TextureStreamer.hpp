@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Texture.hpp"
+
+// Brings the mip levels of streaming textures in and out, on the context thread.
+//
+// Textures start with their mip tail resident and GL_TEXTURE_BASE_LEVEL clamped
+// to it. Every update uploads the next finer level of the textures that are
+// requested larger on screen than they are resident, most starved first, until
+// the byte budget is spent. Levels of textures that stay smaller on screen for
+// EVICT_UPDATES updates are released again.
+class TextureStreamer {
+public:
+  struct Stats {
+    size_t texture_count;
+    size_t resident_bytes;
+    // with every level resident
+    size_t full_bytes;
+    // levels still wanted after the last update
+    size_t pending_levels;
+    size_t uploaded_bytes;
+    size_t evicted_bytes;
+  };
+
+  static TextureStreamer& instance();
+
+  // call once per frame after the Texture::request_size calls of the frame,
+  // at least one level is uploaded per call when any is wanted
+  void update(size_t byte_budget = DEFAULT_BUDGET);
+
+  Stats stats() const;
+
+  constexpr static size_t DEFAULT_BUDGET = 4 << 20;
+  constexpr static int EVICT_UPDATES = 120;
+
+private:
+  friend class Texture;
+
+  struct Starved {
+    Texture* texture;
+    int wanted;
+  };
+
+  std::vector<Texture*> textures_{};
+  std::vector<Starved> starved_{};
+  size_t pending_levels_{};
+  size_t uploaded_bytes_{};
+  size_t evicted_bytes_{};
+
+  TextureStreamer() = default;
+
+  void add(Texture* texture);
+  void remove(Texture* texture);
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <string_view>
+
+#include "glad_wrapper.hpp"
+
+// C++ side of the uniform blocks shared by the shaders, members mirror the
+// glsl declarations in order
+
+// capacity of the Lights block, shaders only loop over NR_POINT_LIGHTS of them
+constexpr int MAX_POINT_LIGHTS = 4;
+
+struct CameraBlock {
+  constexpr static std::string_view NAME = "Camera";
+
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::vec3 view_pos;
+};
+
+struct DirLight {
+  glm::vec3 direction;
+
+  glm::vec3 ambient;
+  glm::vec3 diffuse;
+  glm::vec3 specular;
+};
+
+struct PointLight {
+  glm::vec3 position;
+
+  float constant;
+  float linear;
+  float quadratic;
+
+  glm::vec3 ambient;
+  glm::vec3 diffuse;
+  glm::vec3 specular;
+};
+
+struct SpotLight {
+  glm::vec3 position;
+  glm::vec3 direction;
+  float cut_off;
+  float outer_cut_off;
+
+  float constant;
+  float linear;
+  float quadratic;
+
+  glm::vec3 ambient;
+  glm::vec3 diffuse;
+  glm::vec3 specular;
+};
+
+struct LightsBlock {
+  constexpr static std::string_view NAME = "Lights";
+
+  DirLight dir_light;
+  std::array<PointLight, MAX_POINT_LIGHTS> point_lights;
+  SpotLight spot_light;
+};
+
+void write_std140(glad::Std140Writer& writer, const CameraBlock& block);
+void write_std140(glad::Std140Writer& writer, const DirLight& light);
+void write_std140(glad::Std140Writer& writer, const PointLight& light);
+void write_std140(glad::Std140Writer& writer, const SpotLight& light);
+void write_std140(glad::Std140Writer& writer, const LightsBlock& block);
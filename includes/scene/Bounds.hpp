@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <limits>
+
+struct Aabb {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+  bool empty() const { return min.x > max.x; }
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  void expand(const glm::vec3& point);
+  void expand(const Aabb& other);
+  // bounds of the transformed box, not of the transformed contents
+  Aabb transformed(const glm::mat4& transform) const;
+};
+
+struct BoundingSphere {
+  glm::vec3 center{};
+  float radius{-1.0f};
+
+  bool empty() const { return radius < 0.0f; }
+  // radius grows with the largest axis scale of transform
+  BoundingSphere transformed(const glm::mat4& transform) const;
+};
+
+// six normalized planes (xyz normal pointing inside, w distance)
+struct Frustum {
+  enum Side { Left, Right, Bottom, Top, Near, Far };
+
+  std::array<glm::vec4, 6> planes{};
+
+  // Gribb/Hartmann extraction from projection * view, gl clip space (-w <= z <= w)
+  static Frustum from_matrix(const glm::mat4& view_projection);
+
+  // the same frustum in the space that local_to_world maps from
+  Frustum to_local(const glm::mat4& local_to_world) const;
+
+  bool intersects(const BoundingSphere& sphere) const;
+  bool intersects(const Aabb& aabb) const;
+};
@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Bounds.hpp"
+
 enum class CameraMovement {
   Forward,
   Backward,
@@ -39,9 +41,13 @@ public:
          float pitch);
 
   glm::mat4 view_matrix();
+  // world space frustum of projection * view_matrix()
+  Frustum frustum(const glm::mat4& projection);
   void process_keyboard(CameraMovement direction, float delta_time);
   void process_mouse_movement(float x_offset, float y_offset, GLboolean constrain_pitch = true);
   void process_mouse_scroll(float y_offset);
+  // turn towards a point, for scripted camera paths
+  void look_at(const glm::vec3& target);
 
 private:
   void update_camera_vectors();
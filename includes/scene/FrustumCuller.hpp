@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.hpp"
+
+// Sphere vs frustum culling over structure of arrays storage.
+//
+// spheres are tested 4 (SSE) or 8 (AVX) at a time, the widest kernel the cpu
+// supports is picked at runtime. storage is padded with spheres that never pass.
+class FrustumCuller {
+public:
+  enum class Kernel : uint8_t {
+    Scalar,
+    Sse,
+    Avx,
+  };
+
+  FrustumCuller();
+
+  void clear();
+  void reserve(size_t count);
+  // returns the index reported by cull
+  uint32_t add(const BoundingSphere& sphere);
+  void set(uint32_t index, const BoundingSphere& sphere);
+  size_t size() const { return count_; }
+
+  // overwrites visible with the indices of spheres touching the frustum, in ascending order
+  size_t cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+  Kernel kernel() const { return kernel_; }
+  // falls back to the best supported kernel when the cpu lacks the requested one
+  void set_kernel(Kernel kernel);
+  static Kernel best_kernel();
+  static bool supported(Kernel kernel);
+  static const char* kernel_name(Kernel kernel);
+
+private:
+  constexpr static size_t LANES = 8;
+
+  std::vector<float> x_{};
+  std::vector<float> y_{};
+  std::vector<float> z_{};
+  std::vector<float> radius_{};
+  size_t count_{};
+  Kernel kernel_{};
+};
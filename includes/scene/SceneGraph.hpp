@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Transform hierarchy stored as flat arrays sorted so that every parent comes
+// before its children.
+//
+// set_local only flags the node, update() then walks the arrays once from the
+// first dirty node and recomputes world matrices of dirty nodes and of nodes
+// whose parent was recomputed in the same pass.
+class SceneGraph {
+public:
+  constexpr static uint32_t NO_PARENT = ~0u;
+
+  void reserve(size_t count);
+  void clear();
+
+  // parent has to be an existing node, which keeps the arrays parent sorted
+  uint32_t add_node(const glm::mat4& local = glm::mat4{1.0f}, uint32_t parent = NO_PARENT);
+  void set_local(uint32_t node, const glm::mat4& local);
+
+  size_t size() const { return parent_.size(); }
+  uint32_t parent(uint32_t node) const { return parent_[node]; }
+  const glm::mat4& local(uint32_t node) const { return local_[node]; }
+  // stale until the next update() after a set_local
+  const glm::mat4& world(uint32_t node) const { return world_[node]; }
+
+  bool dirty() const { return first_dirty_ < size(); }
+  // returns the number of recomputed world matrices
+  size_t update();
+  // true when the world matrix of node was recomputed by the last update()
+  bool changed(uint32_t node) const { return updated_in_[node] == update_count_; }
+
+private:
+  std::vector<uint32_t> parent_{};
+  std::vector<glm::mat4> local_{};
+  std::vector<glm::mat4> world_{};
+  std::vector<uint8_t> dirty_{};
+  // update pass that last recomputed the node, children compare against it
+  std::vector<uint32_t> updated_in_{};
+  uint32_t update_count_{};
+  size_t first_dirty_{};
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// FNV-1a style 64-bit hash that consumes 8 bytes per step, fast enough to
+// fingerprint multi-megabyte asset files on every launch
+inline uint64_t hash_bytes(std::span<const std::byte> bytes, uint64_t seed = 0xcbf29ce484222325ull) {
+  constexpr uint64_t prime = 0x100000001b3ull;
+
+  uint64_t hash = seed;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 32;
+  }
+  for (; i < bytes.size(); i++) {
+    hash = (hash ^ static_cast<uint64_t>(bytes[i])) * prime;
+  }
+
+  return hash;
+}
+
+inline uint64_t hash_string(std::string_view str, uint64_t seed = 0xcbf29ce484222325ull) {
+  return hash_bytes(std::as_bytes(std::span{str.data(), str.size()}), seed);
+}
+
+inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// murmur3 fmix64, every input bit reaches every output bit. hash_combine results hardly
+// differ in their high bits, finalize them before a few bits are taken as a key
+inline uint64_t hash_finalize(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdull;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ull;
+  value ^= value >> 33;
+  return value;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error(std::format("Failed to open file: {}", path.string()));
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file_, &size);
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) {
+      return;
+    }
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+      close();
+      throw std::runtime_error(std::format("Failed to map file: {}", path.string()));
+    }
+    data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      throw std::runtime_error(std::format("Failed to open file: {}", path.string()));
+    }
+
+    struct stat st{};
+    fstat(fd_, &st);
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+      return;
+    }
+
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    data_ = data == MAP_FAILED ? nullptr : static_cast<const std::byte*>(data);
+#endif
+    if (!data_) {
+      close();
+      throw std::runtime_error(std::format("Failed to map file: {}", path.string()));
+    }
+  }
+
+  ~MappedFile() {
+    close();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+      file_ = std::exchange(other.file_, INVALID_HANDLE_VALUE);
+      mapping_ = std::exchange(other.mapping_, nullptr);
+#else
+      fd_ = std::exchange(other.fd_, -1);
+#endif
+    }
+    return *this;
+  }
+
+  auto bytes() const -> std::span<const std::byte> { return {data_, size_}; }
+  size_t size() const { return size_; }
+
+private:
+  const std::byte* data_{nullptr};
+  size_t size_{};
+#ifdef _WIN32
+  HANDLE file_{INVALID_HANDLE_VALUE};
+  HANDLE mapping_{nullptr};
+#else
+  int fd_{-1};
+#endif
+
+  void close() {
+#ifdef _WIN32
+    if (data_) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) {
+      munmap(const_cast<std::byte*>(data_), size_);
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+};
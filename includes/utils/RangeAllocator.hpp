@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <optional>
+
+// First-fit sub-allocator over [0, capacity), neighbouring free ranges are
+// merged on free. Units are up to the caller (vertices, indices, bytes...)
+class RangeAllocator {
+public:
+  explicit RangeAllocator(size_t capacity = 0) : capacity_(capacity) {
+    if (capacity > 0) {
+      free_.emplace(0, capacity);
+    }
+  }
+
+  auto allocate(size_t size) -> std::optional<size_t> {
+    if (size == 0) {
+      return 0;
+    }
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+      auto [offset, free_size] = *it;
+      if (free_size < size) {
+        continue;
+      }
+      free_.erase(it);
+      if (free_size > size) {
+        free_.emplace(offset + size, free_size - size);
+      }
+      used_ += size;
+      return offset;
+    }
+    return std::nullopt;
+  }
+
+  void free(size_t offset, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    used_ -= size;
+
+    auto next = free_.lower_bound(offset);
+    if (next != free_.end() && offset + size == next->first) {
+      size += next->second;
+      next = free_.erase(next);
+    }
+    if (next != free_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        prev->second += size;
+        return;
+      }
+    }
+    free_.emplace(offset, size);
+  }
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return used_; }
+  size_t free_block_count() const { return free_.size(); }
+
+  size_t largest_free_block() const {
+    size_t largest{};
+    for (auto& [offset, size] : free_) {
+      largest = std::max(largest, size);
+    }
+    return largest;
+  }
+
+  // 0 when all free space is one block, close to 1 when it is scattered in small holes
+  float fragmentation() const {
+    size_t free_size = capacity_ - used_;
+    if (free_size == 0) {
+      return 0.0f;
+    }
+    return 1.0f - static_cast<float>(largest_free_block()) / static_cast<float>(free_size);
+  }
+
+private:
+  size_t capacity_{};
+  size_t used_{};
+  // offset -> size
+  std::map<size_t, size_t> free_{};
+};
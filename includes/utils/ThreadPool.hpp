@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed size worker pool for cpu side asset work (decode, import, binning...)
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t thread_count = default_thread_count()) {
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+      workers_.emplace_back([this](std::stop_token stop) { worker_loop(stop); });
+    }
+  }
+
+  ~ThreadPool() {
+    for (auto& worker : workers_) {
+      worker.request_stop();
+    }
+    cv_.notify_all();
+    // join before the queue and the condition variable are destroyed
+    workers_.clear();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template <typename Func>
+  auto submit(Func&& func) -> std::future<std::invoke_result_t<Func>> {
+    std::packaged_task<std::invoke_result_t<Func>()> task{std::forward<Func>(func)};
+    auto future = task.get_future();
+    {
+      std::lock_guard lock{mutex_};
+      tasks_.emplace(std::move(task));
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+  // run func(i) for every i in [0, count), the calling thread takes part in the work.
+  // the first exception thrown by func is rethrown here
+  template <typename Func>
+  void parallel_for(size_t count, Func&& func) {
+    if (count == 0) {
+      return;
+    }
+
+    struct State {
+      std::atomic<size_t> next{};
+      std::atomic<size_t> done{};
+      std::mutex mutex{};
+      std::exception_ptr error{};
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &func] {
+      for (size_t i = state->next++; i < count; i = state->next++) {
+        try {
+          func(i);
+        } catch (...) {
+          std::lock_guard lock{state->mutex};
+          if (!state->error) {
+            state->error = std::current_exception();
+          }
+        }
+        if (++state->done == count) {
+          state->done.notify_all();
+        }
+      }
+    };
+
+    size_t helpers = std::min(count - 1, workers_.size());
+    for (size_t i = 0; i < helpers; i++) {
+      submit(run);
+    }
+    run();
+
+    for (size_t done = state->done; done < count; done = state->done) {
+      state->done.wait(done);
+    }
+
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
+  }
+
+  size_t thread_count() const { return workers_.size(); }
+
+  static ThreadPool& shared() {
+    static ThreadPool pool{};
+    return pool;
+  }
+
+  static size_t default_thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+private:
+  std::vector<std::jthread> workers_{};
+  std::queue<std::move_only_function<void()>> tasks_{};
+  std::mutex mutex_{};
+  std::condition_variable_any cv_{};
+
+  void worker_loop(std::stop_token stop) {
+    while (true) {
+      std::move_only_function<void()> task;
+      {
+        std::unique_lock lock{mutex_};
+        if (!cv_.wait(lock, stop, [this] { return !tasks_.empty(); })) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+};
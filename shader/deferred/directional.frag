@@ -0,0 +1,16 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "../include/camera.glsl"
+#include "../include/lights.glsl"
+#include "gbuffer.glsl"
+
+void main()
+{
+    GBufferSample g;
+    if (!readGBuffer(g))
+        discard;
+
+    vec3 lightDir = normalize(-dirLight.direction);
+    FragColor = vec4(shadeLight(g, lightDir, dirLight.ambient, dirLight.diffuse, dirLight.specular), 1.0);
+}
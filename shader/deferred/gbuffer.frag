@@ -0,0 +1,26 @@
+#version 330 core
+// G-buffer layout, see DeferredRenderer.hpp
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+uniform Material material;
+
+void main()
+{
+    // w marks the texel as covered, the light passes skip the rest
+    gPosition = vec4(FragPos, 1.0);
+    gNormal = vec4(normalize(Normal), material.shininess);
+    gAlbedoSpec = vec4(texture(material.diffuse, TexCoords).rgb,
+                       texture(material.specular, TexCoords).r);
+}
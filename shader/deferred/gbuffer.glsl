@@ -0,0 +1,33 @@
+// G-buffer inputs of the light passes, needs the Camera block
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+struct GBufferSample {
+    vec3 position;
+    vec3 normal;
+    float shininess;
+    vec3 albedo;
+    float specular;
+};
+
+// false where no geometry was drawn
+bool readGBuffer(out GBufferSample g)
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 position = texelFetch(gPosition, texel, 0);
+    vec4 normal = texelFetch(gNormal, texel, 0);
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, texel, 0);
+    g = GBufferSample(position.xyz, normal.xyz, normal.w, albedoSpec.rgb, albedoSpec.a);
+    return position.w != 0.0;
+}
+
+// blinn-phong of one light, the same terms as the forward path in color.frag
+vec3 shadeLight(GBufferSample g, vec3 lightDir, vec3 ambient, vec3 diffuse, vec3 specular)
+{
+    vec3 viewDir = normalize(viewPos - g.position);
+    float diff = max(dot(g.normal, lightDir), 0.0);
+    vec3 halfVec = normalize(viewDir + lightDir);
+    float spec = pow(max(dot(g.normal, halfVec), 0.0), g.shininess);
+    return (ambient + diffuse * diff) * g.albedo + specular * spec * g.specular;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+#include "../include/camera.glsl"
+
+void main()
+{
+    vec4 worldPos = aModel * vec4(aPos, 1.0);
+    gl_Position = projection * view * worldPos;
+    FragPos = worldPos.xyz;
+    Normal = mat3(transpose(inverse(aModel))) * aNormal;
+    TexCoords = aTexCoords;
+}
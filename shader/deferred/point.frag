@@ -0,0 +1,31 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in int lightIndex;
+
+#include "../include/camera.glsl"
+#include "gbuffer.glsl"
+
+uniform samplerBuffer pointLightData;
+
+void main()
+{
+    GBufferSample g;
+    if (!readGBuffer(g))
+        discard;
+
+    int base = lightIndex * POINT_LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(pointLightData, base);
+    vec3 terms = texelFetch(pointLightData, base + 1).xyz;
+    vec3 toLight = positionRadius.xyz - g.position;
+    float dist = length(toLight);
+    if (dist > positionRadius.w)
+        discard;
+
+    float attenuation = 1.0 / (terms.x + terms.y * dist + terms.z * (dist * dist));
+    vec3 color = shadeLight(g, toLight / max(dist, 1e-4),
+                            texelFetch(pointLightData, base + 2).rgb,
+                            texelFetch(pointLightData, base + 3).rgb,
+                            texelFetch(pointLightData, base + 4).rgb);
+    FragColor = vec4(color * attenuation, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+// unit sphere scaled to the light radius
+layout (location = 0) in vec3 aPos;
+
+#include "../include/camera.glsl"
+
+// POINT_LIGHT_TEXELS per light, see DeferredRenderer.cpp
+uniform samplerBuffer pointLightData;
+
+flat out int lightIndex;
+
+void main()
+{
+    vec4 positionRadius = texelFetch(pointLightData, gl_InstanceID * POINT_LIGHT_TEXELS);
+    lightIndex = gl_InstanceID;
+    gl_Position = projection * view * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in int lightIndex;
+
+#include "../include/camera.glsl"
+#include "gbuffer.glsl"
+
+uniform samplerBuffer spotLightData;
+
+void main()
+{
+    GBufferSample g;
+    if (!readGBuffer(g))
+        discard;
+
+    int base = lightIndex * SPOT_LIGHT_TEXELS;
+    vec4 positionRange = texelFetch(spotLightData, base);
+    vec4 directionCutOff = texelFetch(spotLightData, base + 1);
+    vec4 terms = texelFetch(spotLightData, base + 2);
+    vec3 toLight = positionRange.xyz - g.position;
+    float dist = length(toLight);
+    if (dist > positionRange.w)
+        discard;
+
+    vec3 lightDir = toLight / max(dist, 1e-4);
+    float theta = dot(lightDir, -directionCutOff.xyz);
+    float epsilon = directionCutOff.w - terms.w;
+    float intensity = clamp((theta - terms.w) / epsilon, 0.0, 1.0);
+    float attenuation = 1.0 / (terms.x + terms.y * dist + terms.z * (dist * dist));
+
+    vec3 color = shadeLight(g, lightDir,
+                            texelFetch(spotLightData, base + 3).rgb,
+                            texelFetch(spotLightData, base + 4).rgb,
+                            texelFetch(spotLightData, base + 5).rgb);
+    FragColor = vec4(color * attenuation * intensity, 1.0);
+}
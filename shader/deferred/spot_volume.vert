@@ -0,0 +1,29 @@
+#version 330 core
+// unit cone, apex at the origin and base at z = 1, stretched along the light direction
+layout (location = 0) in vec3 aPos;
+
+#include "../include/camera.glsl"
+
+// SPOT_LIGHT_TEXELS per light, see DeferredRenderer.cpp
+uniform samplerBuffer spotLightData;
+
+flat out int lightIndex;
+
+void main()
+{
+    int base = gl_InstanceID * SPOT_LIGHT_TEXELS;
+    vec4 positionRange = texelFetch(spotLightData, base);
+    vec3 direction = texelFetch(spotLightData, base + 1).xyz;
+    float outerCutOff = texelFetch(spotLightData, base + 2).w;
+
+    vec3 up = abs(direction.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, direction));
+    vec3 bitangent = cross(direction, tangent);
+    float range = positionRange.w;
+    float baseRadius = range * sqrt(1.0 - outerCutOff * outerCutOff) / max(outerCutOff, 1e-3);
+
+    vec3 worldPos = positionRange.xyz + (tangent * aPos.x + bitangent * aPos.y) * baseRadius +
+                    direction * aPos.z * range;
+    lightIndex = gl_InstanceID;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
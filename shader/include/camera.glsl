@@ -0,0 +1,6 @@
+// CameraBlock in UniformBlocks.hpp
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
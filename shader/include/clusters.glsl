@@ -0,0 +1,43 @@
+// LightClusters in LightClusters.hpp, needs the Camera block
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterIndices;
+// tiles x, tiles y, slices
+uniform vec3 clusterGrid;
+// slice = log(depth) * scale + bias
+uniform vec2 clusterDepth;
+uniform vec2 clusterViewport;
+
+struct ClusterLight {
+    vec3 position;
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+// offset into clusterIndices and light count of the cluster holding the fragment
+uvec2 clusterRange(vec3 worldPos)
+{
+    float depth = -(view * vec4(worldPos, 1.0)).z;
+    float slice = floor(log(max(depth, 1e-4)) * clusterDepth.x + clusterDepth.y);
+    vec3 cluster = clamp(vec3(floor(gl_FragCoord.xy / clusterViewport * clusterGrid.xy), slice),
+                         vec3(0.0), clusterGrid - 1.0);
+    int index = int((cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x);
+    return texelFetch(clusterRanges, index).xy;
+}
+
+ClusterLight clusterLight(uint i)
+{
+    int light = int(texelFetch(clusterIndices, int(i)).x) * 2;
+    vec4 positionRadius = texelFetch(clusterLights, light);
+    vec4 colorIntensity = texelFetch(clusterLights, light + 1);
+    return ClusterLight(positionRadius.xyz, positionRadius.w, colorIntensity.rgb, colorIntensity.a);
+}
+
+// inverse square falloff windowed to reach zero at the radius
+float clusterAttenuation(float dist, float radius)
+{
+    float ratio = dist / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (dist * dist + 1.0);
+}
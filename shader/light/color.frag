@@ -6,54 +6,19 @@ struct Material {
     float shininess;
 };
 
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform Material material;
+#include "../include/camera.glsl"
+#include "../include/lights.glsl"
+#ifdef CLUSTERED
+#include "../include/clusters.glsl"
+#endif
 
-uniform DirLight dirLight;
-#define NR_POINT_LIGHTS 4
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
+uniform Material material;
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 {
@@ -90,6 +55,23 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     return (ambient + diffuse + specular);
 }
 
+#ifdef CLUSTERED
+vec3 CalcClusterLight(ClusterLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 toLight = light.position - fragPos;
+    float dist = length(toLight);
+    vec3 lightDir = toLight / max(dist, 1e-4);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfVec = normalize(viewDir + lightDir);
+    float spec = pow(max(dot(normal, halfVec), 0.0), material.shininess);
+
+    vec3 radiance = light.color * light.intensity * clusterAttenuation(dist, light.radius);
+    vec3 diffuse = radiance * diff * texture(material.diffuse, TexCoords).rgb;
+    vec3 specular = radiance * spec * texture(material.specular, TexCoords).rgb;
+    return diffuse + specular;
+}
+#endif
+
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 lightDir = normalize(light.position - fragPos);
@@ -121,8 +103,14 @@ void main()
     vec3 viewDir = normalize(viewPos - FragPos);
 
     vec3 result = CalcDirLight(dirLight, norm, viewPos);
+#ifdef CLUSTERED
+    uvec2 range = clusterRange(FragPos);
+    for (uint i = range.x; i < range.x + range.y; i++)
+        result += CalcClusterLight(clusterLight(i), norm, FragPos, viewDir);
+#else
     for (int i = 0; i < NR_POINT_LIGHTS; i++)
         result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+#endif
 
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
 
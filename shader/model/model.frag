@@ -3,9 +3,15 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
+#ifdef HAS_DIFFUSE_MAP
 uniform sampler2D texture_diffuse1;
+#endif
 
 void main()
 {
+#ifdef HAS_DIFFUSE_MAP
     FragColor = texture(texture_diffuse1, TexCoords);
-}
\ No newline at end of file
+#else
+    FragColor = vec4(0.8, 0.8, 0.8, 1.0);
+#endif
+}
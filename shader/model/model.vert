@@ -5,9 +5,9 @@ layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
+#include "../include/camera.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
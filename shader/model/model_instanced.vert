@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 7) in mat4 aInstanceModel;
+
+out vec2 TexCoords;
+
+#include "../include/camera.glsl"
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * aInstanceModel * vec4(aPos, 1.0);
+}
@@ -0,0 +1,239 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Camera.hpp"
+#include "Model.hpp"
+#include "Profiler.hpp"
+#include "ShaderVariants.hpp"
+#include "UniformBlocks.hpp"
+#include "glad_wrapper.hpp"
+#include "glfw_wrapper.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Reproducible frame time benchmark for automated runs.
+//
+// renders a grid of backpacks with Model::draw while the camera flies a fixed
+// orbit, the camera only depends on the frame index. every frame is finished
+// with glFinish so frame times include the gpu, vsync is off. the statistics and
+// the gl calls per frame go to a json file, the first frames warm up the caches
+// and are not counted.
+//
+// usage: bench [frames] [output json] [headless | hidden | visible]
+
+namespace {
+constexpr int WIDTH = 1280;
+constexpr int HEIGHT = 720;
+constexpr int WARMUP_FRAMES = 30;
+constexpr int GRID_SIZE = 5;
+constexpr float GRID_SPACING = 4.0f;
+
+struct FrameSample {
+  // glfw::window::update to glFinish returning
+  double frame_ms;
+  // until the last gl call was issued
+  double cpu_ms;
+  double gpu_ms;
+  glad::CallStats calls;
+};
+
+// one turn around the grid, bobbing up and down twice
+void fly(Camera& camera, int frame, int frames) {
+  constexpr float PI = 3.14159265f;
+  float t = static_cast<float>(frame) / static_cast<float>(frames);
+  auto center = glm::vec3{0.0f, 0.0f, -(GRID_SIZE - 1) * GRID_SPACING * 0.5f};
+  float angle = t * 2.0f * PI;
+  float radius = GRID_SIZE * GRID_SPACING * (0.4f + 0.3f * std::cos(angle * 3.0f));
+  camera.position_ =
+    center + glm::vec3{radius * std::sin(angle), 2.0f + 3.0f * std::sin(angle * 2.0f),
+                       radius * std::cos(angle)};
+  camera.look_at(center);
+}
+
+std::string_view mode_name(glfw::window_mode mode) {
+  switch (mode) {
+  case glfw::window_mode::visible:
+    return "visible";
+  case glfw::window_mode::hidden:
+    return "hidden";
+  case glfw::window_mode::headless:
+    return "headless";
+  }
+  return "unknown";
+}
+
+glfw::window_mode parse_mode(std::string_view name) {
+  if (name == "visible") {
+    return glfw::window_mode::visible;
+  }
+  if (name == "hidden") {
+    return glfw::window_mode::hidden;
+  }
+  return glfw::window_mode::headless;
+}
+
+std::string gl_string(GLenum name) {
+  auto* value = reinterpret_cast<const char*>(glGetString(name));
+  return value ? value : "";
+}
+
+void write_stats(std::string& out, std::string_view name, std::vector<double> values) {
+  double mean = std::accumulate(values.begin(), values.end(), 0.0) /
+                static_cast<double>(std::max<size_t>(values.size(), 1));
+  auto stats = percentiles(std::move(values));
+  fmt::format_to(std::back_inserter(out),
+                 "  \"{}\": {{\"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, "
+                 "\"p99\": {:.4f}, \"max\": {:.4f}}},\n",
+                 name, mean, stats.p50, stats.p95, stats.p99, stats.max);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  int frames = argc > 1 ? std::stoi(argv[1]) : 600;
+  std::string output = argc > 2 ? argv[2] : "bench.json";
+  auto mode = parse_mode(argc > 3 ? argv[3] : "headless");
+
+  glfw::window window{"bench", WIDTH, HEIGHT, mode};
+  if (!window.native_window()) {
+    return -1;
+  }
+  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+    spdlog::error("Failed to initialize GLAD");
+    return -1;
+  }
+  glfwSwapInterval(0);
+  auto renderer = gl_string(GL_RENDERER);
+  spdlog::info("{} frames on {} ({} window)", frames, renderer, mode_name(mode));
+
+  glad::enable_depth_test();
+  glad::UniformBuffer camera_ubo{CameraBlock::NAME};
+
+  // textures are uploaded whole and nothing streams, every run draws the same thing
+  Model backpack{ModelArgs{.load_path = "../../resources/backpack/backpack.obj"}};
+  ShaderVariants model_shaders{"../../shader/model/model.vert", "../../shader/model/model.frag"};
+  auto& shader = model_shaders.get(backpack.texture_defines());
+
+  std::vector<glm::mat4> transforms{};
+  for (int x = 0; x < GRID_SIZE; x++) {
+    for (int z = 0; z < GRID_SIZE; z++) {
+      auto offset = glm::vec3{float(x - GRID_SIZE / 2), 0.0f, float(-z)} * GRID_SPACING;
+      transforms.push_back(glm::translate(glm::mat4{1.0f}, offset));
+    }
+  }
+
+  Camera camera{};
+  GLuint query{};
+  glGenQueries(1, &query);
+  std::vector<FrameSample> samples{};
+  samples.reserve(frames);
+
+  for (int frame = -WARMUP_FRAMES; frame < frames && !window.should_close(); frame++) {
+    auto start = std::chrono::steady_clock::now();
+    window.update();
+    glad::reset_call_stats();
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    fly(camera, std::max(frame, 0), frames);
+    window.bind_render_target();
+    glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 projection = glm::perspective(
+      glm::radians(camera.zoom_), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f);
+    camera_ubo.update(CameraBlock{projection, camera.view_matrix(), camera.position_});
+    auto frustum = camera.frustum(projection);
+    shader.use();
+    for (auto& transform : transforms) {
+      backpack.draw(shader, frustum, transform);
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    auto submitted = std::chrono::steady_clock::now();
+    if (!window.offscreen()) {
+      window.swap_buffers();
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    window.poll_events();
+
+    GLuint64 gpu_ns{};
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_ns);
+    if (frame >= 0) {
+      samples.push_back(FrameSample{
+        .frame_ms = std::chrono::duration<double, std::milli>(end - start).count(),
+        .cpu_ms = std::chrono::duration<double, std::milli>(submitted - start).count(),
+        .gpu_ms = static_cast<double>(gpu_ns) / 1e6,
+        .calls = glad::call_stats(),
+      });
+    }
+  }
+  glDeleteQueries(1, &query);
+
+  if (samples.empty()) {
+    spdlog::error("No frames rendered");
+    return -1;
+  }
+
+  auto column = [&](auto member) {
+    std::vector<double> values{};
+    for (auto& sample : samples) {
+      values.push_back(std::invoke(member, sample));
+    }
+    return values;
+  };
+  auto calls = [&](auto member) {
+    double total{};
+    for (auto& sample : samples) {
+      total += static_cast<double>(std::invoke(member, sample.calls));
+    }
+    return total / static_cast<double>(samples.size());
+  };
+
+  std::string json{};
+  auto it = std::back_inserter(json);
+  fmt::format_to(it, "{{\n  \"renderer\": {:?},\n  \"version\": {:?},\n", renderer,
+                 gl_string(GL_VERSION));
+  fmt::format_to(it, "  \"mode\": \"{}\",\n  \"width\": {},\n  \"height\": {},\n", mode_name(mode),
+                 WIDTH, HEIGHT);
+  fmt::format_to(it, "  \"frames\": {},\n  \"warmup_frames\": {},\n  \"instances\": {},\n",
+                 samples.size(), WARMUP_FRAMES, transforms.size());
+  write_stats(json, "frame_ms", column(&FrameSample::frame_ms));
+  write_stats(json, "cpu_ms", column(&FrameSample::cpu_ms));
+  write_stats(json, "gpu_ms", column(&FrameSample::gpu_ms));
+  fmt::format_to(it,
+                 "  \"gl_calls_per_frame\": {{\"draw_calls\": {:.1f}, \"binds\": {:.1f}, "
+                 "\"elided_binds\": {:.1f}, \"uniform_uploads\": {:.1f}, "
+                 "\"buffer_uploads\": {:.1f}, \"total\": {:.1f}}}\n}}\n",
+                 calls(&glad::CallStats::draw_calls), calls(&glad::CallStats::binds),
+                 calls(&glad::CallStats::elided_binds), calls(&glad::CallStats::uniform_uploads),
+                 calls(&glad::CallStats::buffer_uploads), calls(&glad::CallStats::total));
+
+  std::ofstream file{output, std::ios::trunc};
+  if (!file) {
+    spdlog::error("Failed to write {}", output);
+    return -1;
+  }
+  file << json;
+
+  auto frame_ms = percentiles(column(&FrameSample::frame_ms));
+  spdlog::info("frame p50 {:.2f} ms p95 {:.2f} ms p99 {:.2f} ms, {:.0f} draw calls, written to {}",
+               frame_ms.p50, frame_ms.p95, frame_ms.p99, calls(&glad::CallStats::draw_calls),
+               output);
+  return 0;
+}
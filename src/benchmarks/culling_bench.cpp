@@ -0,0 +1,74 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FrustumCuller.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Measures sphere vs frustum culling throughput of every kernel the cpu
+// supports on random bounds scattered around a camera. No gl context is needed.
+//
+// usage: culling_bench [bounds] [iterations]
+
+namespace {
+constexpr float WORLD_EXTENT = 200.0f;
+constexpr float MAX_RADIUS = 4.0f;
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("culling_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  size_t bound_count = argc > 1 ? std::stoul(argv[1]) : 100'000;
+  int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> coordinate{-WORLD_EXTENT, WORLD_EXTENT};
+  std::uniform_real_distribution<float> radius{0.1f, MAX_RADIUS};
+
+  FrustumCuller culler{};
+  culler.reserve(bound_count);
+  for (size_t i = 0; i < bound_count; i++) {
+    culler.add(BoundingSphere{glm::vec3{coordinate(rng), coordinate(rng), coordinate(rng)},
+                              radius(rng)});
+  }
+
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3{0.0f}, glm::vec3{1.0f, 0.2f, -1.0f},
+                               glm::vec3{0.0f, 1.0f, 0.0f});
+  auto frustum = Frustum::from_matrix(projection * view);
+
+  spdlog::info("{} bounds, {} iterations", bound_count, iterations);
+
+  std::vector<uint32_t> visible{};
+  std::vector<uint32_t> reference{};
+  culler.set_kernel(FrustumCuller::Kernel::Scalar);
+  culler.cull(frustum, reference);
+
+  for (auto kernel : {FrustumCuller::Kernel::Scalar, FrustumCuller::Kernel::Sse,
+                      FrustumCuller::Kernel::Avx}) {
+    if (!FrustumCuller::supported(kernel)) {
+      spdlog::info("{:>6}: not supported", FrustumCuller::kernel_name(kernel));
+      continue;
+    }
+    culler.set_kernel(kernel);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      culler.cull(frustum, visible);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    spdlog::info("{:>6}: {:.3f} ms per pass, {:.0f} bounds/ms, {} visible{}",
+                 FrustumCuller::kernel_name(kernel), ms, bound_count / ms, visible.size(),
+                 visible == reference ? "" : " (MISMATCH)");
+  }
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LightClusters.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+#include "utils/ThreadPool.hpp"
+
+// Bins growing numbers of point lights into the clusters of a 1080p view while
+// the camera orbits through them, scalar vs sse and one thread vs the pool.
+// Only the cpu side is measured, no gl context is needed.
+//
+// usage: light_binning_bench [max light count] [frames]
+
+namespace {
+constexpr glm::vec2 VIEWPORT{1920.0f, 1080.0f};
+constexpr float SCENE_SIZE = 60.0f;
+
+std::vector<ClusterLight> make_lights(size_t count) {
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<float> position{-SCENE_SIZE / 2.0f, SCENE_SIZE / 2.0f};
+  std::uniform_real_distribution<float> radius{1.0f, 4.0f};
+  std::vector<ClusterLight> lights{};
+  for (size_t i = 0; i < count; i++) {
+    lights.push_back(ClusterLight{
+      .position = {position(rng), position(rng) * 0.1f, position(rng)},
+      .radius = radius(rng),
+      .color = glm::vec3{1.0f},
+      .intensity = 1.0f,
+    });
+  }
+  return lights;
+}
+
+struct BinResult {
+  double ms_per_frame;
+  double references_per_frame;
+  uint32_t max_cluster_lights;
+};
+
+BinResult run(const std::vector<ClusterLight>& lights, const ClusterArgs& args, int frames) {
+  LightClusters clusters{args};
+  clusters.set_projection(glm::radians(60.0f), 0.1f, 200.0f, VIEWPORT);
+
+  BinResult result{};
+  for (int frame = 0; frame < frames; frame++) {
+    float angle = glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(frames);
+    glm::vec3 eye{glm::cos(angle) * SCENE_SIZE * 0.3f, 2.0f, glm::sin(angle) * SCENE_SIZE * 0.3f};
+    clusters.bin(lights, glm::lookAt(eye, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}));
+
+    auto& stats = clusters.stats();
+    result.ms_per_frame += stats.bin_ms / frames;
+    result.references_per_frame += static_cast<double>(stats.references) / frames;
+    result.max_cluster_lights = std::max(result.max_cluster_lights, stats.max_cluster_lights);
+  }
+  return result;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("light_binning_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  size_t max_lights = argc > 1 ? std::stoul(argv[1]) : 16384;
+  int frames = argc > 2 ? std::stoi(argv[2]) : 120;
+
+  ClusterArgs defaults{};
+  spdlog::info("{}x{}x{} clusters, {} worker threads, {} frames per run", defaults.tiles_x,
+               defaults.tiles_y, defaults.slices, ThreadPool::shared().thread_count(), frames);
+  spdlog::info("{:>7} {:>10} {:>10} {:>10} {:>10} {:>12} {:>8}", "lights", "scalar", "sse",
+               "scalar mt", "sse mt", "refs/frame", "max");
+
+  for (size_t count = 256; count <= max_lights; count *= 2) {
+    auto lights = make_lights(count);
+    auto scalar = run(lights, ClusterArgs{.simd = false, .parallel = false}, frames);
+    auto sse = run(lights, ClusterArgs{.simd = true, .parallel = false}, frames);
+    auto scalar_mt = run(lights, ClusterArgs{.simd = false, .parallel = true}, frames);
+    auto sse_mt = run(lights, ClusterArgs{.simd = true, .parallel = true}, frames);
+    spdlog::info("{:>7} {:>7.3f} ms {:>7.3f} ms {:>7.3f} ms {:>7.3f} ms {:>12.0f} {:>8}", count,
+                 scalar.ms_per_frame, sse.ms_per_frame, scalar_mt.ms_per_frame,
+                 sse_mt.ms_per_frame, sse_mt.references_per_frame, sse_mt.max_cluster_lights);
+  }
+
+  return 0;
+}
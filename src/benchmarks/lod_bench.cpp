@@ -0,0 +1,114 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Model.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Builds the lod chain of a model and flies a camera over a grid of copies,
+// reporting the triangles that would be submitted per frame with lod selection
+// on and off. No gl context is needed.
+//
+// usage: lod_bench [model path] [grid size] [frames]
+
+namespace {
+constexpr float GRID_SPACING = 4.0f;
+constexpr float VIEWPORT_HEIGHT = 1080.0f;
+
+struct FlightResult {
+  double triangles_per_frame;
+  size_t lod_switches;
+};
+
+FlightResult fly(const std::vector<MeshData>& meshes, uint32_t grid_size, int frames,
+                 const LodSettings& settings) {
+  std::vector<BoundingSphere> spheres{};
+  for (auto& mesh : meshes) {
+    spheres.push_back(compute_bounds(mesh.vertices).sphere);
+  }
+
+  // lod state per copy and mesh, like one Model per grid cell
+  std::vector<uint32_t> lods(grid_size * grid_size * meshes.size());
+  size_t triangles{};
+  size_t switches{};
+  for (int frame = 0; frame < frames; frame++) {
+    // dolly from inside the grid to far above it and back
+    float t = static_cast<float>(frame) / static_cast<float>(frames - 1);
+    float height = 2.0f + 300.0f * (1.0f - std::abs(2.0f * t - 1.0f));
+    glm::vec3 camera{0.0f, height, 0.0f};
+
+    size_t state{};
+    for (uint32_t x = 0; x < grid_size; x++) {
+      for (uint32_t z = 0; z < grid_size; z++) {
+        glm::vec3 offset = glm::vec3{float(x) - float(grid_size) / 2.0f, 0.0f,
+                                     float(z) - float(grid_size) / 2.0f} * GRID_SPACING;
+        for (size_t m = 0; m < meshes.size(); m++, state++) {
+          float distance = glm::length(spheres[m].center + offset - camera) - spheres[m].radius;
+          auto lod = select_lod(meshes[m].lods, lods[state], distance, 1.0f, settings);
+          switches += lod != lods[state];
+          lods[state] = lod;
+          triangles += meshes[m].lods[lod].index_count / 3;
+        }
+      }
+    }
+  }
+  return FlightResult{static_cast<double>(triangles) / frames, switches};
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("lod_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  std::string path = argc > 1 ? argv[1] : "../../resources/backpack/backpack.obj";
+  uint32_t grid_size = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 16;
+  // the flight needs a first and a last frame
+  int frames = std::max(argc > 3 ? std::stoi(argv[3]) : 600, 2);
+
+  auto model = Model::import_model(path);
+  if (!model) {
+    return -1;
+  }
+  optimize_meshes(model->meshes);
+
+  auto start = std::chrono::steady_clock::now();
+  generate_lods(model->meshes);
+  auto end = std::chrono::steady_clock::now();
+
+  std::vector<size_t> level_triangles{};
+  for (auto& mesh : model->meshes) {
+    for (size_t level = 0; level < mesh.lods.size(); level++) {
+      level_triangles.resize(std::max(level_triangles.size(), level + 1));
+      level_triangles[level] += mesh.lods[level].index_count / 3;
+    }
+  }
+  spdlog::info("{}: {} meshes, lods generated in {:.2f} ms", path, model->meshes.size(),
+               std::chrono::duration<double, std::milli>(end - start).count());
+  for (size_t level = 0; level < level_triangles.size(); level++) {
+    spdlog::info("  lod {}: {} triangles", level, level_triangles[level]);
+  }
+
+  LodSettings settings{.viewport_height = VIEWPORT_HEIGHT};
+  auto off = fly(model->meshes, grid_size, frames, LodSettings{.enabled = false});
+  auto on = fly(model->meshes, grid_size, frames, settings);
+  auto no_hysteresis =
+    fly(model->meshes, grid_size, frames,
+        LodSettings{.viewport_height = VIEWPORT_HEIGHT, .hysteresis = 0.0f});
+
+  spdlog::info("{}x{} copies, {} frames, max {:.1f} px error", grid_size, grid_size, frames,
+               settings.max_pixel_error);
+  spdlog::info("lod off: {:.0f} triangles per frame", off.triangles_per_frame);
+  spdlog::info("lod on:  {:.0f} triangles per frame ({:.1f}% of off), {} lod switches",
+               on.triangles_per_frame, 100.0 * on.triangles_per_frame / off.triangles_per_frame,
+               on.lod_switches);
+  spdlog::info("without hysteresis: {} lod switches", no_hysteresis.lod_switches);
+
+  return 0;
+}
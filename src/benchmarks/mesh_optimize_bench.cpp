@@ -0,0 +1,117 @@
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Model.hpp"
+#include "MeshOptimizer.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Reports post-transform cache efficiency before and after the import time
+// optimization pass, for a model file and a shuffled synthetic grid.
+// No gl context is needed.
+//
+// usage: mesh_optimize_bench [model path] [grid size] [cache size]
+
+namespace {
+struct Totals {
+  size_t vertices;
+  size_t triangles;
+  double misses;
+  double referenced;
+};
+
+Totals measure(const std::vector<MeshData>& meshes, uint32_t cache_size) {
+  Totals totals{};
+  for (auto& mesh : meshes) {
+    auto stats = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size);
+    double triangles = static_cast<double>(mesh.indices.size() / 3);
+    double misses = stats.acmr * triangles;
+    totals.vertices += mesh.vertices.size();
+    totals.triangles += mesh.indices.size() / 3;
+    totals.misses += misses;
+    totals.referenced += stats.atvr > 0.0f ? misses / stats.atvr : 0.0;
+  }
+  return totals;
+}
+
+// triangle soup of a size x size quad grid in random order, every corner is
+// duplicated the way a non indexed export would be
+MeshData synthetic_grid(uint32_t size) {
+  std::vector<Vertex> corners{};
+  corners.reserve((size + 1) * (size + 1));
+  for (uint32_t y = 0; y <= size; y++) {
+    for (uint32_t x = 0; x <= size; x++) {
+      Vertex vertex{};
+      vertex.Position = glm::vec3{float(x), 0.0f, float(y)};
+      vertex.Normal = glm::vec3{0.0f, 1.0f, 0.0f};
+      vertex.TexCoords = glm::vec2{float(x), float(y)} / float(size);
+      corners.push_back(vertex);
+    }
+  }
+
+  std::vector<std::array<uint32_t, 3>> triangles{};
+  triangles.reserve(size * size * 2);
+  for (uint32_t y = 0; y < size; y++) {
+    for (uint32_t x = 0; x < size; x++) {
+      uint32_t i = y * (size + 1) + x;
+      triangles.push_back({i, i + size + 1, i + 1});
+      triangles.push_back({i + 1, i + size + 1, i + size + 2});
+    }
+  }
+  std::ranges::shuffle(triangles, std::mt19937{42});
+
+  MeshData mesh{};
+  for (auto& triangle : triangles) {
+    for (auto corner : triangle) {
+      mesh.indices.push_back(static_cast<unsigned int>(mesh.vertices.size()));
+      mesh.vertices.push_back(corners[corner]);
+    }
+  }
+  return mesh;
+}
+
+void report(std::string_view name, std::vector<MeshData> meshes, uint32_t cache_size) {
+  auto before = measure(meshes, cache_size);
+
+  auto start = std::chrono::steady_clock::now();
+  optimize_meshes(meshes, MeshOptimizeArgs{.cache_size = cache_size});
+  auto end = std::chrono::steady_clock::now();
+
+  auto after = measure(meshes, cache_size);
+  auto ratio = [](double lhs, double rhs) { return rhs > 0.0 ? lhs / rhs : 0.0; };
+
+  spdlog::info("{}: {} meshes, {} triangles, optimized in {:.2f} ms", name, meshes.size(),
+               before.triangles,
+               std::chrono::duration<double, std::milli>(end - start).count());
+  spdlog::info("  vertices {} -> {}", before.vertices, after.vertices);
+  spdlog::info("  ACMR {:.3f} -> {:.3f}", ratio(before.misses, before.triangles),
+               ratio(after.misses, after.triangles));
+  spdlog::info("  ATVR {:.3f} -> {:.3f}", ratio(before.misses, before.referenced),
+               ratio(after.misses, after.referenced));
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("mesh_optimize_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  std::string path = argc > 1 ? argv[1] : "../../resources/backpack/backpack.obj";
+  uint32_t grid_size = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 512;
+  uint32_t cache_size = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 16;
+
+  spdlog::info("FIFO cache of {} vertices", cache_size);
+  if (auto model = Model::import_model(path)) {
+    report(path, std::move(model->meshes), cache_size);
+  }
+  report(std::format("grid {0}x{0}", grid_size), {synthetic_grid(grid_size)}, cache_size);
+
+  return 0;
+}
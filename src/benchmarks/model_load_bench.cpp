@@ -0,0 +1,91 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "Model.hpp"
+#include "MeshCache.hpp"
+#include "utils/Hash.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Compares the cpu side of Model loading: assimp parse of the source file
+// against opening the binary mesh cache. No gl context is needed.
+//
+// usage: model_load_bench [model path] [iterations]
+
+template <typename Func>
+double average_ms(int iterations, Func&& func) {
+  double total{};
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    total += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+  return total / iterations;
+}
+
+int main(int argc, char** argv) {
+  Logger::init("model_load_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  std::string path = argc > 1 ? argv[1] : "../../resources/backpack/backpack.obj";
+  int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+  auto model = Model::import_model(path);
+  if (!model) {
+    return -1;
+  }
+  auto& meshes = model->meshes;
+
+  size_t vertex_count{};
+  size_t index_count{};
+  for (auto& mesh : meshes) {
+    vertex_count += mesh.vertices.size();
+    index_count += mesh.indices.size();
+  }
+
+  // separate file, Model keys its cache on the import options as well
+  auto cache_path = std::format("{}.bench", MeshCache::cache_path(path));
+  MeshCache::write(cache_path, 0, *model);
+
+  double import_ms = average_ms(iterations, [&] {
+    auto result = Model::import_model(path);
+  });
+
+  // hashing the source and touching every vertex/index byte mirrors what the
+  // upload from the mapping has to read
+  uint64_t checksum{};
+  double cache_ms = average_ms(iterations, [&] {
+    auto cache = MeshCache::open(cache_path, 0);
+    if (!cache) {
+      return;
+    }
+    for (size_t i = 0; i < cache->mesh_count(); i++) {
+      auto view = cache->mesh(i);
+      checksum ^= hash_bytes(std::as_bytes(view.vertices));
+      checksum ^= hash_bytes(std::as_bytes(view.indices));
+    }
+  });
+
+  size_t packed_bytes{};
+  double pack_ms = average_ms(iterations, [&] {
+    packed_bytes = 0;
+    for (auto& mesh : meshes) {
+      packed_bytes += pack_vertices(mesh.vertices).size() * sizeof(PackedVertex);
+    }
+  });
+
+  spdlog::info("{}: {} meshes, {} vertices, {} indices", path, meshes.size(), vertex_count,
+               index_count);
+  spdlog::info("vertex data:   {} KiB full, {} KiB packed, packing {:.2f} ms",
+               vertex_count * sizeof(Vertex) / 1024, packed_bytes / 1024, pack_ms);
+  spdlog::info("assimp import: {:.2f} ms", import_ms);
+  spdlog::info("mesh cache:    {:.2f} ms (checksum {:016x})", cache_ms, checksum);
+  spdlog::info("speedup:       {:.1f}x", import_ms / cache_ms);
+
+  return 0;
+}
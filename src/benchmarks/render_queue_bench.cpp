@@ -0,0 +1,113 @@
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RenderQueue.hpp"
+#include "utils/Hash.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Sorts and walks a frame of random draw packets without a gl context and
+// compares the state changes against submitting them in recording order.
+//
+// usage: render_queue_bench [packets] [frames]
+
+namespace {
+constexpr uint32_t PROGRAM_COUNT = 8;
+constexpr uint32_t MATERIAL_COUNT = 256;
+constexpr uint32_t VAO_COUNT = 1024;
+constexpr float TRANSPARENT_RATIO = 0.1f;
+
+// built like Mesh::packet, hash_combine over the texture addresses and sampler names
+uint64_t mesh_material(uint32_t id) {
+  // the textures of a model are allocated close to each other
+  uintptr_t texture = 0x5555'0000'0000ull + static_cast<uintptr_t>(id) * 512;
+  uint64_t material{};
+  material = hash_combine(material, texture);
+  material = hash_combine(material, hash_string("texture_diffuse1"));
+  material = hash_combine(material, texture + 256);
+  material = hash_combine(material, hash_string("texture_specular1"));
+  return material;
+}
+
+// state changes when every packet is issued in the order it was recorded
+size_t unsorted_binds(const std::vector<DrawPacket>& packets) {
+  size_t binds{};
+  const DrawPacket* last = nullptr;
+  for (auto& packet : packets) {
+    binds += !last || last->program != packet.program;
+    binds += !last || last->program != packet.program || last->material != packet.material;
+    binds += !last || last->vao != packet.vao;
+    last = &packet;
+  }
+  return binds;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("render_queue_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  size_t packet_count = argc > 1 ? std::stoul(argv[1]) : 100'000;
+  int frames = argc > 2 ? std::stoi(argv[2]) : 20;
+
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<uint32_t> program{1, PROGRAM_COUNT};
+  std::uniform_int_distribution<uint32_t> material{0, MATERIAL_COUNT - 1};
+  std::uniform_int_distribution<uint32_t> vao{1, VAO_COUNT};
+  std::uniform_real_distribution<float> depth{0.1f, 100.0f};
+  std::uniform_real_distribution<float> chance{0.0f, 1.0f};
+
+  std::vector<DrawPacket> packets(packet_count);
+  for (auto& packet : packets) {
+    packet.program = program(rng);
+    packet.material = mesh_material(material(rng));
+    packet.vao = vao(rng);
+    packet.index_count = 36;
+    packet.depth = depth(rng);
+    packet.layer = chance(rng) < TRANSPARENT_RATIO ? RenderLayer::Transparent
+                                                   : RenderLayer::Opaque;
+  }
+
+  RenderQueue queue{};
+  double push_ms{};
+  double total_ms{};
+  for (int frame = 0; frame < frames; frame++) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto& packet : packets) {
+      queue.push(packet);
+    }
+    auto pushed = std::chrono::steady_clock::now();
+    queue.submit(false);
+    auto end = std::chrono::steady_clock::now();
+
+    push_ms += std::chrono::duration<double, std::milli>(pushed - start).count();
+    total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  // reference: comparison sort of the same keys
+  std::vector<uint64_t> keys(packet_count);
+  double std_sort_ms{};
+  for (int frame = 0; frame < frames; frame++) {
+    std::ranges::transform(packets, keys.begin(), RenderQueue::sort_key);
+    auto start = std::chrono::steady_clock::now();
+    std::ranges::sort(keys);
+    auto end = std::chrono::steady_clock::now();
+    std_sort_ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  auto& stats = queue.stats();
+  size_t sorted_binds = stats.program_binds + stats.material_binds + stats.vao_binds;
+  spdlog::info("{} packets, {} frames", packet_count, frames);
+  spdlog::info("push {:.3f} ms, radix sort {:.3f} ms (std::sort {:.3f} ms), push + sort + walk {:.3f} ms per frame",
+               push_ms / frames, stats.sort_ms, std_sort_ms / frames, total_ms / frames);
+  spdlog::info("state changes: {} unsorted, {} sorted ({} program, {} material, {} vao)",
+               unsorted_binds(packets), sorted_binds, stats.program_binds, stats.material_binds,
+               stats.vao_binds);
+
+  return 0;
+}
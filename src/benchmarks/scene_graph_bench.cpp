@@ -0,0 +1,92 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SceneGraph.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Updates a large transform hierarchy where a small share of the nodes moves
+// every frame and compares it against recomputing every world matrix.
+// No gl context is needed.
+//
+// usage: scene_graph_bench [nodes] [dirty percent] [frames]
+
+namespace {
+// breadth first tree, node i hangs below (i - 1) / BRANCHING
+constexpr uint32_t BRANCHING = 4;
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("scene_graph_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  size_t node_count = argc > 1 ? std::stoul(argv[1]) : 100'000;
+  double dirty_percent = argc > 2 ? std::stod(argv[2]) : 1.0;
+  int frames = argc > 3 ? std::stoi(argv[3]) : 200;
+
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> offset{-1.0f, 1.0f};
+  std::uniform_int_distribution<uint32_t> pick{0, static_cast<uint32_t>(node_count - 1)};
+
+  SceneGraph scene{};
+  scene.reserve(node_count);
+  for (size_t i = 0; i < node_count; i++) {
+    auto parent = i == 0 ? SceneGraph::NO_PARENT : static_cast<uint32_t>((i - 1) / BRANCHING);
+    scene.add_node(glm::translate(glm::mat4{1.0f}, glm::vec3{offset(rng), offset(rng), offset(rng)}),
+                   parent);
+  }
+  scene.update();
+
+  auto dirty_count = static_cast<size_t>(static_cast<double>(node_count) * dirty_percent / 100.0);
+  std::vector<uint32_t> dirty_nodes(dirty_count);
+
+  double incremental_ms{};
+  size_t recomputed{};
+  for (int frame = 0; frame < frames; frame++) {
+    for (auto& node : dirty_nodes) {
+      node = pick(rng);
+    }
+    float angle = static_cast<float>(frame) * 0.01f;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto node : dirty_nodes) {
+      scene.set_local(node, glm::rotate(scene.local(node), angle, glm::vec3{0.0f, 1.0f, 0.0f}));
+    }
+    recomputed += scene.update();
+    auto end = std::chrono::steady_clock::now();
+    incremental_ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  // reference: every world matrix from scratch, what the examples did per frame
+  std::vector<glm::mat4> world(node_count);
+  double full_ms{};
+  for (int frame = 0; frame < frames; frame++) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < node_count; i++) {
+      auto parent = scene.parent(static_cast<uint32_t>(i));
+      auto& local = scene.local(static_cast<uint32_t>(i));
+      world[i] = parent == SceneGraph::NO_PARENT ? local : world[parent] * local;
+    }
+    auto end = std::chrono::steady_clock::now();
+    full_ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  size_t mismatched{};
+  for (size_t i = 0; i < node_count; i++) {
+    mismatched += world[i] != scene.world(static_cast<uint32_t>(i));
+  }
+
+  spdlog::info("{} nodes, {} dirty per frame, {} frames", node_count, dirty_count, frames);
+  spdlog::info("incremental: {:.3f} ms per frame, {:.0f} world matrices recomputed per frame",
+               incremental_ms / frames, static_cast<double>(recomputed) / frames);
+  spdlog::info("full:        {:.3f} ms per frame, {} world matrices", full_ms / frames, node_count);
+  spdlog::info("speedup:     {:.1f}x, {} mismatched world matrices", full_ms / incremental_ms,
+               mismatched);
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Shader.hpp"
+#include "ProgramCache.hpp"
+#include "glfw_wrapper.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Builds every program of a shader directory (each .vert with the .frag of the
+// same name) without the program cache, with a cold cache and with a warm one.
+// The driver may keep its own shader cache, compare the first run after a reboot
+// or disable it (MESA_SHADER_CACHE_DISABLE=1, __GL_SHADER_DISK_CACHE=0) for
+// cold compile times.
+//
+// usage: shader_startup_bench [shader directory] [rounds]
+
+namespace {
+struct ShaderPair {
+  std::string vertex;
+  std::string fragment;
+};
+
+std::vector<ShaderPair> find_programs(const std::filesystem::path& directory) {
+  std::vector<ShaderPair> programs{};
+  for (auto& entry : std::filesystem::recursive_directory_iterator{directory}) {
+    if (entry.path().extension() != ".vert") {
+      continue;
+    }
+    auto fragment = entry.path();
+    fragment.replace_extension(".frag");
+    if (std::filesystem::exists(fragment)) {
+      programs.push_back(ShaderPair{entry.path().string(), fragment.string()});
+    }
+  }
+  return programs;
+}
+
+double build_all(const std::vector<ShaderPair>& programs) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<Shader>> shaders{};
+  for (auto& program : programs) {
+    shaders.push_back(std::make_unique<Shader>(program.vertex, program.fragment));
+  }
+  glFinish();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("shader_startup_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  std::filesystem::path directory = argc > 1 ? argv[1] : "../../shader";
+  int rounds = argc > 2 ? std::stoi(argv[2]) : 5;
+
+  glfw::window window{"shader_startup_bench", 800, 600};
+  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+    spdlog::error("Failed to initialize GLAD");
+    return -1;
+  }
+
+  auto programs = find_programs(directory);
+  spdlog::info("{} programs in {}", programs.size(), directory.string());
+
+  auto& cache = ProgramCache::instance();
+  cache.set_directory("shader_cache_bench");
+  cache.clear();
+
+  cache.set_enabled(false);
+  double uncached{};
+  for (int i = 0; i < rounds; i++) {
+    uncached += build_all(programs) / rounds;
+  }
+
+  cache.set_enabled(true);
+  cache.reset_stats();
+  double cold = build_all(programs);
+  if (!cache.enabled()) {
+    spdlog::info("no cache {:.2f} ms, program binaries unsupported", uncached);
+    return 0;
+  }
+
+  double warm{};
+  for (int i = 0; i < rounds; i++) {
+    warm += build_all(programs) / rounds;
+  }
+
+  auto stats = cache.stats();
+  spdlog::info("no cache   {:>8.2f} ms", uncached);
+  spdlog::info("cold cache {:>8.2f} ms (compile + store)", cold);
+  spdlog::info("warm cache {:>8.2f} ms ({:.1f}x faster than no cache)", warm, uncached / warm);
+  spdlog::info("{} hits, {} misses, {} rejected, {} stored", stats.hits, stats.misses,
+               stats.rejected, stats.stores);
+
+  cache.clear();
+  return 0;
+}
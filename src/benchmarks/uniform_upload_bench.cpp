@@ -0,0 +1,208 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "Shader.hpp"
+#include "glfw_wrapper.hpp"
+#include "glad_wrapper.hpp"
+#include "UniformBlocks.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Guard.hpp"
+
+// Counts the gl calls of one frame of the light example, once with every
+// camera/light value set per program through glUniform* (shader/benchmark/legacy)
+// and once with the Camera/Lights uniform buffers and instanced cubes.
+//
+// usage: uniform_upload_bench [frames]
+
+namespace {
+constexpr int CUBE_COUNT = 10;
+
+struct FrameResult {
+  glad::CallStats calls;
+  double cpu_ms;
+};
+
+template <typename Func>
+FrameResult run_frames(int frames, Func&& frame) {
+  glad::reset_call_stats();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    frame(i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  glFinish();
+
+  auto stats = glad::call_stats();
+  stats.uniform_uploads /= frames;
+  stats.buffer_uploads /= frames;
+  stats.draw_calls /= frames;
+  stats.binds /= frames;
+  stats.elided_binds /= frames;
+  return {stats, std::chrono::duration<double, std::milli>(end - start).count() / frames};
+}
+
+void report(std::string_view name, const FrameResult& result) {
+  spdlog::info("{:<14} {:>4} gl calls/frame ({} uniform, {} buffer, {} draw, {} bind, {} bind elided), "
+               "{:.3f} ms cpu/frame",
+               name, result.calls.total(), result.calls.uniform_uploads,
+               result.calls.buffer_uploads, result.calls.draw_calls, result.calls.binds,
+               result.calls.elided_binds, result.cpu_ms);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Logger::init("uniform_upload_bench");
+  Guard guard{[] { Logger::shutdown(); }};
+
+  int frames = argc > 1 ? std::stoi(argv[1]) : 1000;
+
+  glfw::window window{"uniform_upload_bench", 800, 600};
+  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+    spdlog::error("Failed to initialize GLAD");
+    return -1;
+  }
+
+  // clang-format off
+  float vertices[] = {
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+  };
+  // clang-format on
+
+  auto layout = std::make_shared<glad::VertexBufferLayout>(
+    std::vector<glad::VertexAttribute>{
+      {0, "Position", glad::ArrtibuteType::Position},
+      {1, "Normal", glad::ArrtibuteType::Normal},
+      {2, "TexCoords", glad::ArrtibuteType::TexCoords}
+    });
+  glad::VertexArray<float> vao{};
+  vao.bind();
+  vao.set_vbo(vertices, layout);
+
+  auto projection = glm::perspective(glm::radians(45.0f), window.aspect_ratio(), 0.1f, 100.0f);
+  auto view_at = [](int frame) {
+    auto position = glm::vec3{std::sin(frame * 0.01f), 0.0f, 3.0f};
+    return std::pair{position, glm::lookAt(position, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f})};
+  };
+
+  FrameResult legacy{};
+  {
+    Shader lighting_shader{
+      "../../shader/benchmark/legacy/color.vert",
+      "../../shader/benchmark/legacy/color.frag"};
+    Shader lightcube_shader{
+      "../../shader/benchmark/legacy/light_cube.vert",
+      "../../shader/light/light_cube.frag"};
+
+    legacy = run_frames(frames, [&](int frame) {
+      auto [position, view] = view_at(frame);
+
+      lighting_shader.use();
+      lighting_shader.set_vec3("viewPos", position);
+      lighting_shader.set_float("material.shininess", 32.0f);
+      lighting_shader.set_vec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+      lighting_shader.set_vec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+      lighting_shader.set_vec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+      lighting_shader.set_vec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+      for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+        lighting_shader.set_vec3(std::format("pointLights[{}].position", i), glm::vec3{float(i)});
+        lighting_shader.set_vec3(std::format("pointLights[{}].ambient", i), 0.05f, 0.05f, 0.05f);
+        lighting_shader.set_vec3(std::format("pointLights[{}].diffuse", i), 0.8f, 0.8f, 0.8f);
+        lighting_shader.set_vec3(std::format("pointLights[{}].specular", i), 1.0f, 1.0f, 1.0f);
+        lighting_shader.set_float(std::format("pointLights[{}].constant", i), 1.0f);
+        lighting_shader.set_float(std::format("pointLights[{}].linear", i), 0.09f);
+        lighting_shader.set_float(std::format("pointLights[{}].quadratic", i), 0.032f);
+      }
+      lighting_shader.set_vec3("spotLight.position", position);
+      lighting_shader.set_vec3("spotLight.direction", -position);
+      lighting_shader.set_vec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+      lighting_shader.set_vec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+      lighting_shader.set_vec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
+      lighting_shader.set_float("spotLight.constant", 1.0f);
+      lighting_shader.set_float("spotLight.linear", 0.09f);
+      lighting_shader.set_float("spotLight.quadratic", 0.032f);
+      lighting_shader.set_float("spotLight.cutOff", 0.97f);
+      lighting_shader.set_float("spotLight.outerCutOff", 0.96f);
+      lighting_shader.set_mat4("projection", projection);
+      lighting_shader.set_mat4("view", view);
+      vao.bind();
+      for (int i = 0; i < CUBE_COUNT; i++) {
+        lighting_shader.set_mat4("model", glm::translate(glm::mat4{1.0f}, glm::vec3{float(i)}));
+        vao.draw_arrays(glad::DrawMode::Triangles, 0, 3);
+      }
+
+      lightcube_shader.use();
+      lightcube_shader.set_mat4("projection", projection);
+      lightcube_shader.set_mat4("view", view);
+      for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+        lightcube_shader.set_mat4("model", glm::translate(glm::mat4{1.0f}, glm::vec3{float(i)}));
+        vao.draw_arrays(glad::DrawMode::Triangles, 0, 3);
+      }
+    });
+  }
+
+  FrameResult ubo{};
+  {
+    Shader lighting_shader{"../../shader/light/color.vert", "../../shader/light/color.frag"};
+    Shader lightcube_shader{"../../shader/light/light_cube.vert", "../../shader/light/light_cube.frag"};
+    lighting_shader.use();
+    lighting_shader.set_float("material.shininess", 32.0f);
+
+    glad::UniformBuffer camera_ubo{CameraBlock::NAME};
+    glad::UniformBuffer lights_ubo{LightsBlock::NAME};
+    LightsBlock lights{};
+
+    std::vector<glm::mat4> cube_models{};
+    for (int i = 0; i < CUBE_COUNT; i++) {
+      cube_models.push_back(glm::translate(glm::mat4{1.0f}, glm::vec3{float(i)}));
+    }
+    std::vector<glm::mat4> lightcube_models(cube_models.begin(),
+                                            cube_models.begin() + MAX_POINT_LIGHTS);
+
+    auto instance_layout = std::make_shared<glad::VertexBufferLayout>(
+      std::vector<glad::VertexAttribute>{
+        {3, "Model", glad::ArrtibuteType::Mat4}
+      });
+    glad::VertexArray<float> cube_vao{};
+    cube_vao.bind();
+    cube_vao.set_vbo(vao.vbo());
+    cube_vao.add_instance_vbo(
+      std::make_shared<glad::VertexBuffer<glm::mat4>>(cube_models, instance_layout));
+
+    glad::VertexArray<float> lightcube_vao{};
+    lightcube_vao.bind();
+    lightcube_vao.set_vbo(vao.vbo());
+    lightcube_vao.add_instance_vbo(
+      std::make_shared<glad::VertexBuffer<glm::mat4>>(lightcube_models, instance_layout));
+
+    ubo = run_frames(frames, [&](int frame) {
+      auto [position, view] = view_at(frame);
+      camera_ubo.update(CameraBlock{projection, view, position});
+      lights.spot_light.position = position;
+      lights.spot_light.direction = -position;
+      lights_ubo.update(lights);
+
+      lighting_shader.use();
+      cube_vao.bind();
+      cube_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 3, CUBE_COUNT);
+
+      lightcube_shader.use();
+      lightcube_vao.bind();
+      lightcube_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 3, MAX_POINT_LIGHTS);
+    });
+  }
+
+  spdlog::info("{} frames", frames);
+  report("per-uniform", legacy);
+  report("ubo+instanced", ubo);
+
+  return 0;
+}
@@ -0,0 +1,404 @@
+#include "Profiler.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <utility>
+
+// single producer (the owning thread), single consumer (end_frame) ring
+struct Profiler::ThreadBuffer {
+  std::array<CpuZoneEvent, THREAD_CAPACITY> events{};
+  std::atomic<uint64_t> head{};
+  std::atomic<uint64_t> tail{};
+  std::atomic<uint64_t> dropped{};
+  uint32_t id{};
+  // threads_mutex_ held
+  std::string name{};
+
+  void push(const CpuZoneEvent& event) {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == THREAD_CAPACITY) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    events[h % THREAD_CAPACITY] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  void drain(std::vector<CpuZoneEvent>& out) {
+    auto t = tail.load(std::memory_order_relaxed);
+    auto h = head.load(std::memory_order_acquire);
+    for (; t < h; t++) {
+      out.push_back(events[t % THREAD_CAPACITY]);
+    }
+    tail.store(t, std::memory_order_release);
+  }
+};
+
+namespace {
+// trace tracks besides the threads, thread ids start after them
+constexpr uint32_t FRAME_TRACK = 0;
+constexpr uint32_t GPU_TRACK = 1;
+constexpr uint32_t FIRST_THREAD = 2;
+
+double to_ms(int64_t ns) {
+  return static_cast<double>(ns) / 1e6;
+}
+
+void append_json_string(std::string& out, std::string_view text) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<int>(c));
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+} // namespace
+
+Percentiles percentiles(std::vector<double> values) {
+  if (values.empty()) {
+    return {};
+  }
+  std::ranges::sort(values);
+  auto rank = [&](double p) {
+    auto index = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+    return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+  };
+  return Percentiles{
+    .p50 = rank(0.50),
+    .p95 = rank(0.95),
+    .p99 = rank(0.99),
+    .max = values.back(),
+  };
+}
+
+Profiler::CpuZone::CpuZone(const char* name) : name_(name), start_ns_(now_ns()) {}
+
+Profiler::CpuZone::~CpuZone() {
+  auto& buffer = instance().thread_buffer();
+  buffer.push(CpuZoneEvent{
+    .name = name_,
+    .start_ns = start_ns_,
+    .end_ns = now_ns(),
+    .thread = buffer.id,
+  });
+}
+
+Profiler::GpuZone::GpuZone(const char* name) : active_(instance().begin_gpu_zone(name)) {}
+
+Profiler::GpuZone::~GpuZone() {
+  if (active_) {
+    instance().end_gpu_zone();
+  }
+}
+
+Profiler& Profiler::instance() {
+  static Profiler profiler{};
+  return profiler;
+}
+
+int64_t Profiler::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+Profiler::Profiler() : frame_start_ns_(now_ns()), pending_(GPU_QUERIES) {}
+
+// the query names belong to the gl context, which is gone by the time statics are destroyed
+Profiler::~Profiler() = default;
+
+auto Profiler::thread_buffer() -> ThreadBuffer& {
+  // buffers are owned by the profiler, zones of an exited thread are still collected
+  // and its buffer goes to the next new thread
+  struct Slot {
+    ThreadBuffer* buffer{};
+    ~Slot() {
+      if (buffer) {
+        auto& profiler = instance();
+        std::lock_guard lock{profiler.threads_mutex_};
+        profiler.free_threads_.push_back(buffer);
+      }
+    }
+  };
+  thread_local Slot slot{};
+
+  if (!slot.buffer) {
+    std::lock_guard lock{threads_mutex_};
+    if (free_threads_.empty()) {
+      auto& created = threads_.emplace_back(std::make_unique<ThreadBuffer>());
+      created->id = FIRST_THREAD + static_cast<uint32_t>(threads_.size() - 1);
+      free_threads_.push_back(created.get());
+    }
+    slot.buffer = free_threads_.back();
+    free_threads_.pop_back();
+    slot.buffer->name = fmt::format("thread {}", slot.buffer->id - FIRST_THREAD + 1);
+  }
+  return *slot.buffer;
+}
+
+void Profiler::set_thread_name(std::string_view name) {
+  auto& buffer = thread_buffer();
+  std::lock_guard lock{threads_mutex_};
+  buffer.name = name;
+}
+
+bool Profiler::begin_gpu_zone(const char* name) {
+  if (gpu_zone_open_) {
+    return false;
+  }
+  if (query_head_ - query_tail_ == GPU_QUERIES) {
+    dropped_gpu_zones_++;
+    return false;
+  }
+  if (queries_.empty()) {
+    queries_.resize(GPU_QUERIES);
+    glGenQueries(static_cast<GLsizei>(queries_.size()), queries_.data());
+  }
+
+  auto slot = query_head_++ % GPU_QUERIES;
+  pending_[slot] = PendingQuery{.name = name, .submit_ns = now_ns(), .frame = frame_index_};
+  glBeginQuery(GL_TIME_ELAPSED, queries_[slot]);
+  frame_gpu_pending_++;
+  gpu_zone_open_ = true;
+  return true;
+}
+
+void Profiler::end_gpu_zone() {
+  glEndQuery(GL_TIME_ELAPSED);
+  gpu_zone_open_ = false;
+}
+
+void Profiler::end_frame() {
+  auto now = now_ns();
+  ProfiledFrame frame{
+    .index = frame_index_++,
+    .start_ns = frame_start_ns_,
+    .end_ns = now,
+    .cpu_zones = {},
+    .gpu_zones = {},
+    .gpu_ns = 0,
+    .gpu_pending = std::exchange(frame_gpu_pending_, 0),
+  };
+  frame_start_ns_ = now;
+
+  {
+    std::lock_guard lock{threads_mutex_};
+    for (auto& buffer : threads_) {
+      buffer->drain(frame.cpu_zones);
+    }
+  }
+  std::ranges::sort(frame.cpu_zones, {}, &CpuZoneEvent::start_ns);
+
+  std::lock_guard lock{frames_mutex_};
+  frames_.push_back(std::move(frame));
+  if (frames_.size() > HISTORY_FRAMES) {
+    frames_.pop_front();
+  }
+  poll_queries();
+}
+
+void Profiler::poll_queries() {
+  // queries finish in submission order, stop at the first one still in flight
+  while (query_tail_ < query_head_) {
+    auto slot = query_tail_ % GPU_QUERIES;
+    auto& pending = pending_[slot];
+    // the zone is still open or belongs to the frame being recorded
+    if (pending.frame >= frame_index_) {
+      break;
+    }
+    GLint available{};
+    glGetQueryObjectiv(queries_[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 elapsed{};
+    glGetQueryObjectui64v(queries_[slot], GL_QUERY_RESULT, &elapsed);
+    query_tail_++;
+
+    // the frame may have left the history already
+    if (frames_.empty() || pending.frame < frames_.front().index) {
+      continue;
+    }
+    auto& frame = frames_[pending.frame - frames_.front().index];
+    frame.gpu_zones.push_back(GpuZoneEvent{
+      .name = pending.name,
+      .submit_ns = pending.submit_ns,
+      .elapsed_ns = static_cast<int64_t>(elapsed),
+    });
+    frame.gpu_ns += static_cast<int64_t>(elapsed);
+    frame.gpu_pending--;
+  }
+}
+
+ProfilerStats Profiler::stats() const {
+  ProfilerStats stats{};
+  {
+    std::lock_guard lock{threads_mutex_};
+    for (auto& buffer : threads_) {
+      stats.dropped_zones += buffer->dropped.load(std::memory_order_relaxed);
+    }
+  }
+
+  struct Zone {
+    std::vector<double> ms{};
+    size_t calls{};
+  };
+  // (gpu, name) -> per frame totals
+  std::map<std::pair<bool, std::string_view>, Zone> zones{};
+  std::vector<double> cpu_frame{};
+  std::vector<double> gpu_frame{};
+
+  std::lock_guard lock{frames_mutex_};
+  stats.frames = frames_.size();
+  stats.dropped_zones += dropped_gpu_zones_;
+
+  std::map<std::pair<bool, std::string_view>, std::pair<int64_t, size_t>> frame_zones{};
+  for (auto& frame : frames_) {
+    cpu_frame.push_back(to_ms(frame.end_ns - frame.start_ns));
+    if (frame.gpu_pending == 0 && !frame.gpu_zones.empty()) {
+      gpu_frame.push_back(to_ms(frame.gpu_ns));
+    }
+
+    frame_zones.clear();
+    for (auto& zone : frame.cpu_zones) {
+      auto& [ns, calls] = frame_zones[{false, zone.name}];
+      ns += zone.end_ns - zone.start_ns;
+      calls++;
+    }
+    for (auto& zone : frame.gpu_zones) {
+      auto& [ns, calls] = frame_zones[{true, zone.name}];
+      ns += zone.elapsed_ns;
+      calls++;
+    }
+    for (auto& [key, total] : frame_zones) {
+      auto& zone = zones[key];
+      zone.ms.push_back(to_ms(total.first));
+      zone.calls += total.second;
+    }
+  }
+
+  stats.cpu_frame = percentiles(std::move(cpu_frame));
+  stats.gpu_frame = percentiles(std::move(gpu_frame));
+  for (auto& [key, zone] : zones) {
+    stats.zones.push_back(ZoneStats{
+      .name = std::string{key.second},
+      .gpu = key.first,
+      .frames = zone.ms.size(),
+      .calls = zone.calls,
+      .ms = percentiles(std::move(zone.ms)),
+    });
+  }
+  std::ranges::sort(stats.zones, std::greater{}, [](const ZoneStats& zone) { return zone.ms.p95; });
+  return stats;
+}
+
+void Profiler::log_stats() const {
+  auto stats = this->stats();
+  spdlog::info("Profiled {} frames, cpu frame p50 {:.2f} ms p95 {:.2f} ms p99 {:.2f} ms", stats.frames,
+               stats.cpu_frame.p50, stats.cpu_frame.p95, stats.cpu_frame.p99);
+  spdlog::info("gpu frame p50 {:.2f} ms p95 {:.2f} ms p99 {:.2f} ms", stats.gpu_frame.p50,
+               stats.gpu_frame.p95, stats.gpu_frame.p99);
+  for (auto& zone : stats.zones) {
+    spdlog::info("  {} {:<24} {:>8.2f} calls/frame p50 {:.3f} ms p95 {:.3f} ms max {:.3f} ms",
+                 zone.gpu ? "gpu" : "cpu", zone.name,
+                 static_cast<double>(zone.calls) / static_cast<double>(zone.frames), zone.ms.p50,
+                 zone.ms.p95, zone.ms.max);
+  }
+  if (stats.dropped_zones) {
+    spdlog::warn("Profiler dropped {} zones", stats.dropped_zones);
+  }
+}
+
+std::string Profiler::chrome_trace() const {
+  std::string out{};
+  auto it = std::back_inserter(out);
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+  auto separator = [&] {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+  };
+  auto thread_name = [&](uint32_t track, std::string_view name) {
+    separator();
+    fmt::format_to(it, "{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":",
+                   track);
+    append_json_string(out, name);
+    out += "}}";
+  };
+  // complete events, microseconds relative to the oldest frame
+  int64_t origin{};
+  auto complete = [&](std::string_view name, std::string_view category, uint32_t track,
+                      int64_t start_ns, int64_t duration_ns) {
+    separator();
+    out += "{\"ph\":\"X\",\"name\":";
+    append_json_string(out, name);
+    fmt::format_to(it, ",\"cat\":\"{}\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}", category,
+                   track, static_cast<double>(start_ns - origin) / 1e3,
+                   static_cast<double>(duration_ns) / 1e3);
+  };
+
+  thread_name(FRAME_TRACK, "frames");
+  thread_name(GPU_TRACK, "gpu");
+  {
+    std::lock_guard lock{threads_mutex_};
+    for (auto& buffer : threads_) {
+      thread_name(buffer->id, buffer->name);
+    }
+  }
+
+  std::lock_guard lock{frames_mutex_};
+  if (!frames_.empty()) {
+    origin = frames_.front().start_ns;
+  }
+  for (auto& frame : frames_) {
+    complete(fmt::format("frame {}", frame.index), "frame", FRAME_TRACK, frame.start_ns,
+             frame.end_ns - frame.start_ns);
+    for (auto& zone : frame.cpu_zones) {
+      complete(zone.name, "cpu", zone.thread, zone.start_ns, zone.end_ns - zone.start_ns);
+    }
+    // placed at submission, the gpu timeline is not synchronized with the cpu one
+    for (auto& zone : frame.gpu_zones) {
+      complete(zone.name, "gpu", GPU_TRACK, zone.submit_ns, zone.elapsed_ns);
+    }
+  }
+
+  out += "]}";
+  return out;
+}
+
+bool Profiler::write_chrome_trace(const std::filesystem::path& path) const {
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  if (!file) {
+    spdlog::warn("Failed to write profiler trace {}", path.string());
+    return false;
+  }
+  file << chrome_trace();
+  spdlog::info("Profiler trace written to {}", path.string());
+  return true;
+}
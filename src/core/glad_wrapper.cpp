@@ -1,7 +1,37 @@
 #include "glad_wrapper.hpp"
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#include "Profiler.hpp"
+
 using namespace glad;
 
+size_t VertexAttribute::byte_size() const {
+  switch (data_type) {
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+      return 4;
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+      return component_count();
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+      return component_count() * 2;
+    case GL_DOUBLE:
+      return component_count() * 8;
+    default:
+      return component_count() * 4;
+  }
+}
+
 VertexBufferLayout::VertexBufferLayout(std::vector<VertexAttribute> attribute) :
   attribute_(std::move(attribute)) {}
 
@@ -21,30 +51,646 @@ auto VertexBufferLayout::cend() const -> std::vector<VertexAttribute>::const_ite
   return attribute_.cend();
 }
 
-IndexBuffer::IndexBuffer(std::span<unsigned int> vertices) {
+namespace {
+thread_local ContextState* current_state = nullptr;
+
+// true when the cached value already matches, otherwise the cache is updated
+bool elide(GLuint& cached, GLuint value) {
+  if (cached == value) {
+    call_stats().elided_binds++;
+    return true;
+  }
+  cached = value;
+  call_stats().binds++;
+  return false;
+}
+} // namespace
+
+void ContextState::use_program(GLuint program) {
+  if (!elide(program_, program)) {
+    glUseProgram(program);
+  }
+}
+
+void ContextState::bind_vertex_array(GLuint vao) {
+  if (!elide(vao_, vao)) {
+    glBindVertexArray(vao);
+    element_buffer_ = UNKNOWN;
+  }
+}
+
+void ContextState::bind_buffer(GLenum target, GLuint buffer) {
+  auto* slot = buffer_slot(target);
+  if (!slot) {
+    glBindBuffer(target, buffer);
+    call_stats().binds++;
+    return;
+  }
+  if (!elide(*slot, buffer)) {
+    glBindBuffer(target, buffer);
+  }
+}
+
+void ContextState::bind_buffer_base(GLenum target, GLuint index, GLuint buffer) {
+  // also changes the generic binding point of the target
+  if (auto* slot = buffer_slot(target)) {
+    *slot = buffer;
+  }
+  if (target == GL_UNIFORM_BUFFER) {
+    auto [it, inserted] = uniform_buffer_bases_.try_emplace(index, UNKNOWN);
+    if (elide(it->second, buffer)) {
+      return;
+    }
+  } else {
+    call_stats().binds++;
+  }
+  glBindBufferBase(target, index, buffer);
+}
+
+void ContextState::active_texture(GLuint unit) {
+  if (!elide(active_unit_, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+}
+
+void ContextState::bind_texture(GLuint unit, GLuint texture, GLenum target) {
+  init_units();
+  auto& slot = units_.at(unit);
+  slot.last_use = use_clock_++;
+  if (slot.texture == texture) {
+    call_stats().elided_binds++;
+    return;
+  }
+
+  auto it = texture_units_.find(slot.texture);
+  if (it != texture_units_.end() && it->second == unit) {
+    texture_units_.erase(it);
+  }
+  slot.pinned = false;
+  if (texture != 0) {
+    texture_units_[texture] = unit;
+  }
+
+  // a unit keeps one binding per target, only the latest one is tracked. a stale
+  // binding of another target is harmless as long as no sampler points at it
+  active_texture(unit);
+  elide(slot.texture, texture);
+  glBindTexture(target, texture);
+}
+
+GLuint ContextState::bind_texture(GLuint texture) {
+  return bind_free_unit(texture, GL_TEXTURE_2D);
+}
+
+GLuint ContextState::bind_buffer_texture(GLuint texture) {
+  return bind_free_unit(texture, GL_TEXTURE_BUFFER);
+}
+
+GLuint ContextState::edit_texture(GLuint texture, GLenum target) {
+  auto unit = bind_free_unit(texture, target);
+  active_texture(unit);
+  return unit;
+}
+
+GLuint ContextState::bind_pinned_texture(GLuint texture, GLenum target) {
+  auto unit = bind_free_unit(texture, target);
+  units_[unit].pinned = true;
+  return unit;
+}
+
+GLuint ContextState::bind_free_unit(GLuint texture, GLenum target) {
+  init_units();
+  if (auto it = texture_units_.find(texture); it != texture_units_.end()) {
+    units_[it->second].last_use = use_clock_++;
+    call_stats().elided_binds++;
+    return it->second;
+  }
+
+  GLuint victim = UNKNOWN;
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  for (GLuint unit = 0; unit < units_.size(); unit++) {
+    auto last_use = units_[unit].last_use;
+    if (!units_[unit].pinned && last_use < draw_start_ && last_use < oldest) {
+      oldest = last_use;
+      victim = unit;
+    }
+  }
+  if (victim == UNKNOWN) {
+    throw std::runtime_error(
+      std::format("A single draw uses more than {} texture units", units_.size()));
+  }
+
+  bind_texture(victim, texture, target);
+  return victim;
+}
+
+void ContextState::next_draw() {
+  draw_start_ = use_clock_;
+}
+
+void ContextState::bind_framebuffer(GLenum target, GLuint framebuffer) {
+  bool read = target != GL_DRAW_FRAMEBUFFER;
+  bool draw = target != GL_READ_FRAMEBUFFER;
+  if ((!read || read_framebuffer_ == framebuffer) && (!draw || draw_framebuffer_ == framebuffer)) {
+    call_stats().elided_binds++;
+    return;
+  }
+  if (read) {
+    read_framebuffer_ = framebuffer;
+  }
+  if (draw) {
+    draw_framebuffer_ = framebuffer;
+  }
+  call_stats().binds++;
+  glBindFramebuffer(target, framebuffer);
+}
+
+void ContextState::forget_program(GLuint program) {
+  if (program_ == program) {
+    program_ = UNKNOWN;
+  }
+}
+
+void ContextState::forget_vertex_array(GLuint vao) {
+  if (vao_ == vao) {
+    vao_ = UNKNOWN;
+    element_buffer_ = UNKNOWN;
+  }
+}
+
+void ContextState::forget_buffer(GLuint buffer) {
+  for (auto* slot : {&array_buffer_, &element_buffer_, &uniform_buffer_}) {
+    if (*slot == buffer) {
+      *slot = UNKNOWN;
+    }
+  }
+  for (auto& [index, bound] : uniform_buffer_bases_) {
+    if (bound == buffer) {
+      bound = UNKNOWN;
+    }
+  }
+}
+
+void ContextState::forget_texture(GLuint texture) {
+  for (auto& unit : units_) {
+    if (unit.texture == texture) {
+      unit.texture = UNKNOWN;
+      unit.pinned = false;
+    }
+  }
+  texture_units_.erase(texture);
+}
+
+void ContextState::forget_framebuffer(GLuint framebuffer) {
+  for (auto* slot : {&read_framebuffer_, &draw_framebuffer_}) {
+    if (*slot == framebuffer) {
+      *slot = UNKNOWN;
+    }
+  }
+}
+
+void ContextState::invalidate() {
+  *this = ContextState{};
+}
+
+ContextState& ContextState::current() {
+  static ContextState fallback{};
+  return current_state ? *current_state : fallback;
+}
+
+void ContextState::make_current(ContextState* state) {
+  current_state = state;
+}
+
+void ContextState::init_units() {
+  if (!units_.empty()) {
+    return;
+  }
+  GLint max_units{};
+  glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_units);
+  units_.resize(std::max(max_units, 1));
+}
+
+GLuint* ContextState::buffer_slot(GLenum target) {
+  switch (target) {
+    case GL_ARRAY_BUFFER:
+      return &array_buffer_;
+    case GL_ELEMENT_ARRAY_BUFFER:
+      return &element_buffer_;
+    case GL_UNIFORM_BUFFER:
+      return &uniform_buffer_;
+    default:
+      return nullptr;
+  }
+}
+
+GLenum glad::index_type(IndexFormat format) {
+  switch (format) {
+    case IndexFormat::U8:
+      return GL_UNSIGNED_BYTE;
+    case IndexFormat::U16:
+      return GL_UNSIGNED_SHORT;
+    case IndexFormat::U32:
+      return GL_UNSIGNED_INT;
+    default:
+      std::unreachable();
+  }
+}
+
+size_t glad::index_size(IndexFormat format) {
+  switch (format) {
+    case IndexFormat::U8:
+      return 1;
+    case IndexFormat::U16:
+      return 2;
+    case IndexFormat::U32:
+      return 4;
+    default:
+      std::unreachable();
+  }
+}
+
+IndexFormat glad::narrowest_index_format(size_t vertex_count, IndexFormat min_format) {
+  auto format = IndexFormat::U32;
+  if (vertex_count <= (1u << 8)) {
+    format = IndexFormat::U8;
+  } else if (vertex_count <= (1u << 16)) {
+    format = IndexFormat::U16;
+  }
+  return std::max(format, min_format);
+}
+
+std::vector<std::byte> glad::encode_indices(std::span<const unsigned int> indices,
+                                            IndexFormat format) {
+  std::vector<std::byte> encoded(indices.size() * index_size(format));
+  auto narrow = [&]<typename I>(I) {
+    for (size_t i = 0; i < indices.size(); i++) {
+      auto index = static_cast<I>(indices[i]);
+      std::memcpy(encoded.data() + i * sizeof(I), &index, sizeof(I));
+    }
+  };
+  switch (format) {
+    case IndexFormat::U8:
+      narrow(uint8_t{});
+      break;
+    case IndexFormat::U16:
+      narrow(uint16_t{});
+      break;
+    case IndexFormat::U32:
+      std::memcpy(encoded.data(), indices.data(), encoded.size());
+      break;
+  }
+  return encoded;
+}
+
+IndexBuffer::IndexBuffer(std::span<const unsigned int> indices)
+  : IndexBuffer(std::as_bytes(indices), IndexFormat::U32) {}
+
+IndexBuffer::IndexBuffer(std::span<const std::byte> indices, IndexFormat format)
+  : index_num_(indices.size() / index_size(format)), format_(format) {
   glGenBuffers(1, &ID);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, vertices.size() * sizeof(unsigned int), vertices.data(),
-               GL_STATIC_DRAW);
-  index_num_ = vertices.size();
+  ContextState::current().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+}
+
+IndexBuffer::IndexBuffer(size_t byte_size, IndexFormat format)
+  : index_num_(byte_size / index_size(format)), format_(format) {
+  glGenBuffers(1, &ID);
+  ContextState::current().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, byte_size, nullptr, GL_STATIC_DRAW);
 }
 
 IndexBuffer::~IndexBuffer() {
+  ContextState::current().forget_buffer(ID);
   glDeleteBuffers(1, &ID);
 }
 
 void IndexBuffer::bind() {
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+  ContextState::current().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 }
 
 void IndexBuffer::unbind() {
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  ContextState::current().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void IndexBuffer::write(size_t byte_offset, std::span<const std::byte> indices) {
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, byte_offset, indices.size(), indices.data());
+  call_stats().buffer_uploads++;
 }
 
 size_t IndexBuffer::index_num() const {
   return index_num_;
 }
 
+IndexFormat IndexBuffer::format() const {
+  return format_;
+}
+
+void Std140Writer::write(float value) {
+  write_bytes(&value, sizeof(value), 4);
+}
+
+void Std140Writer::write(int value) {
+  write_bytes(&value, sizeof(value), 4);
+}
+
+void Std140Writer::write(const glm::vec2& value) {
+  write_bytes(glm::value_ptr(value), sizeof(value), 8);
+}
+
+void Std140Writer::write(const glm::vec3& value) {
+  write_bytes(glm::value_ptr(value), sizeof(value), 16);
+}
+
+void Std140Writer::write(const glm::vec4& value) {
+  write_bytes(glm::value_ptr(value), sizeof(value), 16);
+}
+
+void Std140Writer::write(const glm::mat4& value) {
+  // column major, every column is a vec4
+  write_bytes(glm::value_ptr(value), sizeof(value), 16);
+}
+
+void Std140Writer::begin_struct() {
+  align(16);
+}
+
+void Std140Writer::end_struct() {
+  align(16);
+}
+
+void Std140Writer::reset() {
+  buf_.clear();
+}
+
+auto Std140Writer::data() const -> std::span<const std::byte> {
+  return buf_;
+}
+
+void Std140Writer::write_bytes(const void* data, size_t size, size_t alignment) {
+  align(alignment);
+  auto offset = buf_.size();
+  buf_.resize(offset + size);
+  std::memcpy(buf_.data() + offset, data, size);
+}
+
+void Std140Writer::align(size_t alignment) {
+  buf_.resize((buf_.size() + alignment - 1) / alignment * alignment);
+}
+
+GLuint glad::uniform_block_binding(std::string_view block_name) {
+  static std::unordered_map<std::string, GLuint> bindings{};
+
+  auto it = bindings.find(std::string{block_name});
+  if (it != bindings.end()) {
+    return it->second;
+  }
+
+  GLint max_bindings{};
+  glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &max_bindings);
+  auto binding = static_cast<GLuint>(bindings.size());
+  if (binding >= static_cast<GLuint>(max_bindings)) {
+    throw std::runtime_error(std::format("Out of uniform buffer bindings for block: {}", block_name));
+  }
+
+  bindings.emplace(block_name, binding);
+  return binding;
+}
+
+UniformBuffer::UniformBuffer(std::string_view block_name)
+  : binding_(uniform_block_binding(block_name)) {
+  glGenBuffers(1, &ID);
+}
+
+UniformBuffer::~UniformBuffer() {
+  ContextState::current().forget_buffer(ID);
+  glDeleteBuffers(1, &ID);
+}
+
+void UniformBuffer::update(std::span<const std::byte> data) {
+  PROFILE_ZONE("UniformBuffer::update");
+  auto& state = ContextState::current();
+  state.bind_buffer(GL_UNIFORM_BUFFER, ID);
+  if (data.size() != size_) {
+    glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_DYNAMIC_DRAW);
+    state.bind_buffer_base(GL_UNIFORM_BUFFER, binding_, ID);
+    size_ = data.size();
+  } else {
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size(), data.data());
+  }
+  call_stats().buffer_uploads++;
+}
+
+GLuint UniformBuffer::binding() const {
+  return binding_;
+}
+
+TextureBuffer::TextureBuffer(GLenum internal_format) : internal_format_(internal_format) {
+  glGenBuffers(1, &buffer_);
+  glGenTextures(1, &texture_);
+
+  auto& state = ContextState::current();
+  state.bind_buffer(GL_TEXTURE_BUFFER, buffer_);
+  // an empty buffer can not back a texture, keep at least one texel around
+  capacity_ = 16;
+  glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(capacity_), nullptr, GL_STREAM_DRAW);
+  // the texture follows the buffer name across glBufferData, it is attached only once
+  state.edit_texture(texture_, GL_TEXTURE_BUFFER);
+  glTexBuffer(GL_TEXTURE_BUFFER, internal_format_, buffer_);
+}
+
+TextureBuffer::~TextureBuffer() {
+  auto& state = ContextState::current();
+  state.forget_texture(texture_);
+  state.forget_buffer(buffer_);
+  glDeleteTextures(1, &texture_);
+  glDeleteBuffers(1, &buffer_);
+}
+
+void TextureBuffer::update(std::span<const std::byte> data) {
+  auto& state = ContextState::current();
+  state.bind_buffer(GL_TEXTURE_BUFFER, buffer_);
+  // grow, or orphan the old storage so the driver does not wait for draws still reading it
+  capacity_ = std::max(capacity_, data.size());
+  glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(capacity_), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(data.size()), data.data());
+  call_stats().buffer_uploads++;
+}
+
+GLuint TextureBuffer::bind() const {
+  return ContextState::current().bind_pinned_texture(texture_, GL_TEXTURE_BUFFER);
+}
+
+size_t TextureBuffer::max_texels() {
+  static size_t texels = [] {
+    GLint size{};
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &size);
+    return static_cast<size_t>(std::max(size, 65536));
+  }();
+  return texels;
+}
+
+RenderTarget::RenderTarget(int width, int height, GLenum internal_format)
+  : internal_format_(internal_format), width_(width), height_(height) {
+  glGenTextures(1, &texture_);
+  allocate();
+}
+
+RenderTarget::~RenderTarget() {
+  ContextState::current().forget_texture(texture_);
+  glDeleteTextures(1, &texture_);
+}
+
+void RenderTarget::resize(int width, int height) {
+  if (width == width_ && height == height_) {
+    return;
+  }
+  width_ = width;
+  height_ = height;
+  allocate();
+}
+
+GLuint RenderTarget::bind() const {
+  return ContextState::current().bind_texture(texture_);
+}
+
+bool RenderTarget::is_depth() const {
+  switch (internal_format_) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool RenderTarget::has_stencil() const {
+  return internal_format_ == GL_DEPTH24_STENCIL8 || internal_format_ == GL_DEPTH32F_STENCIL8;
+}
+
+void RenderTarget::allocate() {
+  // format and type only describe the (absent) source data, they still have to match the kind
+  GLenum format = has_stencil() ? GL_DEPTH_STENCIL : is_depth() ? GL_DEPTH_COMPONENT : GL_RGBA;
+  GLenum type = has_stencil() ? GL_UNSIGNED_INT_24_8 : GL_FLOAT;
+  if (internal_format_ == GL_DEPTH32F_STENCIL8) {
+    type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+  }
+
+  // resident after the first pass that sampled it, the unit has to be made active
+  ContextState::current().edit_texture(texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internal_format_), width_, height_, 0, format,
+               type, nullptr);
+  // passes read their inputs texel by texel, no filtering or mips
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+Framebuffer::Framebuffer() {
+  glGenFramebuffers(1, &ID);
+}
+
+Framebuffer::~Framebuffer() {
+  ContextState::current().forget_framebuffer(ID);
+  glDeleteFramebuffers(1, &ID);
+}
+
+void Framebuffer::attach_color(size_t index, std::shared_ptr<RenderTarget> target) {
+  if (colors_.size() <= index) {
+    colors_.resize(index + 1);
+  }
+  colors_[index] = std::move(target);
+  attach(GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index), *colors_[index]);
+
+  std::vector<GLenum> draw_buffers(colors_.size(), GL_NONE);
+  for (size_t i = 0; i < colors_.size(); i++) {
+    if (colors_[i]) {
+      draw_buffers[i] = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
+    }
+  }
+  glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+}
+
+void Framebuffer::attach_depth(std::shared_ptr<RenderTarget> target) {
+  depth_ = std::move(target);
+  attach(depth_->has_stencil() ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, *depth_);
+}
+
+void Framebuffer::validate() {
+  ContextState::current().bind_framebuffer(GL_FRAMEBUFFER, ID);
+  auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error(std::format("Framebuffer incomplete: 0x{:x}", status));
+  }
+}
+
+void Framebuffer::resize(int width, int height) {
+  for (auto& color : colors_) {
+    if (color) {
+      color->resize(width, height);
+    }
+  }
+  if (depth_) {
+    depth_->resize(width, height);
+  }
+}
+
+void Framebuffer::bind() {
+  ContextState::current().bind_framebuffer(GL_FRAMEBUFFER, ID);
+  glViewport(0, 0, width(), height());
+}
+
+void Framebuffer::bind_default(int width, int height) {
+  ContextState::current().bind_framebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, width, height);
+}
+
+void Framebuffer::blit_to_default(GLbitfield mask, int width, int height) const {
+  auto& state = ContextState::current();
+  state.bind_framebuffer(GL_READ_FRAMEBUFFER, ID);
+  state.bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  // depth and stencil can only be copied 1:1 with nearest filtering
+  GLenum filter = mask == GL_COLOR_BUFFER_BIT ? GL_LINEAR : GL_NEAREST;
+  glBlitFramebuffer(0, 0, this->width(), this->height(), 0, 0, width, height, mask, filter);
+}
+
+int Framebuffer::width() const {
+  for (auto& color : colors_) {
+    if (color) {
+      return color->width();
+    }
+  }
+  return depth_ ? depth_->width() : 0;
+}
+
+int Framebuffer::height() const {
+  for (auto& color : colors_) {
+    if (color) {
+      return color->height();
+    }
+  }
+  return depth_ ? depth_->height() : 0;
+}
+
+void Framebuffer::attach(GLenum attachment, const RenderTarget& target) {
+  ContextState::current().bind_framebuffer(GL_FRAMEBUFFER, ID);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.id(), 0);
+}
+
+CallStats& glad::call_stats() {
+  static CallStats stats{};
+  return stats;
+}
+
+void glad::reset_call_stats() {
+  call_stats() = CallStats{};
+}
+
 void glad::enable_depth_test() {
   glEnable(GL_DEPTH_TEST);
 }
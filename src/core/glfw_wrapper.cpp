@@ -2,13 +2,15 @@
 
 #include <spdlog/spdlog.h>
 
+#include "Profiler.hpp"
+
 using namespace glfw;
 
 bool window::glfw_initialized = false;
 
-window::window(std::string_view title, int width, int height) :
-  m_width(width), m_height(height), m_title(title) {
-  init_glfw();
+window::window(std::string_view title, int width, int height, window_mode mode) :
+  m_mode(mode), m_width(width), m_height(height), m_title(title) {
+  init_glfw(mode);
 
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -17,7 +19,20 @@ window::window(std::string_view title, int width, int height) :
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+  if (mode != window_mode::visible) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
+  if (mode == window_mode::headless) {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  }
+
   m_window = glfwCreateWindow(m_width, m_height, m_title.data(), nullptr, nullptr);
+  if (!m_window && mode == window_mode::headless) {
+    spdlog::warn("No EGL context for the headless window, trying OSMesa");
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    m_window = glfwCreateWindow(m_width, m_height, m_title.data(), nullptr, nullptr);
+  }
+  glfwDefaultWindowHints();
   if (!m_window) {
     spdlog::error("Failed to create GLFW window");
     terminate_glfw();
@@ -25,6 +40,8 @@ window::window(std::string_view title, int width, int height) :
   }
 
   glfwMakeContextCurrent(m_window);
+  PROFILE_THREAD("main");
+  glad::ContextState::make_current(&m_context_state);
 
   glfwSetWindowUserPointer(m_window, this);
   glfwSetKeyCallback(m_window, key_callback_wrapper);
@@ -36,14 +53,28 @@ window::window(std::string_view title, int width, int height) :
 }
 
 window::~window() {
+  // the framebuffer goes while its context is still current
+  m_offscreen_target.reset();
+  if (&glad::ContextState::current() == &m_context_state) {
+    glad::ContextState::make_current(nullptr);
+  }
   if (m_window) {
     glfwDestroyWindow(m_window);
   }
   terminate_glfw();
 }
 
-void window::init_glfw() {
+void window::init_glfw(window_mode mode) {
   if (!glfw_initialized) {
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+    if (mode == window_mode::headless) {
+      glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#else
+    if (mode == window_mode::headless) {
+      spdlog::warn("Headless windows need GLFW 3.4, falling back to a hidden window");
+    }
+#endif
     if (!glfwInit()) {
       spdlog::error("Failed to initialize GLFW");
       return;
@@ -68,6 +99,7 @@ void window::set_should_close() {
 }
 
 void window::swap_buffers() {
+  PROFILE_ZONE("window::swap_buffers");
   glfwSwapBuffers(m_window);
 }
 
@@ -81,6 +113,7 @@ void window::set_title(std::string_view title) {
 }
 
 void window::update() {
+  PROFILE_FRAME();
   float current_frame = glfwGetTime();
   delta_time = current_frame - last_frame;
   last_frame = current_frame;
@@ -134,6 +167,40 @@ GLFWwindow* window::native_window() const {
   return m_window;
 }
 
+glad::ContextState& window::context_state() {
+  return m_context_state;
+}
+
+window_mode window::mode() const {
+  return m_mode;
+}
+
+bool window::offscreen() const {
+  return m_mode != window_mode::visible;
+}
+
+glad::Framebuffer& window::offscreen_target() {
+  if (!m_offscreen_target) {
+    m_offscreen_target = std::make_unique<glad::Framebuffer>();
+    m_offscreen_target->attach_color(
+      0, std::make_shared<glad::RenderTarget>(m_width, m_height, GL_RGBA8));
+    m_offscreen_target->attach_depth(
+      std::make_shared<glad::RenderTarget>(m_width, m_height, GL_DEPTH24_STENCIL8));
+    m_offscreen_target->validate();
+  } else if (m_offscreen_target->width() != m_width || m_offscreen_target->height() != m_height) {
+    m_offscreen_target->resize(m_width, m_height);
+  }
+  return *m_offscreen_target;
+}
+
+void window::bind_render_target() {
+  if (offscreen()) {
+    offscreen_target().bind();
+  } else {
+    glad::Framebuffer::bind_default(m_width, m_height);
+  }
+}
+
 bool window::is_key_pressed(int key) const {
   return glfwGetKey(m_window, key) == GLFW_PRESS;
 }
@@ -6,6 +6,7 @@
 
 #include <vector>
 
+#include "Profiler.hpp"
 #include "Shader.hpp"
 #include "glad_wrapper.hpp"
 #include "glfw_wrapper.hpp"
@@ -28,6 +29,14 @@ int main() {
       Logger::shutdown();
     }
   };
+#ifdef ENABLE_PROFILER
+  Guard profiler_guard{
+    [] {
+      Profiler::instance().log_stats();
+      Profiler::instance().write_chrome_trace("../logs/camera_trace.json");
+    }
+  };
+#endif
 
   glfw::window window{"Learn OpenGL", 800, 600};
   window.disable_cursor();
@@ -169,6 +178,21 @@ int main() {
 
   vao.set_vbo(vertices, std::make_shared<glad::VertexBufferLayout>(v_layout));
 
+  std::vector<glm::mat4> models{};
+  for (uint32_t i = 0; i < 10; i++) {
+    glm::mat4 model{1.0f};
+    model = glm::translate(model, cube_positions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    models.push_back(model);
+  }
+
+  // every cube is drawn by a single instanced call
+  vao.add_instance_vbo(std::make_shared<glad::VertexBuffer<glm::mat4>>(
+    models, std::make_shared<glad::VertexBufferLayout>(std::vector<glad::VertexAttribute>{
+              {.index = 2, .name = "Model", .type = glad::ArrtibuteType::Mat4}
+            })));
+
   Texture texture1{
     TextureArgs{
       .uniform_name = "texture1",
@@ -199,19 +223,14 @@ int main() {
     }
   };
 
-  our_shader.use();
-  our_shader.set_int(texture1.unform_name(), texture1.unit_index());
-  our_shader.set_int(texture2.unform_name(), texture2.unit_index());
-
   while (!window.should_close()) {
     window.update();
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    texture1.bind();
-    texture2.bind();
-
     our_shader.use();
+    our_shader.set_sampler(texture1.unform_name(), texture1.bind());
+    our_shader.set_sampler(texture2.unform_name(), texture2.bind());
     our_shader.set_float("mixValue", mix_value);
 
     glm::mat4 projection =
@@ -220,15 +239,11 @@ int main() {
 
     our_shader.set_mat4("view", camera.view_matrix());
 
-    vao.bind();
-    for (uint32_t i = 0; i < 10; i++) {
-      glm::mat4 model{1.0f};
-      model = glm::translate(model, cube_positions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      our_shader.set_mat4("model", model);
-
-      vao.draw_arrays(glad::DrawMode::Triangles, 0, 36);
+    {
+      PROFILE_GPU_ZONE("cubes");
+      vao.bind();
+      vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 36,
+                                static_cast<GLsizei>(models.size()));
     }
 
     window.swap_buffers();
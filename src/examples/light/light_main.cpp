@@ -4,11 +4,24 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DeferredRenderer.hpp"
+#include "LightClusters.hpp"
+#include "Profiler.hpp"
 #include "Shader.hpp"
+#include "ShaderVariants.hpp"
 #include "Texture.hpp"
 #include "glfw_wrapper.hpp"
 #include "Camera.hpp"
 #include "glad_wrapper.hpp"
+#include "UniformBlocks.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Guard.hpp"
 
@@ -16,15 +29,23 @@ bool first_mouse = true;
 float last_x = 800.0f / 2.0;
 float last_y = 600.0 / 2.0;
 
-glm::vec3 light_pos{1.2f, 1.0f, 2.0f};
-
-int main() {
+// light [forward | clustered | deferred] [drifting light count]
+// clustered bins the point lights on the cpu, deferred shades a g-buffer with light volumes
+int main(int argc, char** argv) {
   Logger::init("light");
   Guard guard{
     [] {
       Logger::shutdown();
     }
   };
+#ifdef ENABLE_PROFILER
+  Guard profiler_guard{
+    [] {
+      Profiler::instance().log_stats();
+      Profiler::instance().write_chrome_trace("../logs/light_trace.json");
+    }
+  };
+#endif
 
   glfw::window window{"light", 800, 600};
   Camera camera{glm::vec3{0.0f, 0.0f, 3.0f}};
@@ -75,10 +96,29 @@ int main() {
 
   glEnable(GL_DEPTH_TEST);
 
-  Shader lighting_shader{
+  std::string_view mode = argc > 1 ? argv[1] : "forward";
+  bool clustered = mode == "clustered";
+  bool deferred = mode == "deferred";
+  int drifting_light_count = clustered || deferred ? 1024 : 0;
+  if (argc > 2 && (clustered || deferred)) {
+    drifting_light_count = std::stoi(argv[2]);
+  }
+
+  // compiled for the number of point lights in the scene
+  ShaderVariants lighting_shaders{
     "../../shader/light/color.vert",
-    "../../shader/light/color.frag"}
-  ;
+    "../../shader/light/color.frag"
+  };
+  ShaderDefines lighting_defines{};
+  lighting_defines.set("NR_POINT_LIGHTS", MAX_POINT_LIGHTS);
+  if (clustered) {
+    lighting_defines.set("CLUSTERED");
+  }
+  auto& lighting_shader = lighting_shaders.get(lighting_defines);
+  Shader gbuffer_shader{
+    "../../shader/deferred/gbuffer.vert",
+    "../../shader/deferred/gbuffer.frag"
+  };
   Shader lightcube_shader{
     "../../shader/light/light_cube.vert",
     "../../shader/light/light_cube.frag"
@@ -158,13 +198,64 @@ int main() {
       {2, "TexCoords", glad::ArrtibuteType::TexCoords}
     });
 
+  // the cubes never move, their transforms are uploaded once as per-instance attributes
+  std::vector<glm::mat4> cube_models{};
+  for (int i = 0; i < 10; i++) {
+    glm::mat4 model{1.0f};
+    model = glm::translate(model, cube_positions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3{1.0f, 0.3f, 0.5f});
+    cube_models.push_back(model);
+  }
+
+  // small colored lights drifting around the cubes
+  std::vector<ClusterLight> cluster_lights{};
+  std::vector<glm::vec3> cluster_origins{};
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+  for (int i = 0; i < drifting_light_count; i++) {
+    glm::vec3 origin{unit(rng) * 12.0f - 6.0f, unit(rng) * 8.0f - 4.0f, unit(rng) * 16.0f - 14.0f};
+    cluster_origins.push_back(origin);
+    cluster_lights.push_back(ClusterLight{
+      .position = origin,
+      .radius = 1.0f + unit(rng) * 1.5f,
+      .color = glm::vec3{unit(rng), unit(rng), unit(rng)},
+      .intensity = 2.0f,
+    });
+  }
+  LightClusters light_clusters{};
+
+  std::vector<glm::mat4> lightcube_models{};
+  auto light_model = [](const glm::vec3& position, float scale) {
+    return glm::scale(glm::translate(glm::mat4{1.0f}, position), glm::vec3{scale});
+  };
+  if (!cluster_lights.empty()) {
+    for (auto& light : cluster_lights) {
+      lightcube_models.push_back(light_model(light.position, 0.05f));
+    }
+  } else {
+    for (int i = 0; i < 4; i++) {
+      lightcube_models.push_back(light_model(point_light_positions[i], 0.2f));
+    }
+  }
+
+  auto instance_layout = std::make_shared<glad::VertexBufferLayout>(
+    std::vector<glad::VertexAttribute>{
+      {3, "Model", glad::ArrtibuteType::Mat4}
+    });
+
   glad::VertexArray<float> cube_vao{};
   cube_vao.bind();
   cube_vao.set_vbo(vertices, layout);
+  cube_vao.add_instance_vbo(
+    std::make_shared<glad::VertexBuffer<glm::mat4>>(cube_models, instance_layout));
 
   glad::VertexArray<float> lightcube_vao{};
   lightcube_vao.bind();
   lightcube_vao.set_vbo(cube_vao.vbo());
+  auto lightcube_instances = std::make_shared<glad::VertexBuffer<glm::mat4>>(
+    std::span<const glm::mat4>{lightcube_models}, instance_layout, GL_DYNAMIC_DRAW);
+  lightcube_vao.add_instance_vbo(lightcube_instances);
 
   Texture diffuse_texture{
     TextureArgs{
@@ -189,8 +280,58 @@ int main() {
   };
 
   lighting_shader.use();
-  lighting_shader.set_int(diffuse_texture.unform_name(), diffuse_texture.unit_index());
-  lighting_shader.set_int(specular_texture.unform_name(), specular_texture.unit_index());
+  lighting_shader.set_float("material.shininess", 32.0f);
+
+  // camera and light data are written once per frame and shared by both programs
+  glad::UniformBuffer camera_ubo{CameraBlock::NAME};
+  glad::UniformBuffer lights_ubo{LightsBlock::NAME};
+
+  LightsBlock lights{
+    .dir_light = {
+      .direction = {-0.2f, -1.0f, -0.3f},
+      .ambient = glm::vec3{0.05f},
+      .diffuse = glm::vec3{0.4f},
+      .specular = glm::vec3{0.5f},
+    },
+    .spot_light = {
+      .cut_off = glm::cos(glm::radians(12.5f)),
+      .outer_cut_off = glm::cos(glm::radians(15.0f)),
+      .constant = 1.0f,
+      .linear = 0.09f,
+      .quadratic = 0.032f,
+      .ambient = glm::vec3{0.0f},
+      .diffuse = glm::vec3{1.0f},
+      .specular = glm::vec3{1.0f},
+    },
+  };
+  for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+    lights.point_lights[i] = PointLight{
+      .position = point_light_positions[i],
+      .constant = 1.0f,
+      .linear = 0.09f,
+      .quadratic = 0.032f,
+      .ambient = glm::vec3{0.05f},
+      .diffuse = glm::vec3{0.8f},
+      .specular = glm::vec3{1.0f},
+    };
+  }
+
+  DeferredRenderer deferred_renderer{window.width(), window.height()};
+  // the drifting lights as attenuated point lights, falling to the cutoff at their radius
+  std::vector<PointLight> deferred_lights{};
+  auto to_point_light = [cutoff = DeferredArgs{}.light_cutoff](const ClusterLight& light) {
+    auto color = light.color * light.intensity;
+    float brightness = std::max({color.r, color.g, color.b});
+    return PointLight{
+      .position = light.position,
+      .constant = 1.0f,
+      .linear = 0.0f,
+      .quadratic = (brightness / cutoff - 1.0f) / (light.radius * light.radius),
+      .ambient = glm::vec3{0.0f},
+      .diffuse = color,
+      .specular = color,
+    };
+  };
 
   while (!window.should_close()) {
     window.update();
@@ -198,73 +339,72 @@ int main() {
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    lighting_shader.use();
-    lighting_shader.set_vec3("viewPos", camera.position_);
-    lighting_shader.set_float("material.shininess", 32.0f);
-
-    // directional light
-    lighting_shader.set_vec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-    lighting_shader.set_vec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-    lighting_shader.set_vec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-    lighting_shader.set_vec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-    for (int i = 0; i < 4; i++) {
-      lighting_shader.set_vec3(std::format("pointLights[{}].position", i),
-                               point_light_positions[i]);
-      lighting_shader.set_vec3(std::format("pointLights[{}].ambient", i), 0.05f, 0.05f, 0.05f);
-      lighting_shader.set_vec3(std::format("pointLights[{}].diffuse", i), 0.8f, 0.8f, 0.8f);
-      lighting_shader.set_vec3(std::format("pointLights[{}].specular", i), 1.0f, 1.0f, 1.0f);
-      lighting_shader.set_float(std::format("pointLights[{}].constant", i), 1.0f);
-      lighting_shader.set_float(std::format("pointLights[{}].linear", i), 0.09f);
-      lighting_shader.set_float(std::format("pointLights[{}].quadratic", i), 0.032f);
-    }
-
-    lighting_shader.set_vec3("spotLight.position", camera.position_);
-    lighting_shader.set_vec3("spotLight.direction", camera.front_);
-    lighting_shader.set_vec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-    lighting_shader.set_vec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-    lighting_shader.set_vec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-    lighting_shader.set_float("spotLight.constant", 1.0f);
-    lighting_shader.set_float("spotLight.linear", 0.09f);
-    lighting_shader.set_float("spotLight.quadratic", 0.032f);
-    lighting_shader.set_float("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    lighting_shader.set_float("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
     glm::mat4 projection =
       glm::perspective(glm::radians(camera.zoom_), window.aspect_ratio(), 0.1f, 100.0f);
     glm::mat4 view = camera.view_matrix();
-    lighting_shader.set_mat4("projection", projection);
-    lighting_shader.set_mat4("view", view);
-
-    diffuse_texture.bind();
-    specular_texture.bind();
-
-    cube_vao.bind();
-    for (int i = 0; i < 10; i++) {
-      glm::mat4 model{1.0f};
-      model = glm::translate(model, cube_positions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3{1.0f, 0.3f, 0.5f});
-      lighting_shader.set_mat4("model", model);
+    camera_ubo.update(CameraBlock{projection, view, camera.position_});
+
+    lights.spot_light.position = camera.position_;
+    lights.spot_light.direction = camera.front_;
+    lights_ubo.update(lights);
+
+    if (!cluster_lights.empty()) {
+      auto time = static_cast<float>(glfwGetTime());
+      for (size_t i = 0; i < cluster_lights.size(); i++) {
+        float phase = time * 0.5f + static_cast<float>(i);
+        cluster_lights[i].position =
+          cluster_origins[i] + glm::vec3{glm::cos(phase), 0.0f, glm::sin(phase)} * 0.5f;
+        lightcube_models[i] = light_model(cluster_lights[i].position, 0.05f);
+      }
+      lightcube_instances->update(std::span<const glm::mat4>{lightcube_models});
+    }
 
-      cube_vao.draw_arrays(glad::DrawMode::Triangles, 0, 36);
+    if (clustered) {
+      light_clusters.set_projection(glm::radians(camera.zoom_), 0.1f, 100.0f,
+                                    glm::vec2{window.width(), window.height()});
+      light_clusters.bin(cluster_lights, view);
+      light_clusters.upload();
     }
 
-    lightcube_shader.use();
-    lightcube_shader.set_mat4("projection", projection);
-    lightcube_shader.set_mat4("view", view);
-    auto model = glm::mat4{1.0f};
-    model = glm::translate(model, light_pos);
-    model = glm::scale(model, glm::vec3{0.2f});
-    lightcube_shader.set_mat4("model", model);
+    if (deferred) {
+      deferred_renderer.resize(window.width(), window.height());
+      {
+        PROFILE_GPU_ZONE("geometry pass");
+        deferred_renderer.begin_geometry();
+        gbuffer_shader.use();
+        gbuffer_shader.set_float("material.shininess", 32.0f);
+        gbuffer_shader.set_sampler(diffuse_texture.unform_name(), diffuse_texture.bind());
+        gbuffer_shader.set_sampler(specular_texture.unform_name(), specular_texture.bind());
+        cube_vao.bind();
+        cube_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 36,
+                                       static_cast<GLsizei>(cube_models.size()));
+      }
+
+      PROFILE_GPU_ZONE("lighting pass");
+      deferred_lights.assign(lights.point_lights.begin(), lights.point_lights.end());
+      std::ranges::transform(cluster_lights, std::back_inserter(deferred_lights), to_point_light);
+      deferred_renderer.light(deferred_lights, std::span{&lights.spot_light, 1});
+      deferred_renderer.present(window.width(), window.height());
+    } else {
+      PROFILE_GPU_ZONE("forward pass");
+      lighting_shader.use();
+      lighting_shader.set_sampler(diffuse_texture.unform_name(), diffuse_texture.bind());
+      lighting_shader.set_sampler(specular_texture.unform_name(), specular_texture.bind());
+      if (clustered) {
+        light_clusters.bind(lighting_shader);
+      }
+
+      cube_vao.bind();
+      cube_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 36,
+                                     static_cast<GLsizei>(cube_models.size()));
+    }
 
-    lightcube_vao.bind();
-    for (int i = 0; i < 4; i++) {
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, point_light_positions[i]);
-      model = glm::scale(model, glm::vec3(0.2f));
-      lightcube_shader.set_mat4("model", model);
-      lightcube_vao.draw_arrays(glad::DrawMode::Triangles, 0, 36);
+    {
+      PROFILE_GPU_ZONE("light cubes");
+      lightcube_shader.use();
+      lightcube_vao.bind();
+      lightcube_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 36,
+                                          static_cast<GLsizei>(lightcube_models.size()));
     }
 
     window.swap_buffers();
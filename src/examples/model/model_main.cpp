@@ -4,11 +4,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 #include "Shader.hpp"
+#include "ShaderVariants.hpp"
 #include "glfw_wrapper.hpp"
 #include "Camera.hpp"
 #include "glad_wrapper.hpp"
 #include "Model.hpp"
+#include "ModelLoader.hpp"
+#include "Profiler.hpp"
+#include "TextureStreamer.hpp"
+#include "UniformBlocks.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Guard.hpp"
 
@@ -19,6 +28,12 @@ float last_y = 600.0 / 2.0;
 int main() {
   Logger::init("model");
   Guard guard{[] { Logger::shutdown(); }};
+#ifdef ENABLE_PROFILER
+  Guard profiler_guard{[] {
+    Profiler::instance().log_stats();
+    Profiler::instance().write_chrome_trace("../logs/model_trace.json");
+  }};
+#endif
 
   glfw::window window{"model", 800, 600};
   if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
@@ -68,19 +83,74 @@ int main() {
 
   glad::enable_depth_test();
 
-  Shader shader{
-    "../../shader/model/model.vert",
+  // the variant for the texture types of the model is picked once it is loaded
+  ShaderVariants model_shaders{
+    "../../shader/model/model_instanced.vert",
     "../../shader/model/model.frag"};
-  Model backpack_model{"../../resources/backpack/backpack.obj"};
+  std::optional<ShaderVariants::Index> model_variant{};
+  Shader placeholder_shader{
+    "../../shader/light/light_cube.vert",
+    "../../shader/light/light_cube.frag"};
+
+  // parsed and decoded in the background, uploaded a little every frame
+  ModelLoader loader{};
+  auto backpack = loader.load(ModelArgs{
+    .load_path = "../../resources/backpack/backpack.obj",
+    .stream_textures = true,
+    .vertex_format = VertexFormat::Packed,
+  });
+
+  // a grid of backpacks drawn with one instanced call per mesh
+  constexpr int GRID_SIZE = 5;
+  constexpr float GRID_SPACING = 4.0f;
+  std::vector<glm::mat4> transforms{};
+  for (int x = 0; x < GRID_SIZE; x++) {
+    for (int z = 0; z < GRID_SIZE; z++) {
+      auto offset = glm::vec3{float(x - GRID_SIZE / 2), 0.0f, float(-z)} * GRID_SPACING;
+      transforms.push_back(glm::translate(glm::mat4{1.0f}, offset));
+    }
+  }
+
+  // unit cubes standing in for the backpacks while they load
+  // clang-format off
+  std::vector<float> cube_vertices{
+    -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,
+     0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+     0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+    -0.5f,  0.5f,  0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f, -0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,
+     0.5f,  0.5f,  0.5f,   0.5f,  0.5f, -0.5f,   0.5f, -0.5f, -0.5f,
+     0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+    -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,
+     0.5f, -0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f, -0.5f, -0.5f,
+    -0.5f,  0.5f, -0.5f,   0.5f,  0.5f, -0.5f,   0.5f,  0.5f,  0.5f,
+     0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f,  0.5f, -0.5f,
+  };
+  // clang-format on
+  glad::VertexArray<float> placeholder_vao{};
+  placeholder_vao.bind();
+  placeholder_vao.set_vbo(cube_vertices, std::make_shared<glad::VertexBufferLayout>(
+    std::vector<glad::VertexAttribute>{
+      {0, "Position", glad::ArrtibuteType::Position}
+    }));
+  placeholder_vao.add_instance_vbo(std::make_shared<glad::VertexBuffer<glm::mat4>>(
+    transforms, std::make_shared<glad::VertexBufferLayout>(
+      std::vector<glad::VertexAttribute>{
+        {3, "Model", glad::ArrtibuteType::Mat4}
+      })));
+  placeholder_vao.unbind();
+
+  std::vector<glm::mat4> visible_transforms{};
+  glad::UniformBuffer camera_ubo{CameraBlock::NAME};
 
   while (!window.should_close()) {
     window.update();
+    loader.update();
 
     glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    shader.use();
-
     glm::mat4 projection = glm::perspective(
       glm::radians(camera.zoom_),
       window.aspect_ratio(),
@@ -88,15 +158,56 @@ int main() {
       100.0f
       );
     glm::mat4 view = camera.view_matrix();
-    shader.set_mat4("projection", projection);
-    shader.set_mat4("view", view);
+    camera_ubo.update(CameraBlock{projection, view, camera.position_});
+
+    if (!backpack->ready()) {
+      {
+        PROFILE_GPU_ZONE("placeholders");
+        placeholder_shader.use();
+        placeholder_vao.bind();
+        placeholder_vao.draw_arrays_instanced(glad::DrawMode::Triangles, 0, 36,
+                                              static_cast<GLsizei>(transforms.size()));
+      }
+      window.swap_buffers();
+      window.poll_events();
+      continue;
+    }
+    auto& backpack_model = backpack->get();
+
+    if (!model_variant) {
+      model_variant = model_shaders.variant(backpack_model.texture_defines());
+    }
+    auto& shader = model_shaders.get(*model_variant);
+    shader.use();
+
+    // skip grid cells outside the view
+    auto frustum = camera.frustum(projection);
+    visible_transforms.clear();
+    {
+      PROFILE_ZONE("culling");
+      for (auto& transform : transforms) {
+        if (frustum.intersects(backpack_model.bounds().transformed(transform))) {
+          visible_transforms.push_back(transform);
+        }
+      }
+    }
+
+    // instances share one lod per mesh, pick it for the closest visible one
+    auto closest = std::ranges::min_element(visible_transforms, {}, [&](const glm::mat4& t) {
+      return glm::distance(glm::vec3{t[3]}, camera.position_);
+    });
+    if (closest != visible_transforms.end()) {
+      auto lod_settings = LodSettings::from_camera(camera, static_cast<float>(window.height()));
+      backpack_model.select_lods(lod_settings, camera.position_, *closest);
+      backpack_model.request_texture_sizes(lod_settings, camera.position_, *closest);
+    }
+    TextureStreamer::instance().update();
 
     // render the loaded model
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-    shader.set_mat4("model", model);
-    backpack_model.draw(shader);
+    {
+      PROFILE_GPU_ZONE("model");
+      backpack_model.draw_instanced(shader, visible_transforms);
+    }
 
     window.swap_buffers();
     window.poll_events();
@@ -0,0 +1,384 @@
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2
+#endif
+
+#include "utils/ThreadPool.hpp"
+
+namespace {
+using Texels = std::span<const uint8_t, 64>;
+using Color = std::array<int, 4>;
+
+struct Endpoints {
+  Color first;
+  Color second;
+};
+
+// per channel min and max of the 16 texels
+std::pair<Color, Color> block_bounds(Texels texels) {
+  std::array<uint8_t, 4> lo{};
+  std::array<uint8_t, 4> hi{};
+#ifdef BLOCK_COMPRESSION_SSE2
+  auto* data = reinterpret_cast<const __m128i*>(texels.data());
+  __m128i r0 = _mm_loadu_si128(data + 0);
+  __m128i r1 = _mm_loadu_si128(data + 1);
+  __m128i r2 = _mm_loadu_si128(data + 2);
+  __m128i r3 = _mm_loadu_si128(data + 3);
+  __m128i min = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+  __m128i max = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+  // fold the four texels of a register into the lowest one
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+  auto packed_min = static_cast<uint32_t>(_mm_cvtsi128_si32(min));
+  auto packed_max = static_cast<uint32_t>(_mm_cvtsi128_si32(max));
+  std::memcpy(lo.data(), &packed_min, 4);
+  std::memcpy(hi.data(), &packed_max, 4);
+#else
+  lo.fill(255);
+  for (size_t i = 0; i < 16; i++) {
+    for (size_t c = 0; c < 4; c++) {
+      lo[c] = std::min(lo[c], texels[i * 4 + c]);
+      hi[c] = std::max(hi[c], texels[i * 4 + c]);
+    }
+  }
+#endif
+  return {Color{lo[0], lo[1], lo[2], lo[3]}, Color{hi[0], hi[1], hi[2], hi[3]}};
+}
+
+// bounding box diagonal that follows the texels: channels falling while the
+// widest channel rises get their ends swapped, then both ends move inwards
+Endpoints fit_endpoints(Texels texels, size_t channels) {
+  auto [lo, hi] = block_bounds(texels);
+
+  size_t widest = 0;
+  Color mean{};
+  for (size_t c = 0; c < channels; c++) {
+    if (hi[c] - lo[c] > hi[widest] - lo[widest]) {
+      widest = c;
+    }
+    for (size_t i = 0; i < 16; i++) {
+      mean[c] += texels[i * 4 + c];
+    }
+  }
+
+  Endpoints endpoints{hi, lo};
+  for (size_t c = 0; c < channels; c++) {
+    if (c == widest) {
+      continue;
+    }
+    int covariance{};
+    for (size_t i = 0; i < 16; i++) {
+      covariance += (texels[i * 4 + c] * 16 - mean[c]) * (texels[i * 4 + widest] * 16 - mean[widest]);
+    }
+    if (covariance < 0) {
+      std::swap(endpoints.first[c], endpoints.second[c]);
+    }
+  }
+
+  for (size_t c = 0; c < channels; c++) {
+    int inset = (endpoints.first[c] - endpoints.second[c]) / 16;
+    endpoints.first[c] -= inset;
+    endpoints.second[c] += inset;
+  }
+  return endpoints;
+}
+
+int distance(const Color& lhs, const uint8_t* texel, size_t channels) {
+  int sum{};
+  for (size_t c = 0; c < channels; c++) {
+    int d = lhs[c] - texel[c];
+    sum += d * d;
+  }
+  return sum;
+}
+
+template <size_t N>
+uint32_t nearest(const std::array<Color, N>& palette, const uint8_t* texel, size_t channels) {
+  uint32_t best{};
+  int best_distance = distance(palette[0], texel, channels);
+  for (uint32_t i = 1; i < N; i++) {
+    int d = distance(palette[i], texel, channels);
+    if (d < best_distance) {
+      best_distance = d;
+      best = i;
+    }
+  }
+  return best;
+}
+
+uint16_t to_565(const Color& color) {
+  auto r = static_cast<uint16_t>((std::clamp(color[0], 0, 255) * 31 + 127) / 255);
+  auto g = static_cast<uint16_t>((std::clamp(color[1], 0, 255) * 63 + 127) / 255);
+  auto b = static_cast<uint16_t>((std::clamp(color[2], 0, 255) * 31 + 127) / 255);
+  return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+Color from_565(uint16_t color) {
+  int r = color >> 11 & 31;
+  int g = color >> 5 & 63;
+  int b = color & 31;
+  return Color{r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2, 255};
+}
+
+void write_le(std::byte* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = static_cast<std::byte>(value >> (8 * i));
+  }
+}
+
+// little endian bit stream of a 128-bit BC7 block
+class BitWriter {
+public:
+  explicit BitWriter(std::byte* out) : out_(out) { std::memset(out, 0, 16); }
+
+  void put(uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++, position_++) {
+      if (value >> i & 1) {
+        out_[position_ / 8] |= static_cast<std::byte>(1 << position_ % 8);
+      }
+    }
+  }
+
+private:
+  std::byte* out_;
+  uint32_t position_{};
+};
+
+constexpr std::array<int, 16> BC7_WEIGHTS = {0,  4,  9,  13, 17, 21, 26, 30,
+                                             34, 38, 43, 47, 51, 55, 60, 64};
+
+// 7-bit endpoint plus a p-bit shared by its channels, the p-bit with the lower error wins
+std::pair<Color, uint32_t> quantize_bc7(const Color& color) {
+  Color best{};
+  uint32_t best_pbit{};
+  int best_error = -1;
+  for (uint32_t pbit = 0; pbit < 2; pbit++) {
+    Color quantized{};
+    int error{};
+    for (size_t c = 0; c < 4; c++) {
+      quantized[c] = std::clamp((color[c] - static_cast<int>(pbit) + 1) / 2, 0, 127);
+      int d = (quantized[c] << 1 | static_cast<int>(pbit)) - color[c];
+      error += d * d;
+    }
+    if (best_error < 0 || error < best_error) {
+      best = quantized;
+      best_pbit = pbit;
+      best_error = error;
+    }
+  }
+  return {best, best_pbit};
+}
+
+// 16 rgba texels of a block, edges repeat the last row/column
+void gather_block(const MipChain& mips, int level, int block_x, int block_y,
+                  std::array<uint8_t, 64>& texels) {
+  int width = mips.level_width(level);
+  int height = mips.level_height(level);
+  auto channels = static_cast<size_t>(mips.nr_channels);
+  auto& pixels = mips.levels[level];
+  for (int y = 0; y < 4; y++) {
+    int py = std::min(block_y * 4 + y, height - 1);
+    for (int x = 0; x < 4; x++) {
+      int px = std::min(block_x * 4 + x, width - 1);
+      auto* texel = &pixels[(static_cast<size_t>(py) * width + px) * channels];
+      auto* out = &texels[(y * 4 + x) * 4];
+      // grey (+alpha) images are spread over rgb
+      bool grey = channels < 3;
+      out[0] = texel[0];
+      out[1] = grey ? texel[0] : texel[1];
+      out[2] = grey ? texel[0] : texel[2];
+      out[3] = channels == 4 ? texel[3] : channels == 2 ? texel[1] : 255;
+    }
+  }
+}
+} // namespace
+
+BlockFormat block_format(TextureType type, int nr_channels) {
+  if (nr_channels == 1) {
+    return BlockFormat::BC4;
+  }
+  if (type == TextureType::Normal) {
+    return BlockFormat::BC5;
+  }
+  if (nr_channels == 2 || nr_channels == 4) {
+    return BlockFormat::BC7;
+  }
+  return BlockFormat::BC1;
+}
+
+void encode_bc1(Texels texels, std::byte* block) {
+  auto endpoints = fit_endpoints(texels, 3);
+  uint16_t c0 = to_565(endpoints.first);
+  uint16_t c1 = to_565(endpoints.second);
+  // c0 > c1 selects the four color mode
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  uint32_t indices{};
+  if (c0 != c1) {
+    auto p0 = from_565(c0);
+    auto p1 = from_565(c1);
+    std::array<Color, 4> palette{p0, p1};
+    for (size_t c = 0; c < 3; c++) {
+      palette[2][c] = (2 * p0[c] + p1[c]) / 3;
+      palette[3][c] = (p0[c] + 2 * p1[c]) / 3;
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+      indices |= nearest(palette, &texels[i * 4], 3) << (2 * i);
+    }
+  }
+
+  write_le(block, c0, 2);
+  write_le(block + 2, c1, 2);
+  write_le(block + 4, indices, 4);
+}
+
+void encode_bc4(Texels texels, int channel, std::byte* block) {
+  int lo = 255;
+  int hi = 0;
+  for (size_t i = 0; i < 16; i++) {
+    lo = std::min<int>(lo, texels[i * 4 + channel]);
+    hi = std::max<int>(hi, texels[i * 4 + channel]);
+  }
+
+  // a0 > a1 selects six interpolated values
+  uint64_t indices{};
+  if (hi != lo) {
+    std::array<int, 8> palette{hi, lo};
+    for (int k = 2; k < 8; k++) {
+      palette[k] = ((8 - k) * hi + (k - 1) * lo) / 7;
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+      int value = texels[i * 4 + channel];
+      uint64_t best{};
+      for (uint64_t k = 1; k < 8; k++) {
+        if (std::abs(palette[k] - value) < std::abs(palette[best] - value)) {
+          best = k;
+        }
+      }
+      indices |= best << (3 * i);
+    }
+  }
+
+  block[0] = static_cast<std::byte>(hi);
+  block[1] = static_cast<std::byte>(lo);
+  write_le(block + 2, indices, 6);
+}
+
+void encode_bc3(Texels texels, std::byte* block) {
+  encode_bc4(texels, 3, block);
+  encode_bc1(texels, block + 8);
+}
+
+void encode_bc5(Texels texels, std::byte* block) {
+  encode_bc4(texels, 0, block);
+  encode_bc4(texels, 1, block + 8);
+}
+
+void encode_bc7(Texels texels, std::byte* block) {
+  auto endpoints = fit_endpoints(texels, 4);
+  auto [q0, p0] = quantize_bc7(endpoints.first);
+  auto [q1, p1] = quantize_bc7(endpoints.second);
+
+  auto indices_for = [&](std::array<uint32_t, 16>& indices) {
+    Color e0{};
+    Color e1{};
+    for (size_t c = 0; c < 4; c++) {
+      e0[c] = q0[c] << 1 | static_cast<int>(p0);
+      e1[c] = q1[c] << 1 | static_cast<int>(p1);
+    }
+    std::array<Color, 16> palette{};
+    for (size_t k = 0; k < 16; k++) {
+      for (size_t c = 0; c < 4; c++) {
+        palette[k][c] = ((64 - BC7_WEIGHTS[k]) * e0[c] + BC7_WEIGHTS[k] * e1[c] + 32) >> 6;
+      }
+    }
+    for (size_t i = 0; i < 16; i++) {
+      indices[i] = nearest(palette, &texels[i * 4], 4);
+    }
+  };
+
+  std::array<uint32_t, 16> indices{};
+  indices_for(indices);
+  // the first index drops its top bit, swap the ends when it is set
+  if (indices[0] & 8) {
+    std::swap(q0, q1);
+    std::swap(p0, p1);
+    for (auto& index : indices) {
+      index = 15 - index;
+    }
+  }
+
+  BitWriter writer{block};
+  // mode 6: six zero bits then a one
+  writer.put(1 << 6, 7);
+  for (size_t c = 0; c < 4; c++) {
+    writer.put(static_cast<uint32_t>(q0[c]), 7);
+    writer.put(static_cast<uint32_t>(q1[c]), 7);
+  }
+  writer.put(p0, 1);
+  writer.put(p1, 1);
+  writer.put(indices[0], 3);
+  for (size_t i = 1; i < 16; i++) {
+    writer.put(indices[i], 4);
+  }
+}
+
+CompressedImage compress(const MipChain& mips, BlockFormat format) {
+  CompressedImage image{.format = format, .width = mips.width, .height = mips.height};
+  image.levels.resize(mips.levels.size());
+
+  struct Row {
+    int level;
+    int y;
+  };
+  std::vector<Row> rows{};
+  for (int level = 0; level < mips.level_count(); level++) {
+    int blocks_x = (mips.level_width(level) + 3) / 4;
+    int blocks_y = (mips.level_height(level) + 3) / 4;
+    image.levels[level].resize(static_cast<size_t>(blocks_x) * blocks_y * block_bytes(format));
+    for (int y = 0; y < blocks_y; y++) {
+      rows.push_back(Row{level, y});
+    }
+  }
+
+  ThreadPool::shared().parallel_for(rows.size(), [&](size_t i) {
+    auto [level, y] = rows[i];
+    int blocks_x = (mips.level_width(level) + 3) / 4;
+    auto* out = image.levels[level].data() + static_cast<size_t>(y) * blocks_x * block_bytes(format);
+    std::array<uint8_t, 64> texels{};
+    for (int x = 0; x < blocks_x; x++, out += block_bytes(format)) {
+      gather_block(mips, level, x, y, texels);
+      switch (format) {
+        case BlockFormat::BC1:
+          encode_bc1(texels, out);
+          break;
+        case BlockFormat::BC3:
+          encode_bc3(texels, out);
+          break;
+        case BlockFormat::BC4:
+          encode_bc4(texels, 0, out);
+          break;
+        case BlockFormat::BC5:
+          encode_bc5(texels, out);
+          break;
+        case BlockFormat::BC7:
+          encode_bc7(texels, out);
+          break;
+      }
+    }
+  });
+  return image;
+}
@@ -0,0 +1,253 @@
+#include "DeferredRenderer.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+namespace {
+// texels of one light in the light data buffers, the volume shaders get them as defines
+constexpr int POINT_LIGHT_TEXELS = 5;
+constexpr int SPOT_LIGHT_TEXELS = 6;
+
+constexpr int SPHERE_SEGMENTS = 16;
+constexpr int SPHERE_RINGS = 8;
+constexpr int CONE_SEGMENTS = 16;
+
+struct VolumeMesh {
+  std::vector<float> positions;
+  std::vector<unsigned int> indices;
+};
+
+// the faces of a uv sphere cut into the true sphere, push the vertices out far
+// enough that the polygon contains it
+VolumeMesh make_sphere() {
+  float scale = 1.0f / std::cos(glm::pi<float>() / SPHERE_RINGS);
+  VolumeMesh mesh{};
+  for (int ring = 0; ring <= SPHERE_RINGS; ring++) {
+    float phi = glm::pi<float>() * static_cast<float>(ring) / SPHERE_RINGS;
+    for (int segment = 0; segment <= SPHERE_SEGMENTS; segment++) {
+      float theta = glm::two_pi<float>() * static_cast<float>(segment) / SPHERE_SEGMENTS;
+      mesh.positions.insert(mesh.positions.end(), {
+        std::sin(phi) * std::cos(theta) * scale,
+        std::cos(phi) * scale,
+        std::sin(phi) * std::sin(theta) * scale,
+      });
+    }
+  }
+  for (int ring = 0; ring < SPHERE_RINGS; ring++) {
+    for (int segment = 0; segment < SPHERE_SEGMENTS; segment++) {
+      unsigned int a = ring * (SPHERE_SEGMENTS + 1) + segment;
+      unsigned int b = a + SPHERE_SEGMENTS + 1;
+      mesh.indices.insert(mesh.indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+    }
+  }
+  return mesh;
+}
+
+// apex at the origin, base circle of radius 1 at z = 1
+VolumeMesh make_cone() {
+  float scale = 1.0f / std::cos(glm::pi<float>() / CONE_SEGMENTS);
+  VolumeMesh mesh{};
+  mesh.positions = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  for (int segment = 0; segment < CONE_SEGMENTS; segment++) {
+    float theta = glm::two_pi<float>() * static_cast<float>(segment) / CONE_SEGMENTS;
+    mesh.positions.insert(mesh.positions.end(),
+                          {std::cos(theta) * scale, std::sin(theta) * scale, 1.0f});
+  }
+  for (unsigned int segment = 0; segment < CONE_SEGMENTS; segment++) {
+    unsigned int current = 2 + segment;
+    unsigned int next = 2 + (segment + 1) % CONE_SEGMENTS;
+    mesh.indices.insert(mesh.indices.end(), {0, next, current, 1, current, next});
+  }
+  return mesh;
+}
+
+float brightest(const glm::vec3& color) {
+  return std::max({color.r, color.g, color.b});
+}
+} // namespace
+
+struct DeferredRenderer::Volume {
+  glad::VertexArray<float> vao{};
+
+  explicit Volume(const VolumeMesh& mesh) {
+    vao.bind();
+    vao.set_vbo(mesh.positions, std::make_shared<glad::VertexBufferLayout>(
+      std::vector<glad::VertexAttribute>{
+        {0, "Position", glad::ArrtibuteType::Position}
+      }));
+    vao.set_ebo(mesh.indices);
+    vao.unbind();
+  }
+};
+
+DeferredRenderer::DeferredRenderer(int width, int height, DeferredArgs args)
+  : args_(std::move(args)) {
+  auto depth = std::make_shared<glad::RenderTarget>(width, height, GL_DEPTH24_STENCIL8);
+  gbuffer_.attach_color(0, std::make_shared<glad::RenderTarget>(width, height, GL_RGBA16F));
+  gbuffer_.attach_color(1, std::make_shared<glad::RenderTarget>(width, height, GL_RGBA16F));
+  gbuffer_.attach_color(2, std::make_shared<glad::RenderTarget>(width, height, GL_RGBA8));
+  gbuffer_.attach_depth(depth);
+  gbuffer_.validate();
+
+  // the volumes test against the depth of the g-buffer geometry
+  light_buffer_.attach_color(0, std::make_shared<glad::RenderTarget>(width, height, GL_RGBA16F));
+  light_buffer_.attach_depth(depth);
+  light_buffer_.validate();
+
+  ShaderDefines defines{};
+  defines.set("POINT_LIGHT_TEXELS", POINT_LIGHT_TEXELS);
+  defines.set("SPOT_LIGHT_TEXELS", SPOT_LIGHT_TEXELS);
+  auto path = [&](std::string_view name) {
+    return std::format("{}/{}", args_.shader_directory, name);
+  };
+  directional_shader_ =
+    std::make_unique<Shader>(path("fullscreen.vert"), path("directional.frag"), defines);
+  point_shader_ =
+    std::make_unique<Shader>(path("point_volume.vert"), path("point.frag"), defines);
+  spot_shader_ = std::make_unique<Shader>(path("spot_volume.vert"), path("spot.frag"), defines);
+
+  sphere_ = std::make_unique<Volume>(make_sphere());
+  cone_ = std::make_unique<Volume>(make_cone());
+}
+
+DeferredRenderer::~DeferredRenderer() = default;
+
+void DeferredRenderer::resize(int width, int height) {
+  // the depth target is shared, resizing it twice is a no-op
+  gbuffer_.resize(width, height);
+  light_buffer_.resize(width, height);
+}
+
+void DeferredRenderer::begin_geometry() {
+  gbuffer_.bind();
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void DeferredRenderer::light(std::span<const PointLight> point_lights,
+                             std::span<const SpotLight> spot_lights) {
+  light_buffer_.bind();
+  glClearColor(args_.clear_color.r, args_.clear_color.g, args_.clear_color.b, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // every pass adds to the light buffer, the depth is only tested
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glDepthMask(GL_FALSE);
+
+  glDisable(GL_DEPTH_TEST);
+  directional_shader_->use();
+  bind_gbuffer(*directional_shader_);
+  empty_vao_.bind();
+  empty_vao_.draw_arrays(glad::DrawMode::Triangles, 0, 3);
+  glad::ContextState::current().next_draw();
+
+  // back faces behind the geometry, works with the camera inside a volume
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_GEQUAL);
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_FRONT);
+  draw_point_lights(point_lights);
+  draw_spot_lights(spot_lights);
+
+  glCullFace(GL_BACK);
+  glDisable(GL_CULL_FACE);
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+  stats_ = Stats{.point_lights = point_lights.size(), .spot_lights = spot_lights.size()};
+}
+
+void DeferredRenderer::present(int width, int height) {
+  light_buffer_.blit_to_default(GL_COLOR_BUFFER_BIT, width, height);
+  // forward passes afterwards need the scene depth, sizes differ only for a frame after a resize
+  if (width == gbuffer_.width() && height == gbuffer_.height()) {
+    gbuffer_.blit_to_default(GL_DEPTH_BUFFER_BIT, width, height);
+  }
+  glad::Framebuffer::bind_default(width, height);
+}
+
+float DeferredRenderer::light_radius(float constant, float linear, float quadratic,
+                                     float brightness, float cutoff) {
+  // solve constant + linear * d + quadratic * d^2 = brightness / cutoff
+  float target = brightness / cutoff;
+  if (quadratic <= 0.0f) {
+    return linear > 0.0f ? std::max(target - constant, 0.0f) / linear : 0.0f;
+  }
+  float c = constant - target;
+  return (-linear + std::sqrt(std::max(linear * linear - 4.0f * quadratic * c, 0.0f))) /
+         (2.0f * quadratic);
+}
+
+void DeferredRenderer::bind_gbuffer(const Shader& shader) const {
+  shader.set_sampler("gPosition", static_cast<int>(gbuffer_.color(0).bind()));
+  shader.set_sampler("gNormal", static_cast<int>(gbuffer_.color(1).bind()));
+  shader.set_sampler("gAlbedoSpec", static_cast<int>(gbuffer_.color(2).bind()));
+}
+
+void DeferredRenderer::draw_point_lights(std::span<const PointLight> lights) {
+  if (lights.empty()) {
+    return;
+  }
+
+  texels_.clear();
+  for (auto& light : lights) {
+    float brightness = std::max({brightest(light.ambient), brightest(light.diffuse),
+                                 brightest(light.specular)});
+    float radius = light_radius(light.constant, light.linear, light.quadratic, brightness,
+                                args_.light_cutoff);
+    texels_.insert(texels_.end(), {
+      glm::vec4{light.position, radius},
+      glm::vec4{light.constant, light.linear, light.quadratic, 0.0f},
+      glm::vec4{light.ambient, 0.0f},
+      glm::vec4{light.diffuse, 0.0f},
+      glm::vec4{light.specular, 0.0f},
+    });
+  }
+  point_data_.update(std::span<const glm::vec4>{texels_});
+
+  point_shader_->use();
+  bind_gbuffer(*point_shader_);
+  point_shader_->set_sampler("pointLightData", static_cast<int>(point_data_.bind()));
+  sphere_->vao.bind();
+  sphere_->vao.draw_elements_instanced(glad::DrawMode::Triangles,
+                                       static_cast<GLsizei>(lights.size()));
+  glad::ContextState::current().next_draw();
+}
+
+void DeferredRenderer::draw_spot_lights(std::span<const SpotLight> lights) {
+  if (lights.empty()) {
+    return;
+  }
+
+  texels_.clear();
+  for (auto& light : lights) {
+    float brightness = std::max({brightest(light.ambient), brightest(light.diffuse),
+                                 brightest(light.specular)});
+    float range = light_radius(light.constant, light.linear, light.quadratic, brightness,
+                               args_.light_cutoff);
+    texels_.insert(texels_.end(), {
+      glm::vec4{light.position, range},
+      glm::vec4{glm::normalize(light.direction), light.cut_off},
+      glm::vec4{light.constant, light.linear, light.quadratic, light.outer_cut_off},
+      glm::vec4{light.ambient, 0.0f},
+      glm::vec4{light.diffuse, 0.0f},
+      glm::vec4{light.specular, 0.0f},
+    });
+  }
+  spot_data_.update(std::span<const glm::vec4>{texels_});
+
+  spot_shader_->use();
+  bind_gbuffer(*spot_shader_);
+  spot_shader_->set_sampler("spotLightData", static_cast<int>(spot_data_.bind()));
+  cone_->vao.bind();
+  cone_->vao.draw_elements_instanced(glad::DrawMode::Triangles,
+                                     static_cast<GLsizei>(lights.size()));
+  glad::ContextState::current().next_draw();
+}
@@ -0,0 +1,154 @@
+#include "GeometryPool.hpp"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+GeometryPool::Allocation::Allocation(std::shared_ptr<GeometryPool> pool, Range range)
+  : pool_(std::move(pool)), range_(range) {}
+
+GeometryPool::Allocation::~Allocation() {
+  release();
+}
+
+GeometryPool::Allocation::Allocation(Allocation&& other) noexcept
+  : pool_(std::move(other.pool_)), range_(other.range_) {}
+
+auto GeometryPool::Allocation::operator=(Allocation&& other) noexcept -> Allocation& {
+  if (this != &other) {
+    release();
+    pool_ = std::move(other.pool_);
+    range_ = other.range_;
+  }
+  return *this;
+}
+
+void GeometryPool::Allocation::release() {
+  if (pool_) {
+    pool_->free(range_);
+    pool_.reset();
+  }
+}
+
+GeometryPool::GeometryPool(std::shared_ptr<glad::VertexBufferLayout> layout, size_t vertex_size,
+                           GeometryPoolArgs args)
+  : layout_(std::move(layout)), vertex_size_(vertex_size), args_(args) {}
+
+auto GeometryPool::allocate(std::span<const std::byte> vertices,
+                            std::span<const unsigned int> indices,
+                            glad::IndexFormat index_format) -> Allocation {
+  if (vertices.size() % vertex_size_ != 0) {
+    throw std::invalid_argument(
+      std::format("Vertex data of {} bytes does not match the pool vertex size {}",
+                  vertices.size(), vertex_size_));
+  }
+
+  Range range{};
+  range.vertex_count = static_cast<uint32_t>(vertices.size() / vertex_size_);
+  range.index_count = static_cast<uint32_t>(indices.size());
+  range.index_format = index_format;
+  auto encoded = glad::encode_indices(indices, index_format);
+
+  bool placed = false;
+  for (size_t i = 0; i < pages_.size() && !placed; i++) {
+    if (pages_[i]) {
+      placed = try_place(static_cast<uint32_t>(i), range);
+    }
+  }
+  if (!placed) {
+    auto page = add_page(std::max<size_t>(range.vertex_count, args_.page_vertex_count),
+                         std::max(index_words(range) * INDEX_GRANULARITY, args_.page_index_bytes));
+    try_place(page, range);
+  }
+
+  auto& page = *pages_[range.page];
+  page.vao->vbo()->write(range.base_vertex * vertex_size_, vertices);
+  page.vao->ebo()->write(range.index_offset, encoded);
+
+  return Allocation{shared_from_this(), range};
+}
+
+auto GeometryPool::vertex_array(uint32_t page) -> VertexArray& {
+  return *pages_.at(page)->vao;
+}
+
+auto GeometryPool::make_vertex_array(uint32_t page) -> std::unique_ptr<VertexArray> {
+  auto& shared = *pages_.at(page)->vao;
+  auto vao = std::make_unique<VertexArray>();
+  vao->bind();
+  vao->set_vbo(shared.vbo());
+  vao->set_ebo(shared.ebo());
+  vao->unbind();
+  return vao;
+}
+
+GeometryPoolStats GeometryPool::stats() const {
+  GeometryPoolStats stats{};
+  for (auto& page : pages_) {
+    if (!page) {
+      continue;
+    }
+    stats.page_count++;
+    stats.vertex_capacity += page->vertices.capacity();
+    stats.vertex_used += page->vertices.used();
+    stats.index_capacity += page->indices.capacity() * INDEX_GRANULARITY;
+    stats.index_used += page->indices.used() * INDEX_GRANULARITY;
+    stats.free_blocks += page->vertices.free_block_count() + page->indices.free_block_count();
+    stats.vertex_fragmentation = std::max(stats.vertex_fragmentation, page->vertices.fragmentation());
+    stats.index_fragmentation = std::max(stats.index_fragmentation, page->indices.fragmentation());
+  }
+  return stats;
+}
+
+bool GeometryPool::try_place(uint32_t page_index, Range& range) {
+  auto& page = *pages_[page_index];
+  auto base_vertex = page.vertices.allocate(range.vertex_count);
+  if (!base_vertex) {
+    return false;
+  }
+  auto index_word = page.indices.allocate(index_words(range));
+  if (!index_word) {
+    page.vertices.free(*base_vertex, range.vertex_count);
+    return false;
+  }
+  range.page = page_index;
+  range.base_vertex = static_cast<uint32_t>(*base_vertex);
+  range.index_offset = static_cast<uint32_t>(*index_word * INDEX_GRANULARITY);
+  return true;
+}
+
+size_t GeometryPool::index_words(const Range& range) {
+  auto bytes = range.index_count * glad::index_size(range.index_format);
+  return (bytes + INDEX_GRANULARITY - 1) / INDEX_GRANULARITY;
+}
+
+uint32_t GeometryPool::add_page(size_t vertex_count, size_t index_bytes) {
+  auto page = std::make_unique<Page>(Page{
+    .vao = std::make_unique<VertexArray>(),
+    .vertices = RangeAllocator{vertex_count},
+    .indices = RangeAllocator{index_bytes / INDEX_GRANULARITY},
+  });
+  page->vao->bind();
+  page->vao->set_vbo(
+    std::make_shared<glad::VertexBuffer<std::byte>>(vertex_count * vertex_size_, layout_));
+  page->vao->set_ebo(std::make_shared<glad::IndexBuffer>(index_bytes, glad::IndexFormat::U32));
+  page->vao->unbind();
+
+  auto hole = std::ranges::find_if(pages_, [](auto& slot) { return slot == nullptr; });
+  if (hole != pages_.end()) {
+    *hole = std::move(page);
+    return static_cast<uint32_t>(hole - pages_.begin());
+  }
+  pages_.push_back(std::move(page));
+  return static_cast<uint32_t>(pages_.size() - 1);
+}
+
+void GeometryPool::free(const Range& range) {
+  auto& page = pages_.at(range.page);
+  page->vertices.free(range.base_vertex, range.vertex_count);
+  page->indices.free(range.index_offset / INDEX_GRANULARITY, index_words(range));
+  // give the memory of empty pages back to the driver, the first page stays around
+  if (range.page != 0 && page->vertices.used() == 0 && page->indices.used() == 0) {
+    page.reset();
+  }
+}
@@ -0,0 +1,317 @@
+#include "LightClusters.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+#include "Profiler.hpp"
+#include "utils/ThreadPool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CLUSTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CLUSTER_TARGET_SSE
+#else
+#define CLUSTER_TARGET_SSE __attribute__((target("sse")))
+#endif
+#endif
+
+namespace {
+constexpr size_t LANES = 4;
+
+// spheres as structure of arrays, padded to LANES with spheres that touch nothing
+struct SphereSoa {
+  std::vector<float> x{};
+  std::vector<float> y{};
+  std::vector<float> z{};
+  std::vector<float> radius_sq{};
+  // light index of every sphere
+  std::vector<uint32_t> ids{};
+  size_t count{};
+
+  void clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius_sq.clear();
+    ids.clear();
+    count = 0;
+  }
+
+  void push(const glm::vec4& sphere, uint32_t id) {
+    x.push_back(sphere.x);
+    y.push_back(sphere.y);
+    z.push_back(sphere.z);
+    radius_sq.push_back(sphere.w * sphere.w);
+    ids.push_back(id);
+    count++;
+  }
+
+  void push(const SphereSoa& other, uint32_t i) {
+    x.push_back(other.x[i]);
+    y.push_back(other.y[i]);
+    z.push_back(other.z[i]);
+    radius_sq.push_back(other.radius_sq[i]);
+    ids.push_back(other.ids[i]);
+    count++;
+  }
+
+  // the squared distance to a box is never negative
+  void pad() {
+    while (x.size() % LANES != 0) {
+      x.push_back(0.0f);
+      y.push_back(0.0f);
+      z.push_back(0.0f);
+      radius_sq.push_back(-1.0f);
+      ids.push_back(0);
+    }
+  }
+};
+
+float axis_distance(float value, float min, float max) {
+  return std::max(std::max(min - value, value - max), 0.0f);
+}
+
+// writes the positions in spheres of the spheres touching box, in ascending order
+size_t overlap_scalar(const SphereSoa& spheres, const Aabb& box, uint32_t* out) {
+  size_t hits{};
+  for (size_t i = 0; i < spheres.count; i++) {
+    float dx = axis_distance(spheres.x[i], box.min.x, box.max.x);
+    float dy = axis_distance(spheres.y[i], box.min.y, box.max.y);
+    float dz = axis_distance(spheres.z[i], box.min.z, box.max.z);
+    out[hits] = static_cast<uint32_t>(i);
+    hits += dx * dx + dy * dy + dz * dz <= spheres.radius_sq[i];
+  }
+  return hits;
+}
+
+#ifdef CLUSTER_X86
+CLUSTER_TARGET_SSE size_t overlap_sse(const SphereSoa& spheres, const Aabb& box, uint32_t* out) {
+  const __m128 min_x = _mm_set1_ps(box.min.x);
+  const __m128 min_y = _mm_set1_ps(box.min.y);
+  const __m128 min_z = _mm_set1_ps(box.min.z);
+  const __m128 max_x = _mm_set1_ps(box.max.x);
+  const __m128 max_y = _mm_set1_ps(box.max.y);
+  const __m128 max_z = _mm_set1_ps(box.max.z);
+  const __m128 zero = _mm_setzero_ps();
+
+  auto distance = [&](__m128 value, __m128 min, __m128 max) {
+    auto d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min, value), _mm_sub_ps(value, max)), zero);
+    return _mm_mul_ps(d, d);
+  };
+
+  size_t hits{};
+  for (size_t i = 0; i < spheres.x.size(); i += LANES) {
+    __m128 dist_sq = distance(_mm_loadu_ps(spheres.x.data() + i), min_x, max_x);
+    dist_sq = _mm_add_ps(dist_sq, distance(_mm_loadu_ps(spheres.y.data() + i), min_y, max_y));
+    dist_sq = _mm_add_ps(dist_sq, distance(_mm_loadu_ps(spheres.z.data() + i), min_z, max_z));
+    __m128 inside = _mm_cmple_ps(dist_sq, _mm_loadu_ps(spheres.radius_sq.data() + i));
+
+    for (auto mask = static_cast<unsigned>(_mm_movemask_ps(inside)); mask; mask &= mask - 1) {
+      out[hits++] = static_cast<uint32_t>(i + std::countr_zero(mask));
+    }
+  }
+  return hits;
+}
+#endif
+
+size_t overlap(const SphereSoa& spheres, const Aabb& box, uint32_t* out, bool simd) {
+#ifdef CLUSTER_X86
+  if (simd) {
+    return overlap_sse(spheres, box, out);
+  }
+#endif
+  return overlap_scalar(spheres, box, out);
+}
+} // namespace
+
+// candidates of a slice are narrowed to a tile row before the per tile tests
+struct LightClusters::Slice {
+  SphereSoa slice_lights{};
+  SphereSoa row_lights{};
+  std::vector<uint32_t> hits{};
+  std::vector<uint32_t> indices{};
+  size_t overflowed{};
+};
+
+struct LightClusters::Buffers {
+  glad::TextureBuffer lights{GL_RGBA32F};
+  glad::TextureBuffer ranges{GL_RG32UI};
+  glad::TextureBuffer indices{GL_R32UI};
+};
+
+LightClusters::LightClusters(const ClusterArgs& args)
+  : args_(args), slices_(args.slices), ranges_(cluster_count()) {}
+
+LightClusters::~LightClusters() = default;
+
+void LightClusters::set_projection(float fov_y, float near, float far, const glm::vec2& viewport) {
+  if (fov_y == fov_y_ && near == near_ && far == far_ && viewport == viewport_) {
+    return;
+  }
+  fov_y_ = fov_y;
+  near_ = near;
+  far_ = far;
+  viewport_ = viewport;
+  build_bounds();
+}
+
+float LightClusters::slice_depth(uint32_t slice) const {
+  return near_ * std::pow(far_ / near_, static_cast<float>(slice) / static_cast<float>(args_.slices));
+}
+
+void LightClusters::build_bounds() {
+  float tan_y = std::tan(fov_y_ * 0.5f);
+  float tan_x = tan_y * viewport_.x / viewport_.y;
+  auto ndc = [](uint32_t tile, uint32_t tiles) {
+    return -1.0f + 2.0f * static_cast<float>(tile) / static_cast<float>(tiles);
+  };
+
+  bounds_.assign(cluster_count(), Aabb{});
+  row_bounds_.assign(args_.tiles_y * args_.slices, Aabb{});
+  for (uint32_t slice = 0; slice < args_.slices; slice++) {
+    float depths[] = {slice_depth(slice), slice_depth(slice + 1)};
+    for (uint32_t y = 0; y < args_.tiles_y; y++) {
+      for (uint32_t x = 0; x < args_.tiles_x; x++) {
+        auto& box = bounds_[cluster_index(x, y, slice)];
+        // the tile frustum between both depths, its corners bound it
+        for (float depth : depths) {
+          for (uint32_t cx : {x, x + 1}) {
+            for (uint32_t cy : {y, y + 1}) {
+              box.expand(glm::vec3{ndc(cx, args_.tiles_x) * tan_x * depth,
+                                   ndc(cy, args_.tiles_y) * tan_y * depth, depth});
+            }
+          }
+        }
+        row_bounds_[slice * args_.tiles_y + y].expand(box);
+      }
+    }
+  }
+}
+
+void LightClusters::bin(std::span<const ClusterLight> lights, const glm::mat4& view) {
+  PROFILE_ZONE("LightClusters::bin");
+  auto start = std::chrono::steady_clock::now();
+  if (bounds_.empty()) {
+    spdlog::warn("LightClusters::bin before set_projection, no light is binned");
+    return;
+  }
+
+  lights_.assign(lights.begin(), lights.end());
+  view_lights_.resize(lights.size());
+  for (size_t i = 0; i < lights.size(); i++) {
+    auto position = view * glm::vec4{lights[i].position, 1.0f};
+    view_lights_[i] = glm::vec4{position.x, position.y, -position.z, lights[i].radius};
+  }
+
+  if (args_.parallel) {
+    ThreadPool::shared().parallel_for(args_.slices, [&](size_t slice) {
+      bin_slice(static_cast<uint32_t>(slice));
+    });
+  } else {
+    for (uint32_t slice = 0; slice < args_.slices; slice++) {
+      bin_slice(slice);
+    }
+  }
+
+  // the slices wrote their clusters' lists separately, concatenate them in cluster order
+  stats_ = Stats{.lights = lights.size()};
+  indices_.clear();
+  uint32_t tiles = args_.tiles_x * args_.tiles_y;
+  for (uint32_t slice = 0; slice < args_.slices; slice++) {
+    auto& bins = slices_[slice];
+    auto base = static_cast<uint32_t>(indices_.size());
+    for (uint32_t tile = 0; tile < tiles; tile++) {
+      auto& range = ranges_[slice * tiles + tile];
+      range.x += base;
+      stats_.max_cluster_lights = std::max(stats_.max_cluster_lights, range.y);
+    }
+    indices_.insert(indices_.end(), bins.indices.begin(), bins.indices.end());
+    stats_.overflowed_clusters += bins.overflowed;
+  }
+  stats_.references = indices_.size();
+
+  auto end = std::chrono::steady_clock::now();
+  stats_.bin_ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void LightClusters::bin_slice(uint32_t slice) {
+  PROFILE_ZONE("LightClusters::bin_slice");
+  auto& bins = slices_[slice];
+  bins.indices.clear();
+  bins.overflowed = 0;
+
+  // lights overlapping the depth range of the slice
+  float near = slice_depth(slice);
+  float far = slice_depth(slice + 1);
+  bins.slice_lights.clear();
+  for (size_t i = 0; i < view_lights_.size(); i++) {
+    auto& light = view_lights_[i];
+    if (light.z + light.w > near && light.z - light.w < far) {
+      bins.slice_lights.push(light, static_cast<uint32_t>(i));
+    }
+  }
+  bins.slice_lights.pad();
+  bins.hits.resize(bins.slice_lights.x.size());
+
+  for (uint32_t y = 0; y < args_.tiles_y; y++) {
+    auto& row = bins.row_lights;
+    row.clear();
+    auto row_hits = overlap(bins.slice_lights, row_bounds_[slice * args_.tiles_y + y],
+                            bins.hits.data(), args_.simd);
+    for (size_t h = 0; h < row_hits; h++) {
+      row.push(bins.slice_lights, bins.hits[h]);
+    }
+    row.pad();
+
+    for (uint32_t x = 0; x < args_.tiles_x; x++) {
+      auto cluster = cluster_index(x, y, slice);
+      auto hits = overlap(row, bounds_[cluster], bins.hits.data(), args_.simd);
+      if (hits > args_.max_lights_per_cluster) {
+        hits = args_.max_lights_per_cluster;
+        bins.overflowed++;
+      }
+
+      // offsets are local to the slice until bin() concatenates the slices
+      ranges_[cluster] = glm::uvec2{static_cast<uint32_t>(bins.indices.size()),
+                                    static_cast<uint32_t>(hits)};
+      for (size_t h = 0; h < hits; h++) {
+        bins.indices.push_back(row.ids[bins.hits[h]]);
+      }
+    }
+  }
+}
+
+void LightClusters::upload() {
+  if (indices_.size() > glad::TextureBuffer::max_texels()) {
+    spdlog::error("{} cluster light indices exceed the texture buffer size {}, lower "
+                  "max_lights_per_cluster", indices_.size(), glad::TextureBuffer::max_texels());
+    return;
+  }
+  if (!buffers_) {
+    buffers_ = std::make_unique<Buffers>();
+  }
+  buffers_->lights.update(std::span<const ClusterLight>{lights_});
+  buffers_->ranges.update(std::span<const glm::uvec2>{ranges_});
+  buffers_->indices.update(std::span<const uint32_t>{indices_});
+}
+
+void LightClusters::bind(const Shader& shader) const {
+  if (!buffers_) {
+    return;
+  }
+  shader.set_sampler("clusterLights", static_cast<int>(buffers_->lights.bind()));
+  shader.set_sampler("clusterRanges", static_cast<int>(buffers_->ranges.bind()));
+  shader.set_sampler("clusterIndices", static_cast<int>(buffers_->indices.bind()));
+
+  // slice = log(depth) * scale + bias
+  float scale = static_cast<float>(args_.slices) / std::log(far_ / near_);
+  shader.uniform<glm::vec3>("clusterGrid")
+    .set(glm::vec3{args_.tiles_x, args_.tiles_y, args_.slices});
+  shader.uniform<glm::vec2>("clusterDepth").set(glm::vec2{scale, -std::log(near_) * scale});
+  shader.uniform<glm::vec2>("clusterViewport").set(viewport_);
+}
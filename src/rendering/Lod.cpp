@@ -0,0 +1,43 @@
+#include "Lod.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LodSettings LodSettings::from_camera(const Camera& camera, float viewport_height) {
+  return LodSettings{
+    .viewport_height = viewport_height,
+    .fov_y = glm::radians(camera.zoom_),
+  };
+}
+
+float projected_error(float error, float distance, const LodSettings& settings) {
+  // pixels per world unit at distance 1
+  float pixels = settings.viewport_height / (2.0f * std::tan(settings.fov_y * 0.5f));
+  return error * pixels / std::max(distance, 1e-4f);
+}
+
+uint32_t select_lod(std::span<const MeshLod> lods, uint32_t current, float distance,
+                    float error_scale, const LodSettings& settings) {
+  if (!settings.enabled || lods.size() <= 1) {
+    return 0;
+  }
+  current = std::min<uint32_t>(current, static_cast<uint32_t>(lods.size() - 1));
+
+  auto coarsest_within = [&](float max_pixels) {
+    uint32_t lod{};
+    for (uint32_t i = 1; i < lods.size(); i++) {
+      if (projected_error(lods[i].error * error_scale, distance, settings) <= max_pixels) {
+        lod = i;
+      }
+    }
+    return lod;
+  };
+
+  // refine as soon as the current level is too coarse, coarsen only with margin
+  uint32_t finer = coarsest_within(settings.max_pixel_error);
+  if (finer < current) {
+    return finer;
+  }
+  uint32_t coarser = coarsest_within(settings.max_pixel_error * (1.0f - settings.hysteresis));
+  return std::max(current, coarser);
+}
@@ -1,39 +1,228 @@
 #include "Mesh.hpp"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-           std::vector<std::shared_ptr<Texture>> textures)
-  : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)) {
-  setup_mesh();
-}
-
-void Mesh::setup_mesh() {
-  auto layout = std::make_shared<glad::VertexBufferLayout>(
-    std::vector<glad::VertexAttribute>{
-      {0, "Position", glad::ArrtibuteType::Position},
-      {1, "Normal", glad::ArrtibuteType::Normal},
-      {2, "TexCoords", glad::ArrtibuteType::TexCoords},
-      {3, "Tangent", glad::ArrtibuteType::Tangent},
-      {4, "Bitangent", glad::ArrtibuteType::Bitangent},
-      {5, "BoneID", glad::ArrtibuteType::BonesID, false, GL_INT},
-      {6, "Weight", glad::ArrtibuteType::Weight}
-    });
-
-  vao_ = std::make_unique<glad::VertexArray<Vertex>>();
-  vao_->bind();
-  vao_->set_vbo(vertices, layout);
-  vao_->set_ebo(indices);
-
-  vao_->unbind();
-}
-
-void Mesh::draw(const Shader& shader) {
-  for (auto& texture : textures) {
-    texture->bind();
-    shader.set_int(texture->unform_name(), texture->unit_index());
-  }
-  vao_->bind();
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-  vao_->unbind();
-
-  glActiveTexture(GL_TEXTURE0);
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "utils/Hash.hpp"
+
+PackedVertex pack_vertex(const Vertex& vertex) {
+  PackedVertex packed{};
+  packed.Position = vertex.Position;
+  // meshes without normals leave them at zero, normalize would give nan
+  auto normal = glm::length(vertex.Normal) > 0.0f ? glm::normalize(vertex.Normal)
+                                                  : glm::vec3{0.0f};
+  packed.Normal = glm::packSnorm3x10_1x2(glm::vec4{normal, 0.0f});
+  packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+
+  // handedness of the tangent frame goes into w
+  float sign = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f
+                 ? -1.0f
+                 : 1.0f;
+  auto tangent = glm::length(vertex.Tangent) > 0.0f ? glm::normalize(vertex.Tangent)
+                                                    : glm::vec3{0.0f};
+  packed.Tangent = glm::packSnorm3x10_1x2(glm::vec4{tangent, sign});
+
+  float weight_sum{};
+  for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+    weight_sum += vertex.w_Weights[i];
+  }
+  for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+    packed.m_BoneIDs[i] = static_cast<uint8_t>(std::clamp(vertex.m_BoneIDs[i], 0, 255));
+    float weight = weight_sum > 0.0f ? vertex.w_Weights[i] / weight_sum : 0.0f;
+    packed.w_Weights[i] = static_cast<uint8_t>(std::round(weight * 255.0f));
+  }
+  return packed;
+}
+
+std::vector<PackedVertex> pack_vertices(std::span<const Vertex> vertices) {
+  std::vector<PackedVertex> packed(vertices.size());
+  std::ranges::transform(vertices, packed.begin(), pack_vertex);
+  return packed;
+}
+
+MeshBounds compute_bounds(std::span<const Vertex> vertices) {
+  MeshBounds bounds{};
+  for (auto& vertex : vertices) {
+    bounds.aabb.expand(vertex.Position);
+  }
+  if (bounds.aabb.empty()) {
+    return bounds;
+  }
+
+  float radius_squared{};
+  auto center = bounds.aabb.center();
+  for (auto& vertex : vertices) {
+    auto offset = vertex.Position - center;
+    radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+  }
+  bounds.sphere = BoundingSphere{center, std::sqrt(radius_squared)};
+  return bounds;
+}
+
+std::vector<MeshData> split_mesh(const MeshView& mesh, size_t max_vertices) {
+  constexpr uint32_t UNUSED = ~0u;
+
+  std::vector<MeshData> parts;
+  std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+  std::vector<unsigned int> touched;
+  MeshData part{};
+
+  auto finish_part = [&] {
+    part.textures = mesh.textures;
+    part.node = mesh.node;
+    parts.push_back(std::move(part));
+    part = MeshData{};
+    for (auto vertex : touched) {
+      remap[vertex] = UNUSED;
+    }
+    touched.clear();
+  };
+
+  auto indices = mesh.lods.empty()
+                   ? mesh.indices
+                   : mesh.indices.subspan(mesh.lods[0].first_index, mesh.lods[0].index_count);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    auto triangle = indices.subspan(i, 3);
+    size_t new_vertices{};
+    for (size_t k = 0; k < 3; k++) {
+      bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+      new_vertices += remap[triangle[k]] == UNUSED && !repeated;
+    }
+    if (part.vertices.size() + new_vertices > max_vertices) {
+      finish_part();
+    }
+
+    for (auto vertex : triangle) {
+      if (remap[vertex] == UNUSED) {
+        remap[vertex] = static_cast<uint32_t>(part.vertices.size());
+        part.vertices.push_back(mesh.vertices[vertex]);
+        touched.push_back(vertex);
+      }
+      part.indices.push_back(remap[vertex]);
+    }
+  }
+  if (!part.indices.empty()) {
+    finish_part();
+  }
+
+  return parts;
+}
+
+Mesh::Mesh(GeometryPool& pool, std::span<const std::byte> vertices,
+           std::span<const unsigned int> indices, glad::IndexFormat index_format,
+           const MeshBounds& bounds, std::span<const MeshLod> lods,
+           std::vector<MeshTexture> textures)
+  : textures(std::move(textures)),
+    geometry_(pool.allocate(vertices, indices, index_format)),
+    bounds_(bounds),
+    lods_(lods.begin(), lods.end()) {
+  if (lods_.empty()) {
+    lods_.push_back(MeshLod{0, static_cast<uint32_t>(indices.size()), 0.0f});
+  }
+}
+
+auto Mesh::vertex_layout(VertexFormat format) -> std::shared_ptr<glad::VertexBufferLayout> {
+  using glad::ArrtibuteType;
+  std::vector<glad::VertexAttribute> attributes;
+  if (format == VertexFormat::Packed) {
+    attributes = {
+      {.index = 0, .name = "Position", .type = ArrtibuteType::Position},
+      {.index = 1, .name = "Normal", .type = ArrtibuteType::PackedNormal, .is_normalize = true,
+       .data_type = GL_INT_2_10_10_10_REV},
+      {.index = 2, .name = "TexCoords", .type = ArrtibuteType::TexCoords,
+       .data_type = GL_HALF_FLOAT},
+      {.index = 3, .name = "Tangent", .type = ArrtibuteType::PackedTangent, .is_normalize = true,
+       .data_type = GL_INT_2_10_10_10_REV},
+      {.index = 5, .name = "BoneID", .type = ArrtibuteType::BonesID,
+       .data_type = GL_UNSIGNED_BYTE, .is_integer = true},
+      {.index = 6, .name = "Weight", .type = ArrtibuteType::Weight, .is_normalize = true,
+       .data_type = GL_UNSIGNED_BYTE},
+    };
+  } else {
+    attributes = {
+      {0, "Position", ArrtibuteType::Position},
+      {1, "Normal", ArrtibuteType::Normal},
+      {2, "TexCoords", ArrtibuteType::TexCoords},
+      {3, "Tangent", ArrtibuteType::Tangent},
+      {4, "Bitangent", ArrtibuteType::Bitangent},
+      {.index = 5, .name = "BoneID", .type = ArrtibuteType::BonesID, .data_type = GL_INT,
+       .is_integer = true},
+      {6, "Weight", ArrtibuteType::Weight}
+    };
+  }
+  return std::make_shared<glad::VertexBufferLayout>(std::move(attributes));
+}
+
+auto Mesh::geometry_pool(VertexFormat format) -> std::shared_ptr<GeometryPool> {
+  static std::array<std::weak_ptr<GeometryPool>, 2> shared_pools{};
+  auto& shared_pool = shared_pools[static_cast<size_t>(format)];
+  if (auto pool = shared_pool.lock()) {
+    return pool;
+  }
+
+  auto vertex_size = format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+  auto pool = std::make_shared<GeometryPool>(vertex_layout(format), vertex_size);
+  shared_pool = pool;
+  return pool;
+}
+
+void Mesh::draw(const Shader& shader, uint32_t lod) {
+  PROFILE_ZONE("Mesh::draw");
+  bind_textures(shader);
+  auto& range = geometry_.range();
+  auto& level = lods_[std::min<size_t>(lod, lods_.size() - 1)];
+  auto& vao = geometry_.pool().vertex_array(range.page);
+  vao.bind();
+  vao.draw_elements(glad::DrawMode::Triangles, static_cast<GLsizei>(level.index_count),
+                    range.index_format, index_offset(level),
+                    static_cast<GLint>(range.base_vertex));
+}
+
+void Mesh::draw_instanced(const Shader& shader, GeometryPool::VertexArray& vao,
+                          GLsizei instance_count, uint32_t lod) {
+  PROFILE_ZONE("Mesh::draw_instanced");
+  bind_textures(shader);
+  auto& range = geometry_.range();
+  auto& level = lods_[std::min<size_t>(lod, lods_.size() - 1)];
+  vao.bind();
+  vao.draw_elements_instanced(glad::DrawMode::Triangles, static_cast<GLsizei>(level.index_count),
+                              range.index_format, index_offset(level),
+                              static_cast<GLint>(range.base_vertex), instance_count);
+}
+
+auto Mesh::packet(Shader& shader, uint32_t lod) const -> DrawPacket {
+  auto& level = lods_[std::min<size_t>(lod, lods_.size() - 1)];
+  uint64_t material{};
+  for (auto& [texture, uniform_name] : textures) {
+    material = hash_combine(material, reinterpret_cast<uintptr_t>(texture.get()));
+    material = hash_combine(material, hash_string(uniform_name));
+  }
+
+  return DrawPacket{
+    .shader = &shader,
+    .program = shader.ID,
+    .material = material,
+    .textures = textures,
+    .vao = geometry_.pool().vertex_array(geometry_.range().page).id(),
+    .index_count = static_cast<GLsizei>(level.index_count),
+    .index_type = glad::index_type(geometry_.range().index_format),
+    .index_offset = index_offset(level),
+    .base_vertex = static_cast<GLint>(geometry_.range().base_vertex),
+  };
+}
+
+size_t Mesh::index_offset(const MeshLod& lod) const {
+  auto& range = geometry_.range();
+  return range.index_offset + lod.first_index * glad::index_size(range.index_format);
+}
+
+void Mesh::bind_textures(const Shader& shader) {
+  glad::ContextState::current().next_draw();
+  for (auto& [texture, uniform_name] : textures) {
+    shader.set_sampler(uniform_name, texture->bind());
+  }
 }
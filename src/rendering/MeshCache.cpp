@@ -0,0 +1,332 @@
+#include "MeshCache.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "SceneGraph.hpp"
+#include "utils/Hash.hpp"
+
+namespace {
+constexpr size_t DATA_ALIGNMENT = 16;
+
+struct TextureRecord {
+  uint32_t type;
+  uint32_t slot;
+  uint32_t path_length;
+};
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+T read_pod(std::span<const std::byte> bytes, size_t offset) {
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+// offset + count * size <= bytes.size(), written so that nothing can wrap
+bool fits(std::span<const std::byte> bytes, uint64_t offset, uint64_t count, size_t size) {
+  return offset <= bytes.size() && count <= (bytes.size() - offset) / size;
+}
+
+// every record and path of a mesh's texture table lies inside the file
+bool texture_table_fits(std::span<const std::byte> bytes, uint64_t offset, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (!fits(bytes, offset, 1, sizeof(TextureRecord))) {
+      return false;
+    }
+    auto texture = read_pod<TextureRecord>(bytes, offset);
+    offset += sizeof(TextureRecord);
+    if (texture.path_length > bytes.size() - offset) {
+      return false;
+    }
+    offset += texture.path_length;
+  }
+  return true;
+}
+
+template <typename T>
+void write_pod(std::vector<std::byte>& buf, size_t offset, const T& value) {
+  std::memcpy(buf.data() + offset, &value, sizeof(T));
+}
+
+size_t source_block_size(std::span<const std::string> source_files) {
+  size_t size{};
+  for (auto& path : source_files) {
+    size += sizeof(uint32_t) + path.size();
+  }
+  return size;
+}
+
+size_t texture_block_size(const std::vector<TextureRef>& textures) {
+  size_t size{};
+  for (auto& texture : textures) {
+    size += sizeof(TextureRecord) + texture.path.size();
+  }
+  return size;
+}
+} // namespace
+
+MeshCache::MeshCache(MappedFile file, uint32_t mesh_count, uint32_t node_count)
+  : file_(std::move(file)), mesh_count_(mesh_count), node_count_(node_count) {}
+
+std::string MeshCache::cache_path(std::string_view source_path) {
+  return std::format("{}.meshcache", source_path);
+}
+
+uint64_t MeshCache::source_hash(std::span<const std::string> source_files) {
+  uint64_t hash{};
+  for (auto& path : source_files) {
+    hash = hash_combine(hash, hash_string(path));
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+      hash = hash_combine(hash, ~0ull);
+      continue;
+    }
+    MappedFile source{std::filesystem::path{path}};
+    hash = hash_combine(hash, hash_combine(hash_bytes(source.bytes()), source.size()));
+  }
+  return hash;
+}
+
+void MeshCache::write(std::string_view cache_path, uint64_t options_hash, const ModelData& model) {
+  auto& meshes = model.meshes;
+  size_t node_offset = sizeof(CacheHeader) + meshes.size() * sizeof(MeshRecord);
+  size_t source_offset = node_offset + model.nodes.size() * sizeof(NodeRecord);
+  size_t offset = align_up(source_offset + source_block_size(model.source_files), DATA_ALIGNMENT);
+
+  std::vector<MeshRecord> records;
+  records.reserve(meshes.size());
+  for (auto& mesh : meshes) {
+    MeshRecord record{};
+    record.texture_offset = offset;
+    record.texture_count = static_cast<uint32_t>(mesh.textures.size());
+    record.node = mesh.node;
+    offset = align_up(offset + texture_block_size(mesh.textures), DATA_ALIGNMENT);
+
+    record.lod_offset = offset;
+    record.lod_count = static_cast<uint32_t>(mesh.lods.size());
+    offset = align_up(offset + mesh.lods.size() * sizeof(MeshLod), DATA_ALIGNMENT);
+
+    record.vertex_offset = offset;
+    record.vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+    offset = align_up(offset + mesh.vertices.size() * sizeof(Vertex), DATA_ALIGNMENT);
+
+    record.index_offset = offset;
+    record.index_count = static_cast<uint32_t>(mesh.indices.size());
+    offset = align_up(offset + mesh.indices.size() * sizeof(unsigned int), DATA_ALIGNMENT);
+
+    records.push_back(record);
+  }
+
+  std::vector<std::byte> buf(offset);
+
+  CacheHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.source_hash = hash_combine(source_hash(model.source_files), options_hash);
+  header.vertex_size = sizeof(Vertex);
+  header.mesh_count = static_cast<uint32_t>(meshes.size());
+  header.node_count = static_cast<uint32_t>(model.nodes.size());
+  header.source_count = static_cast<uint32_t>(model.source_files.size());
+  write_pod(buf, 0, header);
+
+  for (auto& path : model.source_files) {
+    write_pod(buf, source_offset, static_cast<uint32_t>(path.size()));
+    source_offset += sizeof(uint32_t);
+    std::memcpy(buf.data() + source_offset, path.data(), path.size());
+    source_offset += path.size();
+  }
+
+  for (size_t i = 0; i < model.nodes.size(); i++) {
+    NodeRecord record{};
+    record.parent = model.nodes[i].parent;
+    std::memcpy(record.local, &model.nodes[i].local[0][0], sizeof(record.local));
+    write_pod(buf, node_offset + i * sizeof(NodeRecord), record);
+  }
+
+  for (size_t i = 0; i < meshes.size(); i++) {
+    auto& mesh = meshes[i];
+    auto& record = records[i];
+    write_pod(buf, sizeof(CacheHeader) + i * sizeof(MeshRecord), record);
+
+    size_t texture_offset = record.texture_offset;
+    for (auto& texture : mesh.textures) {
+      write_pod(buf, texture_offset,
+                TextureRecord{
+                  static_cast<uint32_t>(texture.type),
+                  texture.slot,
+                  static_cast<uint32_t>(texture.path.size()),
+                });
+      texture_offset += sizeof(TextureRecord);
+      std::memcpy(buf.data() + texture_offset, texture.path.data(), texture.path.size());
+      texture_offset += texture.path.size();
+    }
+
+    std::memcpy(buf.data() + record.lod_offset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+    std::memcpy(buf.data() + record.vertex_offset, mesh.vertices.data(),
+                mesh.vertices.size() * sizeof(Vertex));
+    std::memcpy(buf.data() + record.index_offset, mesh.indices.data(),
+                mesh.indices.size() * sizeof(unsigned int));
+  }
+
+  // write to a temporary file first so a crash never leaves a truncated cache behind
+  auto tmp_path = std::format("{}.tmp", cache_path);
+  {
+    std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      throw std::runtime_error(std::format("Failed to open file: {}", tmp_path));
+    }
+    file.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    if (!file) {
+      throw std::runtime_error(std::format("Failed to write file: {}", tmp_path));
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, cache_path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    throw std::runtime_error(std::format("Failed to replace mesh cache: {}", cache_path));
+  }
+}
+
+auto MeshCache::open(std::string_view cache_path, uint64_t options_hash) -> std::optional<MeshCache> {
+  if (!std::filesystem::exists(cache_path)) {
+    return std::nullopt;
+  }
+
+  MappedFile file{std::filesystem::path{cache_path}};
+  auto bytes = file.bytes();
+  if (bytes.size() < sizeof(CacheHeader)) {
+    spdlog::warn("Mesh cache {} is truncated", cache_path);
+    return std::nullopt;
+  }
+
+  auto header = read_pod<CacheHeader>(bytes, 0);
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+      header.vertex_size != sizeof(Vertex)) {
+    spdlog::info("Mesh cache {} was written by another version, rebuilding", cache_path);
+    return std::nullopt;
+  }
+
+  size_t source_offset = sizeof(CacheHeader) + header.mesh_count * sizeof(MeshRecord) +
+                       header.node_count * sizeof(NodeRecord);
+  if (bytes.size() < source_offset) {
+    spdlog::warn("Mesh cache {} is truncated", cache_path);
+    return std::nullopt;
+  }
+
+  std::vector<std::string> source_files{};
+  for (uint32_t i = 0; i < header.source_count; i++) {
+    if (bytes.size() - source_offset < sizeof(uint32_t)) {
+      spdlog::warn("Mesh cache {} is corrupted", cache_path);
+      return std::nullopt;
+    }
+    auto length = read_pod<uint32_t>(bytes, source_offset);
+    source_offset += sizeof(uint32_t);
+    if (bytes.size() - source_offset < length) {
+      spdlog::warn("Mesh cache {} is corrupted", cache_path);
+      return std::nullopt;
+    }
+    source_files.emplace_back(reinterpret_cast<const char*>(bytes.data() + source_offset), length);
+    source_offset += length;
+  }
+
+  if (header.source_hash != hash_combine(source_hash(source_files), options_hash)) {
+    spdlog::info("Mesh cache {} is stale, rebuilding", cache_path);
+    return std::nullopt;
+  }
+
+  MeshCache cache{std::move(file), header.mesh_count, header.node_count};
+  for (size_t i = 0; i < cache.mesh_count_; i++) {
+    auto record = cache.record(i);
+    bool in_bounds =
+      record.node < cache.node_count_ &&
+      record.vertex_offset % DATA_ALIGNMENT == 0 && record.index_offset % DATA_ALIGNMENT == 0 &&
+      fits(bytes, record.vertex_offset, record.vertex_count, sizeof(Vertex)) &&
+      fits(bytes, record.index_offset, record.index_count, sizeof(unsigned int)) &&
+      texture_table_fits(bytes, record.texture_offset, record.texture_count) &&
+      record.lod_offset % DATA_ALIGNMENT == 0 &&
+      fits(bytes, record.lod_offset, record.lod_count, sizeof(MeshLod));
+    for (uint32_t lod = 0; in_bounds && lod < record.lod_count; lod++) {
+      auto range = read_pod<MeshLod>(bytes, record.lod_offset + lod * sizeof(MeshLod));
+      in_bounds = uint64_t{range.first_index} + range.index_count <= record.index_count;
+    }
+    if (!in_bounds) {
+      spdlog::warn("Mesh cache {} is corrupted", cache_path);
+      return std::nullopt;
+    }
+  }
+  for (size_t i = 0; i < cache.node_count_; i++) {
+    auto parent = read_pod<uint32_t>(bytes, cache.node_offset() + i * sizeof(NodeRecord));
+    if (parent != SceneGraph::NO_PARENT && parent >= i) {
+      spdlog::warn("Mesh cache {} is corrupted", cache_path);
+      return std::nullopt;
+    }
+  }
+
+  return cache;
+}
+
+size_t MeshCache::mesh_count() const {
+  return mesh_count_;
+}
+
+auto MeshCache::mesh(size_t index) const -> MeshView {
+  auto bytes = file_.bytes();
+  auto record = this->record(index);
+
+  MeshView view{
+    .vertices = {reinterpret_cast<const Vertex*>(bytes.data() + record.vertex_offset),
+                 record.vertex_count},
+    .indices = {reinterpret_cast<const unsigned int*>(bytes.data() + record.index_offset),
+                record.index_count},
+    .node = record.node,
+    .lods = {reinterpret_cast<const MeshLod*>(bytes.data() + record.lod_offset), record.lod_count},
+  };
+
+  // the table was validated by open()
+  size_t offset = record.texture_offset;
+  view.textures.reserve(record.texture_count);
+  for (uint32_t i = 0; i < record.texture_count; i++) {
+    auto texture = read_pod<TextureRecord>(bytes, offset);
+    offset += sizeof(TextureRecord);
+    view.textures.push_back(TextureRef{
+      .type = static_cast<TextureType>(texture.type),
+      .slot = texture.slot,
+      .path = std::string{reinterpret_cast<const char*>(bytes.data() + offset), texture.path_length},
+    });
+    offset += texture.path_length;
+  }
+
+  return view;
+}
+
+auto MeshCache::nodes() const -> std::vector<NodeData> {
+  std::vector<NodeData> nodes;
+  nodes.reserve(node_count_);
+  for (size_t i = 0; i < node_count_; i++) {
+    auto record = read_pod<NodeRecord>(file_.bytes(), node_offset() + i * sizeof(NodeRecord));
+    NodeData node{.parent = record.parent};
+    std::memcpy(&node.local[0][0], record.local, sizeof(record.local));
+    nodes.push_back(node);
+  }
+  return nodes;
+}
+
+size_t MeshCache::node_offset() const {
+  return sizeof(CacheHeader) + mesh_count_ * sizeof(MeshRecord);
+}
+
+auto MeshCache::record(size_t index) const -> MeshRecord {
+  return read_pod<MeshRecord>(file_.bytes(), sizeof(CacheHeader) + index * sizeof(MeshRecord));
+}
@@ -0,0 +1,344 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
+
+#include "Profiler.hpp"
+#include "utils/Hash.hpp"
+#include "utils/ThreadPool.hpp"
+
+namespace {
+constexpr uint32_t INVALID = ~0u;
+
+// vertex -> triangle adjacency, triangles of vertex v are triangles[offsets[v], offsets[v + 1])
+struct Adjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+Adjacency build_adjacency(std::span<const unsigned int> indices, size_t vertex_count) {
+  Adjacency adjacency{};
+  adjacency.offsets.assign(vertex_count + 1, 0);
+  for (auto index : indices) {
+    adjacency.offsets[index + 1]++;
+  }
+  std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+  return adjacency;
+}
+
+// FIFO cache simulation by timestamps: a vertex is resident while fewer than
+// cache_size vertices were transformed after it
+class CacheSimulator {
+public:
+  CacheSimulator(size_t vertex_count, uint32_t cache_size)
+    : cache_size_(cache_size), time_(cache_size + 1), cache_time_(vertex_count, 0) {}
+
+  // returns true on a miss
+  bool access(unsigned int vertex) {
+    if (time_ - cache_time_[vertex] > cache_size_) {
+      cache_time_[vertex] = time_++;
+      return true;
+    }
+    return false;
+  }
+
+  uint32_t triangle_misses(std::span<const unsigned int> triangle) {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+
+  void flush() { time_ += cache_size_ + 1; }
+
+private:
+  uint32_t cache_size_;
+  uint32_t time_;
+  std::vector<uint32_t> cache_time_;
+};
+
+struct VertexHash {
+  const Vertex* vertices;
+  size_t operator()(uint32_t index) const {
+    return hash_bytes(std::as_bytes(std::span{&vertices[index], 1}));
+  }
+};
+
+// Vertex has no padding, the whole object representation is compared
+struct VertexEqual {
+  const Vertex* vertices;
+  bool operator()(uint32_t lhs, uint32_t rhs) const {
+    return std::memcmp(&vertices[lhs], &vertices[rhs], sizeof(Vertex)) == 0;
+  }
+};
+
+bool is_triangle_list(const MeshData& mesh) {
+  return !mesh.indices.empty() && mesh.indices.size() % 3 == 0;
+}
+} // namespace
+
+VertexCacheStats analyze_vertex_cache(std::span<const unsigned int> indices, size_t vertex_count,
+                                      uint32_t cache_size) {
+  CacheSimulator cache{vertex_count, cache_size};
+  std::vector<bool> referenced(vertex_count);
+  size_t unique{};
+  size_t misses{};
+  for (auto index : indices) {
+    if (!referenced[index]) {
+      referenced[index] = true;
+      unique++;
+    }
+    misses += cache.access(index);
+  }
+
+  size_t triangle_count = indices.size() / 3;
+  return VertexCacheStats{
+    .acmr = triangle_count ? static_cast<float>(misses) / static_cast<float>(triangle_count) : 0.0f,
+    .atvr = unique ? static_cast<float>(misses) / static_cast<float>(unique) : 0.0f,
+  };
+}
+
+size_t weld_vertices(MeshData& mesh) {
+  auto& vertices = mesh.vertices;
+  std::unordered_set<uint32_t, VertexHash, VertexEqual> unique(
+    vertices.size(), VertexHash{vertices.data()}, VertexEqual{vertices.data()});
+
+  std::vector<uint32_t> remap(vertices.size());
+  std::vector<Vertex> welded;
+  welded.reserve(vertices.size());
+  for (uint32_t i = 0; i < vertices.size(); i++) {
+    auto [it, inserted] = unique.insert(i);
+    if (inserted) {
+      remap[i] = static_cast<uint32_t>(welded.size());
+      welded.push_back(vertices[i]);
+    } else {
+      remap[i] = remap[*it];
+    }
+  }
+
+  for (auto& index : mesh.indices) {
+    index = remap[index];
+  }
+  size_t removed = vertices.size() - welded.size();
+  vertices = std::move(welded);
+  return removed;
+}
+
+// Tipsify, Sander et al. 2007: fan around a vertex, then continue from the
+// neighbour that is still in the cache and has the fewest triangles left
+void optimize_vertex_cache(std::span<unsigned int> indices, size_t vertex_count,
+                           uint32_t cache_size) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  auto adjacency = build_adjacency(indices, vertex_count);
+  std::vector<uint32_t> live(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count);
+  std::vector<unsigned int> dead_end;
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+
+  uint32_t time = cache_size + 1;
+  size_t cursor = 0;
+
+  auto next_vertex = [&]() -> uint32_t {
+    uint32_t best = INVALID;
+    int64_t best_priority = -1;
+    for (auto v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      // prefer vertices that stay in the cache after their remaining triangles are emitted
+      int64_t age = time - cache_time[v];
+      int64_t priority = age + 2 * static_cast<int64_t>(live[v]) <= cache_size ? age : 0;
+      if (priority > best_priority) {
+        best_priority = priority;
+        best = v;
+      }
+    }
+    if (best != INVALID) {
+      return best;
+    }
+
+    while (!dead_end.empty()) {
+      auto v = dead_end.back();
+      dead_end.pop_back();
+      if (live[v] > 0) {
+        return v;
+      }
+    }
+
+    for (; cursor < vertex_count; cursor++) {
+      if (live[cursor] > 0) {
+        return static_cast<uint32_t>(cursor);
+      }
+    }
+    return INVALID;
+  };
+
+  for (uint32_t fanning = indices[0]; fanning != INVALID; fanning = next_vertex()) {
+    candidates.clear();
+    for (auto k = adjacency.offsets[fanning]; k < adjacency.offsets[fanning + 1]; k++) {
+      auto triangle = adjacency.triangles[k];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (size_t j = 0; j < 3; j++) {
+        auto v = indices[triangle * 3 + j];
+        result.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cache_time[v] > cache_size) {
+          cache_time[v] = time++;
+        }
+      }
+    }
+  }
+
+  std::ranges::copy(result, indices.begin());
+}
+
+// Tipsify part two: cut the cache optimized order into clusters wherever the
+// cache restarts anyway, then draw clusters facing away from the mesh center first
+void optimize_overdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices,
+                       float threshold, uint32_t cache_size) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+  auto triangle = [&](size_t t) { return indices.subspan(t * 3, 3); };
+
+  // hard boundaries: triangles that miss all three vertices
+  CacheSimulator cache{vertices.size(), cache_size};
+  std::vector<uint32_t> misses(triangle_count);
+  std::vector<size_t> hard{};
+  for (size_t t = 0; t < triangle_count; t++) {
+    misses[t] = cache.triangle_misses(triangle(t));
+    if (t == 0 || misses[t] == 3) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(triangle_count);
+
+  // soft boundaries: restarting with an empty cache is fine once the cluster
+  // so far is within threshold of the hard cluster's ACMR
+  std::vector<size_t> clusters{};
+  for (size_t h = 0; h + 1 < hard.size(); h++) {
+    size_t begin = hard[h];
+    size_t end = hard[h + 1];
+    float cluster_misses = std::accumulate(misses.begin() + begin, misses.begin() + end, 0.0f);
+    float limit = cluster_misses / static_cast<float>(end - begin) * threshold;
+
+    cache.flush();
+    clusters.push_back(begin);
+    size_t running_misses{};
+    size_t running_triangles{};
+    for (size_t t = begin; t < end; t++) {
+      running_misses += cache.triangle_misses(triangle(t));
+      running_triangles++;
+      float acmr = static_cast<float>(running_misses) / static_cast<float>(running_triangles);
+      if (acmr <= limit && t + 1 < end) {
+        clusters.push_back(t + 1);
+        cache.flush();
+        running_misses = 0;
+        running_triangles = 0;
+      }
+    }
+  }
+  clusters.push_back(triangle_count);
+
+  glm::vec3 mesh_center{};
+  for (auto index : indices) {
+    mesh_center += vertices[index].Position;
+  }
+  mesh_center /= static_cast<float>(indices.size());
+
+  // area weighted centroid and normal of every cluster
+  size_t cluster_count = clusters.size() - 1;
+  std::vector<float> sort_keys(cluster_count);
+  for (size_t cluster = 0; cluster < cluster_count; cluster++) {
+    glm::vec3 centroid{};
+    glm::vec3 normal{};
+    float area{};
+    for (size_t t = clusters[cluster]; t < clusters[cluster + 1]; t++) {
+      auto& a = vertices[indices[t * 3 + 0]].Position;
+      auto& b = vertices[indices[t * 3 + 1]].Position;
+      auto& c = vertices[indices[t * 3 + 2]].Position;
+      auto n = glm::cross(b - a, c - a);
+      float weight = glm::length(n);
+      centroid += (a + b + c) / 3.0f * weight;
+      normal += n;
+      area += weight;
+    }
+    float normal_length = glm::length(normal);
+    if (area <= 0.0f || normal_length <= 0.0f) {
+      continue;
+    }
+    sort_keys[cluster] = glm::dot(centroid / area - mesh_center, normal / normal_length);
+  }
+
+  std::vector<size_t> order(cluster_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, std::greater{}, [&](size_t c) { return sort_keys[c]; });
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  for (auto c : order) {
+    result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                  indices.begin() + clusters[c + 1] * 3);
+  }
+  std::ranges::copy(result, indices.begin());
+}
+
+void optimize_vertex_fetch(MeshData& mesh) {
+  std::vector<uint32_t> remap(mesh.vertices.size(), INVALID);
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (auto& index : mesh.indices) {
+    if (remap[index] == INVALID) {
+      remap[index] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  mesh.vertices = std::move(vertices);
+}
+
+void optimize_mesh(MeshData& mesh, const MeshOptimizeArgs& args) {
+  PROFILE_ZONE("optimize_mesh");
+  if (args.weld) {
+    weld_vertices(mesh);
+  }
+  // points and lines left over by the importer are only welded and remapped
+  if (is_triangle_list(mesh)) {
+    if (args.vertex_cache) {
+      optimize_vertex_cache(mesh.indices, mesh.vertices.size(), args.cache_size);
+    }
+    if (args.overdraw) {
+      optimize_overdraw(mesh.indices, mesh.vertices, args.overdraw_threshold, args.cache_size);
+    }
+  }
+  if (args.vertex_fetch) {
+    optimize_vertex_fetch(mesh);
+  }
+}
+
+void optimize_meshes(std::span<MeshData> meshes, const MeshOptimizeArgs& args) {
+  ThreadPool::shared().parallel_for(meshes.size(), [&](size_t i) {
+    optimize_mesh(meshes[i], args);
+  });
+}
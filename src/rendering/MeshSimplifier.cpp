@@ -0,0 +1,345 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+#include "MeshOptimizer.hpp"
+#include "Profiler.hpp"
+#include "utils/ThreadPool.hpp"
+
+namespace {
+enum class VertexKind : uint8_t {
+  Manifold,
+  // on an open edge, collapses only along the border
+  Border,
+  // seam or non-manifold, never moves
+  Locked,
+};
+
+// symmetric 4x4 matrix of summed plane equations, error is the weighted mean
+// squared distance to those planes
+struct Quadric {
+  double a2, ab, ac, ad;
+  double b2, bc, bd;
+  double c2, cd;
+  double d2;
+  double weight;
+
+  static Quadric plane(const glm::dvec3& n, double d, double weight) {
+    return Quadric{
+      n.x * n.x * weight, n.x * n.y * weight, n.x * n.z * weight, n.x * d * weight,
+      n.y * n.y * weight, n.y * n.z * weight, n.y * d * weight,
+      n.z * n.z * weight, n.z * d * weight,
+      d * d * weight,
+      weight,
+    };
+  }
+
+  void add(const Quadric& other) {
+    a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+    b2 += other.b2, bc += other.bc, bd += other.bd;
+    c2 += other.c2, cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+  }
+
+  double error(const glm::vec3& p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+               2.0 * (ad * x + bd * y + cd * z) + d2;
+    return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+  }
+};
+
+struct Collapse {
+  unsigned int from;
+  unsigned int to;
+  double cost;
+};
+
+uint64_t edge_key(uint32_t a, uint32_t b) {
+  return static_cast<uint64_t>(a) << 32 | b;
+}
+
+uint64_t position_key(const glm::vec3& p) {
+  uint64_t key = std::bit_cast<uint32_t>(p.x);
+  key = key * 0x9e3779b97f4a7c15ull ^ std::bit_cast<uint32_t>(p.y);
+  key = key * 0x9e3779b97f4a7c15ull ^ std::bit_cast<uint32_t>(p.z);
+  return key;
+}
+
+// first vertex with the same position, seams are the only reason for duplicates after welding
+std::vector<uint32_t> position_remap(std::span<const Vertex> vertices,
+                                     std::vector<uint32_t>& wedge_count) {
+  std::unordered_multimap<uint64_t, uint32_t> by_position;
+  by_position.reserve(vertices.size());
+  std::vector<uint32_t> remap(vertices.size());
+  wedge_count.assign(vertices.size(), 0);
+  for (uint32_t i = 0; i < vertices.size(); i++) {
+    auto key = position_key(vertices[i].Position);
+    remap[i] = i;
+    auto [begin, end] = by_position.equal_range(key);
+    for (auto it = begin; it != end; ++it) {
+      if (vertices[it->second].Position == vertices[i].Position) {
+        remap[i] = it->second;
+        break;
+      }
+    }
+    if (remap[i] == i) {
+      by_position.emplace(key, i);
+    }
+    wedge_count[remap[i]]++;
+  }
+  return remap;
+}
+
+glm::vec3 triangle_normal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+  return glm::cross(b - a, c - a);
+}
+} // namespace
+
+std::vector<unsigned int> simplify(std::span<const Vertex> vertices,
+                                   std::span<const unsigned int> indices,
+                                   size_t target_index_count, float max_error, float* error) {
+  std::vector<unsigned int> result(indices.begin(), indices.end());
+  double result_error{};
+  auto finish = [&] {
+    if (error) {
+      *error = static_cast<float>(std::sqrt(result_error));
+    }
+    return result;
+  };
+  if (indices.size() % 3 != 0 || indices.size() <= target_index_count) {
+    return finish();
+  }
+
+  size_t vertex_count = vertices.size();
+  auto position = [&](unsigned int v) -> const glm::vec3& { return vertices[v].Position; };
+
+  std::vector<uint32_t> wedge_count;
+  auto remap = position_remap(vertices, wedge_count);
+
+  // directed edges between positions, an edge without its opposite is a border
+  std::unordered_map<uint64_t, uint32_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; k++) {
+      auto a = remap[indices[i + k]];
+      auto b = remap[indices[i + (k + 1) % 3]];
+      edges[edge_key(a, b)]++;
+    }
+  }
+  auto is_border_edge = [&](uint32_t a, uint32_t b) {
+    return !edges.contains(edge_key(b, a)) || !edges.contains(edge_key(a, b));
+  };
+
+  std::vector<VertexKind> kinds(vertex_count, VertexKind::Manifold);
+  for (auto [key, count] : edges) {
+    auto a = static_cast<uint32_t>(key >> 32);
+    auto b = static_cast<uint32_t>(key);
+    auto opposite = edges.find(edge_key(b, a));
+    if (count > 1 || (opposite != edges.end() && opposite->second > 1)) {
+      kinds[a] = kinds[b] = VertexKind::Locked;
+    } else if (opposite == edges.end()) {
+      for (auto v : {a, b}) {
+        if (kinds[v] == VertexKind::Manifold) {
+          kinds[v] = VertexKind::Border;
+        }
+      }
+    }
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    if (wedge_count[remap[v]] > 1) {
+      kinds[v] = VertexKind::Locked;
+    }
+  }
+
+  // quadrics live on positions, so every wedge of a seam shares one
+  std::vector<Quadric> quadrics(vertex_count, Quadric{});
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    auto& a = position(indices[i]);
+    auto& b = position(indices[i + 1]);
+    auto& c = position(indices[i + 2]);
+    glm::dvec3 normal = triangle_normal(a, b, c);
+    double length = glm::length(normal);
+    if (length == 0.0) {
+      continue;
+    }
+    normal /= length;
+    auto quadric = Quadric::plane(normal, -glm::dot(normal, glm::dvec3{a}), length * 0.5);
+    for (size_t k = 0; k < 3; k++) {
+      quadrics[remap[indices[i + k]]].add(quadric);
+
+      // border edges get a plane perpendicular to the triangle, so borders keep their shape
+      auto v0 = remap[indices[i + k]];
+      auto v1 = remap[indices[i + (k + 1) % 3]];
+      if (is_border_edge(v0, v1)) {
+        glm::dvec3 edge = position(v1) - position(v0);
+        double edge_length = glm::length(edge);
+        if (edge_length > 0.0) {
+          auto border_normal = glm::normalize(glm::cross(edge, normal));
+          auto border = Quadric::plane(border_normal,
+                                       -glm::dot(border_normal, glm::dvec3{position(v0)}),
+                                       edge_length * edge_length);
+          quadrics[v0].add(border);
+          quadrics[v1].add(border);
+        }
+      }
+    }
+  }
+
+  double max_cost = static_cast<double>(max_error) * max_error;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+  std::vector<Collapse> collapses;
+  std::vector<uint8_t> locked(vertex_count);
+  std::vector<unsigned int> collapse_to(vertex_count);
+
+  while (result.size() > target_index_count) {
+    size_t triangle_count = result.size() / 3;
+
+    // vertex -> triangle adjacency of the current index list
+    offsets.assign(vertex_count + 1, 0);
+    for (auto v : result) {
+      offsets[v + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    triangles.resize(result.size());
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < result.size(); i++) {
+        triangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+      }
+    }
+
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (size_t k = 0; k < 3; k++) {
+        unsigned int from = result[i + k];
+        unsigned int to = result[i + (k + 1) % 3];
+        for (auto [v, t] : {std::pair{from, to}, std::pair{to, from}}) {
+          if (kinds[v] == VertexKind::Locked) {
+            continue;
+          }
+          if (kinds[v] == VertexKind::Border &&
+              (kinds[t] == VertexKind::Manifold || !is_border_edge(remap[v], remap[t]))) {
+            continue;
+          }
+          Quadric quadric = quadrics[remap[v]];
+          quadric.add(quadrics[remap[t]]);
+          collapses.push_back(Collapse{v, t, quadric.error(position(t))});
+        }
+      }
+    }
+    std::ranges::sort(collapses, {}, &Collapse::cost);
+
+    std::ranges::fill(locked, 0);
+    std::iota(collapse_to.begin(), collapse_to.end(), 0);
+    size_t removed{};
+    size_t target_triangles = target_index_count / 3;
+    for (auto& collapse : collapses) {
+      if (collapse.cost > max_cost || triangle_count - removed <= target_triangles) {
+        break;
+      }
+      auto v = collapse.from;
+      auto t = collapse.to;
+      if (locked[v] || locked[t] || locked[remap[t]]) {
+        continue;
+      }
+
+      // reject collapses that flip or squash a triangle staying around v
+      bool flips = false;
+      for (auto k = offsets[v]; k < offsets[v + 1] && !flips; k++) {
+        auto tri = std::span{result}.subspan(triangles[k] * 3, 3);
+        if (remap[tri[0]] == remap[t] || remap[tri[1]] == remap[t] || remap[tri[2]] == remap[t]) {
+          continue;
+        }
+        auto moved = [&](unsigned int corner) -> const glm::vec3& {
+          return corner == v ? position(t) : position(corner);
+        };
+        auto before = triangle_normal(position(tri[0]), position(tri[1]), position(tri[2]));
+        auto after = triangle_normal(moved(tri[0]), moved(tri[1]), moved(tri[2]));
+        flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+      }
+      if (flips) {
+        continue;
+      }
+
+      collapse_to[v] = t;
+      quadrics[remap[t]].add(quadrics[remap[v]]);
+      result_error = std::max(result_error, collapse.cost);
+      // the one ring of v changes shape, leave it alone until the next pass
+      for (auto k = offsets[v]; k < offsets[v + 1]; k++) {
+        for (size_t j = 0; j < 3; j++) {
+          auto corner = result[triangles[k] * 3 + j];
+          locked[corner] = 1;
+          locked[remap[corner]] = 1;
+        }
+      }
+      removed += kinds[v] == VertexKind::Border ? 1 : 2;
+    }
+    if (removed == 0) {
+      break;
+    }
+
+    size_t write{};
+    for (size_t i = 0; i < result.size(); i += 3) {
+      auto a = collapse_to[result[i]];
+      auto b = collapse_to[result[i + 1]];
+      auto c = collapse_to[result[i + 2]];
+      if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+        continue;
+      }
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  return finish();
+}
+
+void generate_lods(MeshData& mesh, const LodArgs& args) {
+  PROFILE_ZONE("generate_lods");
+  auto index_count = static_cast<uint32_t>(mesh.indices.size());
+  mesh.lods = {MeshLod{0, index_count, 0.0f}};
+  if (index_count == 0 || index_count % 3 != 0) {
+    return;
+  }
+
+  auto bounds = compute_bounds(mesh.vertices);
+  float max_error = args.max_error * glm::length(bounds.aabb.max - bounds.aabb.min);
+
+  std::vector<unsigned int> previous(mesh.indices);
+  float error{};
+  for (uint32_t level = 1; level < args.max_lods; level++) {
+    auto target = static_cast<size_t>(static_cast<float>(previous.size()) * args.reduction) / 3 * 3;
+    float level_error{};
+    auto lod = simplify(mesh.vertices, previous, target, max_error, &level_error);
+    if (lod.empty() ||
+        static_cast<float>(lod.size()) > static_cast<float>(previous.size()) * args.min_reduction) {
+      break;
+    }
+
+    optimize_vertex_cache(lod, mesh.vertices.size());
+    // every level simplifies the previous one, so errors add up
+    error += level_error;
+    mesh.lods.push_back(MeshLod{
+      static_cast<uint32_t>(mesh.indices.size()),
+      static_cast<uint32_t>(lod.size()),
+      error,
+    });
+    mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+    previous = std::move(lod);
+  }
+}
+
+void generate_lods(std::span<MeshData> meshes, const LodArgs& args) {
+  ThreadPool::shared().parallel_for(meshes.size(), [&](size_t i) {
+    generate_lods(meshes[i], args);
+  });
+}
@@ -1,47 +1,593 @@
 #include "Model.hpp"
 
 #include <spdlog/spdlog.h>
+#include <assimp/DefaultIOSystem.h>
 
-Model::Model(std::string_view path, bool gamma) : gamma_correction(gamma) {
-  load_model(path);
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <unordered_set>
+
+#include "BlockCompression.hpp"
+#include "MeshCache.hpp"
+#include "Profiler.hpp"
+#include "ShaderVariants.hpp"
+#include "TextureContainer.hpp"
+#include "TextureRegistry.hpp"
+#include "utils/Hash.hpp"
+#include "utils/MappedFile.hpp"
+#include "utils/ThreadPool.hpp"
+
+namespace {
+// remembers every file assimp opens for the model, the mesh cache is keyed on all of them
+class SourceRecorder : public Assimp::DefaultIOSystem {
+public:
+  explicit SourceRecorder(std::vector<std::string>& files) : files_(files) {}
+
+  Assimp::IOStream* Open(const char* file, const char* mode = "rb") override {
+    auto* stream = DefaultIOSystem::Open(file, mode);
+    if (stream) {
+      auto path = std::filesystem::path{file}.lexically_normal().string();
+      if (std::ranges::find(files_, path) == files_.end()) {
+        files_.push_back(std::move(path));
+      }
+    }
+    return stream;
+  }
+
+private:
+  std::vector<std::string>& files_;
+};
+
+// the load settings that change what gets uploaded for a file
+uint64_t texture_variant(TextureType type, const ModelArgs& args) {
+  uint64_t variant = static_cast<uint64_t>(type);
+  variant = hash_combine(variant, args.gamma_correction);
+  variant = hash_combine(variant, args.stream_textures);
+  variant = hash_combine(variant, args.compress_textures);
+  return variant;
+}
+} // namespace
+
+Model::Model(std::string_view path, bool gamma)
+  : Model(ModelArgs{.load_path = std::string{path}, .gamma_correction = gamma}) {}
+
+Model::Model(ModelArgs args) : Model(args, Deferred{}) {
+  load_model(args);
+}
+
+Model::Model(const ModelArgs& args, Deferred)
+  : vertex_format_(args.vertex_format),
+    stream_textures_(args.stream_textures),
+    directory_(directory(args.load_path)),
+    gamma_correction(args.gamma_correction) {}
+
+void Model::draw(const Shader& shader, const glm::mat4& transform) {
+  auto model_uniform = shader.uniform<glm::mat4>("model");
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    model_uniform.set(transform * scene_.world(mesh_nodes_[i]));
+    meshes_[i].draw(shader, mesh_lods_[i]);
+  }
+}
+
+void Model::draw(const Shader& shader, const Frustum& frustum, const glm::mat4& transform) {
+  auto model_uniform = shader.uniform<glm::mat4>("model");
+  for (auto index : cull(frustum, transform)) {
+    model_uniform.set(transform * scene_.world(mesh_nodes_[index]));
+    meshes_[index].draw(shader, mesh_lods_[index]);
+  }
+}
+
+void Model::draw_instanced(const Shader& shader, std::span<const glm::mat4> transforms) {
+  if (transforms.empty()) {
+    return;
+  }
+
+  auto upload = [&](std::span<const glm::mat4> instances) {
+    if (!instance_buffer_) {
+      auto layout = std::make_shared<glad::VertexBufferLayout>(
+        std::vector<glad::VertexAttribute>{
+          {INSTANCE_MODEL_LOCATION, "InstanceModel", glad::ArrtibuteType::Mat4}
+        });
+      instance_buffer_ =
+        std::make_shared<glad::VertexBuffer<glm::mat4>>(instances, layout, GL_DYNAMIC_DRAW);
+    } else {
+      instance_buffer_->update(instances);
+    }
+  };
+
+  // instances are transform * node world, uploaded again only when the node changes
+  uint32_t uploaded_node = SceneGraph::NO_PARENT;
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto& mesh = meshes_[i];
+    auto node = mesh_nodes_[i];
+    if (node != uploaded_node) {
+      auto& world = scene_.world(node);
+      if (world == glm::mat4{1.0f}) {
+        upload(transforms);
+      } else {
+        instance_transforms_.resize(transforms.size());
+        std::ranges::transform(transforms, instance_transforms_.begin(),
+                               [&](const glm::mat4& transform) { return transform * world; });
+        upload(instance_transforms_);
+      }
+      uploaded_node = node;
+    }
+
+    auto& vao = instanced_vaos_[mesh.geometry_page()];
+    if (!vao) {
+      vao = geometry_pool_->make_vertex_array(mesh.geometry_page());
+      vao->bind();
+      vao->add_instance_vbo(instance_buffer_);
+      vao->unbind();
+    }
+    mesh.draw_instanced(shader, *vao, static_cast<GLsizei>(transforms.size()), mesh_lods_[i]);
+  }
+}
+
+void Model::enqueue(RenderQueue& queue, Shader& shader, const glm::mat4& transform, float depth,
+                    RenderLayer layer) const {
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto packet = meshes_[i].packet(shader, mesh_lods_[i]);
+    packet.transform = transform * scene_.world(mesh_nodes_[i]);
+    packet.depth = depth;
+    packet.layer = layer;
+    queue.push(packet);
+  }
 }
 
-void Model::draw(const Shader& shader) {
+void Model::enqueue(RenderQueue& queue, Shader& shader, const glm::mat4& transform, float depth,
+                    const Frustum& frustum, RenderLayer layer) const {
+  for (auto index : cull(frustum, transform)) {
+    auto packet = meshes_[index].packet(shader, mesh_lods_[index]);
+    packet.transform = transform * scene_.world(mesh_nodes_[index]);
+    packet.depth = depth;
+    packet.layer = layer;
+    queue.push(packet);
+  }
+}
+
+auto Model::cull(const Frustum& frustum, const glm::mat4& transform) const
+  -> std::span<const uint32_t> {
+  culler_.cull(frustum.to_local(transform), visible_);
+  return visible_;
+}
+
+void Model::select_lods(const LodSettings& settings, const glm::vec3& camera_position,
+                        const glm::mat4& transform) {
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto world = transform * scene_.world(mesh_nodes_[i]);
+    auto sphere = meshes_[i].bounds().sphere.transformed(world);
+    // distance to the closest point of the bounds, errors are in object space
+    float distance = glm::length(sphere.center - camera_position) - sphere.radius;
+    float error_scale = meshes_[i].bounds().sphere.radius > 0.0f
+                          ? sphere.radius / meshes_[i].bounds().sphere.radius
+                          : 1.0f;
+    mesh_lods_[i] = select_lod(meshes_[i].lods(), mesh_lods_[i], distance, error_scale, settings);
+  }
+}
+
+size_t Model::triangle_count() const {
+  size_t triangles{};
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto& lods = meshes_[i].lods();
+    triangles += lods[std::min<size_t>(mesh_lods_[i], lods.size() - 1)].index_count / 3;
+  }
+  return triangles;
+}
+
+ShaderDefines Model::texture_defines() const {
+  ShaderDefines defines{};
   for (auto& mesh : meshes_) {
-    mesh.draw(shader);
+    for (auto& [name, value] : ::texture_defines(mesh.textures)) {
+      defines.set(name, value);
+    }
+  }
+  return defines;
+}
+
+void Model::request_texture_sizes(const LodSettings& settings, const glm::vec3& camera_position,
+                                  const glm::mat4& transform) const {
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto sphere = meshes_[i].bounds().sphere.transformed(transform * scene_.world(mesh_nodes_[i]));
+    float distance = std::max(glm::length(sphere.center - camera_position) - sphere.radius, 0.0f);
+    float pixels = projected_error(2.0f * sphere.radius, distance, settings);
+    for (auto& texture : meshes_[i].textures) {
+      texture.texture->request_size(pixels);
+    }
+  }
+}
+
+void Model::update_scene() {
+  if (scene_.update() == 0) {
+    return;
+  }
+
+  bounds_ = Aabb{};
+  for (size_t i = 0; i < meshes_.size(); i++) {
+    auto& world = scene_.world(mesh_nodes_[i]);
+    if (scene_.changed(mesh_nodes_[i])) {
+      culler_.set(static_cast<uint32_t>(i), meshes_[i].bounds().sphere.transformed(world));
+    }
+    bounds_.expand(meshes_[i].bounds().aabb.transformed(world));
   }
 }
 
-void Model::load_model(std::string_view path) {
+auto Model::import_model(std::string_view path) -> std::optional<ModelData> {
+  PROFILE_ZONE("Model::import_model");
+  ModelData model{};
   Assimp::Importer importer;
+  // owned by the importer
+  importer.SetIOHandler(new SourceRecorder{model.source_files});
   const aiScene* scene = importer.ReadFile(path.data(), aiProcess_Triangulate | aiProcess_FlipUVs);
 
   if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
     spdlog::error("ERROR::ASSIMP::{}", importer.GetErrorString());
+    return std::nullopt;
+  }
+
+  model.meshes.reserve(scene->mNumMeshes);
+  process_node(scene->mRootNode, scene, SceneGraph::NO_PARENT, model);
+  return model;
+}
+
+void Model::load_model(const ModelArgs& args) {
+  auto source = prepare(args);
+  if (!source) {
     return;
   }
+  begin_upload(*source);
+  while (upload_next(*source)) {
+  }
+  finish_upload(*source);
+}
+
+auto Model::prepare(const ModelArgs& args) -> std::optional<Source> {
+  PROFILE_ZONE("Model::prepare");
+  std::string_view path = args.load_path;
+  bool use_cache = args.use_mesh_cache;
+  Source source{};
+
+  auto cache_path = MeshCache::cache_path(path);
+  // imports with different options must not share a cache
+  uint64_t options_hash = hash_combine(args.optimize_meshes, args.generate_lods);
+  if (use_cache) {
+    try {
+      source.cache = MeshCache::open(cache_path, options_hash);
+    } catch (const std::exception& e) {
+      spdlog::warn("Failed to read mesh cache {}: {}", cache_path, e.what());
+      use_cache = false;
+    }
+  }
+
+  if (source.cache) {
+    source.meshes.reserve(source.cache->mesh_count());
+    for (size_t i = 0; i < source.cache->mesh_count(); i++) {
+      source.meshes.push_back(source.cache->mesh(i));
+    }
+    source.nodes = source.cache->nodes();
+  } else {
+    source.data = import_model(path);
+    if (!source.data) {
+      return std::nullopt;
+    }
+    auto& model = *source.data;
+    if (args.optimize_meshes) {
+      auto start = std::chrono::steady_clock::now();
+      optimize_meshes(model.meshes);
+      auto end = std::chrono::steady_clock::now();
+      spdlog::info("Optimized {} meshes in {:.2f} ms", model.meshes.size(),
+                   std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    if (args.generate_lods) {
+      auto start = std::chrono::steady_clock::now();
+      generate_lods(model.meshes);
+      auto end = std::chrono::steady_clock::now();
+      spdlog::info("Generated lods of {} meshes in {:.2f} ms", model.meshes.size(),
+                   std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    if (use_cache) {
+      try {
+        MeshCache::write(cache_path, options_hash, model);
+      } catch (const std::exception& e) {
+        spdlog::warn("Failed to write mesh cache {}: {}", cache_path, e.what());
+      }
+    }
+
+    source.meshes.reserve(model.meshes.size());
+    for (auto& mesh : model.meshes) {
+      source.meshes.push_back(
+        MeshView{mesh.vertices, mesh.indices, mesh.textures, mesh.node, mesh.lods});
+    }
+    source.nodes = model.nodes;
+  }
+
+  prepare_meshes(source, args);
+  prepare_textures(source, directory(path), args);
+  return source;
+}
 
-  directory = path.substr(0, path.find_last_of('/'));
+void Model::prepare_meshes(Source& source, const ModelArgs& args) {
+  if (!args.allow_32bit_indices) {
+    std::vector<MeshView> meshes;
+    meshes.reserve(source.meshes.size());
+    for (auto& mesh : source.meshes) {
+      if (mesh.vertices.size() <= MAX_16BIT_VERTICES) {
+        meshes.push_back(mesh);
+        continue;
+      }
+      for (auto& part : split_mesh(mesh, MAX_16BIT_VERTICES)) {
+        auto& stored = source.parts.emplace_back(std::move(part));
+        meshes.push_back(MeshView{stored.vertices, stored.indices, stored.textures, stored.node});
+      }
+    }
+    source.meshes = std::move(meshes);
+  }
 
-  process_node(scene->mRootNode, scene);
+  source.bounds.resize(source.meshes.size());
+  source.packed.resize(source.meshes.size());
+  for (size_t i = 0; i < source.meshes.size(); i++) {
+    source.bounds[i] = compute_bounds(source.meshes[i].vertices);
+    if (args.vertex_format == VertexFormat::Packed) {
+      source.packed[i] = pack_vertices(source.meshes[i].vertices);
+    }
+  }
 }
 
-void Model::process_node(aiNode* node, const aiScene* scene) {
+void Model::prepare_textures(Source& source, std::string_view directory, const ModelArgs& args) {
+  auto& registry = TextureRegistry::instance();
+
+  // gather every unique texture across all meshes first, textures already
+  // uploaded by another model are picked up from the registry
+  std::unordered_set<std::string> seen;
+  for (auto& mesh : source.meshes) {
+    for (auto& ref : mesh.textures) {
+      if (!seen.insert(ref.path).second) {
+        continue;
+      }
+      auto load_path = std::format("{}/{}", directory, ref.path);
+      auto canonical_path = TextureRegistry::canonical_path(load_path);
+      auto variant = texture_variant(ref.type, args);
+      auto texture = registry.find(canonical_path, variant);
+      source.textures.push_back(PendingTexture{
+        .ref = ref,
+        .load_path = std::move(load_path),
+        .canonical_path = std::move(canonical_path),
+        .variant = variant,
+        .texture = std::move(texture),
+      });
+    }
+  }
+
+  auto hash = [&](size_t i) {
+    auto& texture = source.textures[i];
+    if (texture.texture) {
+      return;
+    }
+    MappedFile file{std::filesystem::path{texture.load_path}};
+    texture.content_hash = hash_bytes(file.bytes());
+    texture.texture = registry.find_by_hash(texture.content_hash, texture.variant);
+  };
+
+  auto decode = [&](size_t i) {
+    auto& texture = source.textures[i];
+    if (texture.texture || texture.duplicate_of) {
+      return;
+    }
+    MappedFile file{std::filesystem::path{texture.load_path}};
+
+    if (is_compressed_container(texture.load_path)) {
+      texture.compressed = read_compressed_texture(file.bytes(), texture.load_path);
+    } else if (args.compress_textures) {
+      // transcoded once, later loads read the cached dds while the source is unchanged
+      auto cache_path = bcn_cache_path(texture.load_path);
+      try {
+        if (std::filesystem::exists(cache_path)) {
+          MappedFile cache{std::filesystem::path{cache_path}};
+          if (dds_source_hash(cache.bytes()) == texture.content_hash) {
+            texture.compressed = read_compressed_texture(cache.bytes(), cache_path);
+            return;
+          }
+        }
+      } catch (const std::exception& e) {
+        spdlog::warn("Failed to read texture cache {}: {}", cache_path, e.what());
+      }
+
+      auto image = Texture::decode(file.bytes(), texture.load_path);
+      auto format = block_format(texture.ref.type, image.nr_channels);
+      texture.compressed = compress(Texture::build_mips(std::move(image)), format);
+      try {
+        write_dds(cache_path, *texture.compressed, texture.content_hash);
+      } catch (const std::exception& e) {
+        spdlog::warn("Failed to write texture cache {}: {}", cache_path, e.what());
+      }
+    } else {
+      texture.image = Texture::decode(file.bytes(), texture.load_path);
+      if (args.stream_textures) {
+        texture.mips = Texture::build_mips(std::move(texture.image));
+      }
+    }
+  };
+
+  bool parallel_decode = args.parallel_texture_decode;
+  auto& pool = ThreadPool::shared();
+  auto start = std::chrono::steady_clock::now();
+  auto run = [&](auto&& func) {
+    if (parallel_decode) {
+      pool.parallel_for(source.textures.size(), func);
+    } else {
+      for (size_t i = 0; i < source.textures.size(); i++) {
+        func(i);
+      }
+    }
+  };
+
+  run(hash);
+  // different files with the same bytes and load settings are decoded and uploaded once
+  std::map<std::pair<uint64_t, uint64_t>, size_t> first_by_hash{};
+  for (size_t i = 0; i < source.textures.size(); i++) {
+    auto& texture = source.textures[i];
+    if (texture.texture) {
+      continue;
+    }
+    auto [it, inserted] =
+      first_by_hash.try_emplace(std::pair{texture.content_hash, texture.variant}, i);
+    if (!inserted) {
+      texture.duplicate_of = it->second;
+    }
+  }
+  run(decode);
+  auto end = std::chrono::steady_clock::now();
+
+  size_t decoded = std::ranges::count_if(
+    source.textures, [](auto& t) { return !t.texture && !t.duplicate_of; });
+  if (decoded > 0) {
+    spdlog::info("Decoded {} textures from {} in {:.2f} ms ({} threads)", decoded, directory,
+                 std::chrono::duration<double, std::milli>(end - start).count(),
+                 parallel_decode ? std::min(decoded, pool.thread_count() + 1) : 1);
+  }
+}
+
+std::string_view Model::directory(std::string_view path) {
+  return path.substr(0, path.find_last_of('/'));
+}
+
+void Model::begin_upload(const Source& source) {
+  scene_.reserve(source.nodes.size());
+  for (auto& node : source.nodes) {
+    scene_.add_node(node.local, node.parent);
+  }
+  scene_.update();
+
+  geometry_pool_ = Mesh::geometry_pool(vertex_format_);
+  meshes_.reserve(source.meshes.size());
+}
+
+bool Model::upload_next(Source& source) {
+  PROFILE_ZONE("Model::upload_next");
+  // textures first, meshes look their handles up by path
+  if (source.next_texture < source.textures.size()) {
+    auto& texture = source.textures[source.next_texture++];
+    if (texture.duplicate_of) {
+      // uploaded earlier in this batch
+      textures_loaded_[texture.ref.path] =
+        textures_loaded_.at(source.textures[*texture.duplicate_of].ref.path);
+      return true;
+    }
+    if (!texture.texture) {
+      auto args = texture_args(texture.ref);
+      std::unique_ptr<Texture> uploaded;
+      if (texture.compressed) {
+        uploaded = std::make_unique<Texture>(std::move(args), std::move(*texture.compressed));
+      } else if (args.streaming) {
+        uploaded = std::make_unique<Texture>(std::move(args), std::move(texture.mips));
+      } else {
+        uploaded = std::make_unique<Texture>(std::move(args), std::move(texture.image));
+      }
+      texture.texture = TextureRegistry::instance().insert(
+        texture.canonical_path, texture.content_hash, texture.variant, std::move(uploaded));
+      source.uploaded_textures++;
+    }
+    textures_loaded_[texture.ref.path] = std::move(texture.texture);
+    return true;
+  }
+
+  if (source.next_mesh < source.meshes.size()) {
+    auto i = source.next_mesh++;
+    add_mesh(source.meshes[i], source.bounds[i], source.packed[i]);
+    return true;
+  }
+  return false;
+}
+
+void Model::finish_upload(const Source& source) {
+  auto stats = geometry_pool_->stats();
+  spdlog::info("Geometry pool: {} pages, vertices {}/{}, index bytes {}/{}, {} free blocks, "
+               "fragmentation {:.2f}/{:.2f}",
+               stats.page_count, stats.vertex_used, stats.vertex_capacity, stats.index_used,
+               stats.index_capacity, stats.free_blocks, stats.vertex_fragmentation,
+               stats.index_fragmentation);
+
+  auto texture_stats = TextureRegistry::instance().stats();
+  spdlog::info("Texture registry: {} textures ({} uploaded from {}), {:.2f} MB resident, "
+               "{} hits, {} misses",
+               texture_stats.texture_count, source.uploaded_textures, directory_,
+               texture_stats.resident_bytes / (1024.0 * 1024.0), texture_stats.hits,
+               texture_stats.misses);
+}
+
+void Model::add_mesh(const MeshView& mesh, const MeshBounds& bounds,
+                     std::span<const PackedVertex> packed) {
+  std::vector<MeshTexture> textures;
+  textures.reserve(mesh.textures.size());
+  for (auto& ref : mesh.textures) {
+    textures.push_back(MeshTexture{
+      .texture = textures_loaded_.at(ref.path),
+      .uniform_name = std::format("{}{}", uniform_name_prefix(ref.type), ref.slot),
+    });
+  }
+
+  auto index_format = glad::narrowest_index_format(mesh.vertices.size());
+  if (vertex_format_ == VertexFormat::Packed) {
+    meshes_.emplace_back(*geometry_pool_, std::as_bytes(packed), mesh.indices, index_format,
+                         bounds, mesh.lods, std::move(textures));
+  } else {
+    meshes_.emplace_back(*geometry_pool_, std::as_bytes(mesh.vertices), mesh.indices,
+                         index_format, bounds, mesh.lods, std::move(textures));
+  }
+  // culler indices follow meshes_
+  auto& world = scene_.world(mesh.node);
+  mesh_nodes_.push_back(mesh.node);
+  mesh_lods_.push_back(0);
+  culler_.add(bounds.sphere.transformed(world));
+  bounds_.expand(bounds.aabb.transformed(world));
+}
+
+auto Model::texture_args(const TextureRef& ref) const -> TextureArgs {
+  return TextureArgs{
+    .uniform_name = std::format("{}{}", uniform_name_prefix(ref.type), ref.slot),
+    .load_path = std::format("{}/{}", directory_, ref.path),
+    .cmp_path = ref.path,
+    .texture_type = ref.type,
+    .auto_format = true,
+    .streaming = stream_textures_,
+    .min_filter = GL_LINEAR_MIPMAP_LINEAR
+  };
+}
+
+void Model::process_node(aiNode* node, const aiScene* scene, uint32_t parent, ModelData& model) {
+  // assimp matrices are row major
+  auto& m = node->mTransformation;
+  auto index = static_cast<uint32_t>(model.nodes.size());
+  model.nodes.push_back(NodeData{
+    .parent = parent,
+    .local = glm::transpose(glm::mat4{
+      m.a1, m.a2, m.a3, m.a4,
+      m.b1, m.b2, m.b3, m.b4,
+      m.c1, m.c2, m.c3, m.c4,
+      m.d1, m.d2, m.d3, m.d4,
+    }),
+  });
+
   for (uint32_t i = 0; i < node->mNumMeshes; i++) {
     aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-    meshes_.push_back(process_mesh(mesh, scene));
+    auto& data = model.meshes.emplace_back(process_mesh(mesh, scene));
+    data.node = index;
   }
 
   for (uint32_t i = 0; i < node->mNumChildren; i++) {
-    process_node(node->mChildren[i], scene);
+    process_node(node->mChildren[i], scene, index, model);
   }
 }
 
-Mesh Model::process_mesh(aiMesh* mesh, const aiScene* scene) {
-  std::vector<Vertex> vertices;
+MeshData Model::process_mesh(aiMesh* mesh, const aiScene* scene) {
+  MeshData data;
+  auto& vertices = data.vertices;
   vertices.reserve(mesh->mNumVertices);
-  std::vector<unsigned int> indices;
-  std::vector<std::shared_ptr<Texture>> textures;
+  auto& indices = data.indices;
 
   for (uint32_t i = 0; i < mesh->mNumVertices; i++) {
     Vertex vertex{};
@@ -86,63 +632,37 @@ Mesh Model::process_mesh(aiMesh* mesh, const aiScene* scene) {
   // material
   aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-  auto diffuse_maps = load_material_textures(material, aiTextureType_DIFFUSE);
-  textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
-  auto specular_maps = load_material_textures(material, aiTextureType_SPECULAR);
-  textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
-  auto normal_maps = load_material_textures(material, aiTextureType_NORMALS);
-  textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
-  auto height_maps = load_material_textures(material, aiTextureType_HEIGHT);
-  textures.insert(textures.end(), height_maps.begin(), height_maps.end());
+  load_material_textures(material, aiTextureType_DIFFUSE, data.textures);
+  load_material_textures(material, aiTextureType_SPECULAR, data.textures);
+  load_material_textures(material, aiTextureType_NORMALS, data.textures);
+  load_material_textures(material, aiTextureType_HEIGHT, data.textures);
 
-  return Mesh{vertices, indices, textures};
+  return data;
 }
 
-auto Model::load_material_textures(aiMaterial* mat, aiTextureType type) -> std::vector<std::shared_ptr<Texture>> {
-  std::vector<std::shared_ptr<Texture>> textures;
+void Model::load_material_textures(aiMaterial* mat, aiTextureType type,
+                                   std::vector<TextureRef>& textures) {
   auto texture_count = mat->GetTextureCount(type);
-  textures.reserve(texture_count);
   for (uint32_t i = 0; i < texture_count; i++) {
     aiString str;
     mat->GetTexture(type, i, &str);
-
-    bool skip = false;
-    for (uint32_t j = 0; j < textures_loaded_.size(); j++) {
-      if (textures_loaded_[j]->cmp_path() == str.C_Str()) {
-        textures.push_back(textures_loaded_[j]);
-        skip = true;
-        break;
-      }
-    }
-
-    if (!skip) {
-      auto texture = std::make_shared<Texture>(
-        TextureArgs{
-          .uniform_name = std::format("{}{}", uniform_name_prefix(type), i + 1),
-          .load_path = std::format("{}/{}", directory, str.C_Str()),
-          .cmp_path = str.C_Str(),
-          .texture_type = texture_type(type),
-          .auto_format = true,
-          .min_filter = GL_LINEAR_MIPMAP_LINEAR
-        }
-      );
-      textures.push_back(texture);
-      textures_loaded_.push_back(texture);
-    }
+    textures.push_back(TextureRef{
+      .type = texture_type(type),
+      .slot = i + 1,
+      .path = str.C_Str(),
+    });
   }
-
-  return textures;
 }
 
-std::string_view Model::uniform_name_prefix(aiTextureType type) {
+std::string_view Model::uniform_name_prefix(TextureType type) {
   switch (type) {
-    case aiTextureType_DIFFUSE:
+    case TextureType::Diffuse:
       return "texture_diffuse";
-    case aiTextureType_SPECULAR:
+    case TextureType::Specular:
       return "texture_specular";
-    case aiTextureType_NORMALS:
+    case TextureType::Normal:
       return "texture_normal";
-    case aiTextureType_HEIGHT:
+    case TextureType::Height:
       return "texture_height";
     default:
       std::unreachable();
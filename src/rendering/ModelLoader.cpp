@@ -0,0 +1,127 @@
+#include "ModelLoader.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+#include "Profiler.hpp"
+#include "utils/ThreadPool.hpp"
+
+auto ModelLoader::load(ModelArgs args) -> std::shared_ptr<AsyncModel> {
+  auto handle = std::make_shared<AsyncModel>();
+  handle->path_ = args.load_path;
+  auto future = ThreadPool::shared().submit([args] { return Model::prepare(args); });
+  loads_.push_back(Load{
+    .handle = handle,
+    .args = std::move(args),
+    .future = std::move(future),
+    .start = std::chrono::steady_clock::now(),
+  });
+  return handle;
+}
+
+void ModelLoader::update(std::chrono::microseconds budget) {
+  PROFILE_ZONE("ModelLoader::update");
+  auto deadline = std::chrono::steady_clock::now() + budget;
+  bool uploaded{};
+  for (size_t i = 0; i < loads_.size();) {
+    auto& load = loads_[i];
+    bool keep = poll(load);
+    if (keep && load.source && (!uploaded || std::chrono::steady_clock::now() < deadline)) {
+      keep = upload(load, deadline);
+      uploaded = true;
+    }
+
+    if (keep) {
+      i++;
+    } else {
+      loads_.erase(loads_.begin() + static_cast<ptrdiff_t>(i));
+    }
+  }
+}
+
+ModelLoader::~ModelLoader() {
+  for (auto& load : loads_) {
+    drop(load);
+  }
+}
+
+void ModelLoader::drop(Load& load) {
+  if (!load.future.valid()) {
+    return;
+  }
+  try {
+    load.future.get();
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to load model {}: {}", load.handle->path_, e.what());
+  }
+}
+
+bool ModelLoader::poll(Load& load) {
+  auto& handle = *load.handle;
+  bool ready = !load.future.valid() ||
+               load.future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+  // nobody is waiting for the model anymore. the source holds registry textures, it
+  // has to come back from the workers and die here on the context thread
+  if (load.handle.use_count() == 1) {
+    if (!ready) {
+      return true;
+    }
+    drop(load);
+    return false;
+  }
+  if (handle.state_ != AsyncModel::State::Loading || !ready) {
+    return true;
+  }
+
+  try {
+    load.source = load.future.get();
+    if (!load.source) {
+      handle.state_ = AsyncModel::State::Failed;
+      return false;
+    }
+    handle.model_ = std::unique_ptr<Model>{new Model{load.args, Model::Deferred{}}};
+    handle.model_->begin_upload(*load.source);
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to load model {}: {}", handle.path_, e.what());
+    handle.model_.reset();
+    handle.state_ = AsyncModel::State::Failed;
+    return false;
+  }
+  handle.state_ = AsyncModel::State::Uploading;
+  return true;
+}
+
+bool ModelLoader::upload(Load& load, std::chrono::steady_clock::time_point deadline) {
+  auto& handle = *load.handle;
+  auto start = std::chrono::steady_clock::now();
+  bool more{};
+  try {
+    do {
+      more = handle.model_->upload_next(*load.source);
+    } while (more && std::chrono::steady_clock::now() < deadline);
+    if (!more) {
+      handle.model_->finish_upload(*load.source);
+    }
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to upload model {}: {}", handle.path_, e.what());
+    handle.model_.reset();
+    handle.state_ = AsyncModel::State::Failed;
+    return false;
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  load.upload_frames++;
+  load.max_slice = std::max(load.max_slice, end - start);
+  if (more) {
+    return true;
+  }
+
+  handle.state_ = AsyncModel::State::Ready;
+  load.source.reset();
+  spdlog::info("Loaded {} in {:.2f} ms, uploads spread over {} frames, longest slice {:.2f} ms",
+               handle.path_, std::chrono::duration<double, std::milli>(end - load.start).count(),
+               load.upload_frames,
+               std::chrono::duration<double, std::milli>(load.max_slice).count());
+  return false;
+}
@@ -0,0 +1,179 @@
+#include "ProgramCache.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include "utils/Hash.hpp"
+#include "utils/MappedFile.hpp"
+
+namespace {
+std::string_view gl_string(GLenum name) {
+  auto* value = reinterpret_cast<const char*>(glGetString(name));
+  return value ? std::string_view{value} : std::string_view{};
+}
+} // namespace
+
+ProgramCache& ProgramCache::instance() {
+  static ProgramCache cache{};
+  return cache;
+}
+
+void ProgramCache::set_directory(std::filesystem::path directory) {
+  directory_ = std::move(directory);
+}
+
+void ProgramCache::set_enabled(bool enabled) {
+  enabled_ = enabled;
+}
+
+bool ProgramCache::enabled() const {
+  return enabled_ && binary_formats_ != 0;
+}
+
+bool ProgramCache::supported() {
+  if (binary_formats_ < 0) {
+    // core in 4.1, ARB_get_program_binary before. the query fails and leaves 0 without it
+    GLint formats{};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binary_formats_ = formats;
+    if (formats == 0) {
+      spdlog::info("Program binaries are not supported by {}, shader cache disabled",
+                   gl_string(GL_RENDERER));
+    }
+  }
+  return enabled_ && binary_formats_ > 0;
+}
+
+uint64_t ProgramCache::key(std::string_view vertex_source, std::string_view fragment_source) {
+  if (driver_hash_ == 0) {
+    driver_hash_ = hash_string(gl_string(GL_VENDOR));
+    driver_hash_ = hash_string(gl_string(GL_RENDERER), driver_hash_);
+    driver_hash_ = hash_string(gl_string(GL_VERSION), driver_hash_);
+  }
+  // the stage hashes are combined so moving code between stages changes the key
+  return hash_combine(hash_combine(driver_hash_, hash_string(vertex_source)),
+                      hash_string(fragment_source));
+}
+
+GLuint ProgramCache::load(uint64_t key) {
+  if (!supported()) {
+    return 0;
+  }
+
+  auto path = file_path(key);
+  std::error_code ec;
+  if (!std::filesystem::exists(path, ec)) {
+    stats_.misses++;
+    return 0;
+  }
+
+  GLuint program{};
+  try {
+    MappedFile file{path};
+    auto bytes = file.bytes();
+    FileHeader header{};
+    if (bytes.size() >= sizeof(FileHeader)) {
+      std::memcpy(&header, bytes.data(), sizeof(FileHeader));
+    }
+    bool valid = bytes.size() >= sizeof(FileHeader) &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version == VERSION && header.key == key &&
+                 bytes.size() - sizeof(FileHeader) >= header.binary_length;
+
+    if (valid) {
+      program = glCreateProgram();
+      glProgramBinary(program, header.binary_format, bytes.data() + sizeof(FileHeader),
+                      static_cast<GLsizei>(header.binary_length));
+      GLint linked{};
+      glGetProgramiv(program, GL_LINK_STATUS, &linked);
+      if (!linked) {
+        glDeleteProgram(program);
+        program = 0;
+      }
+    }
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to read program binary {}: {}", path.string(), e.what());
+  }
+
+  if (program == 0) {
+    // stale or refused after a driver change, compile and store a fresh one
+    stats_.rejected++;
+    stats_.misses++;
+    std::filesystem::remove(path, ec);
+    return 0;
+  }
+  stats_.hits++;
+  return program;
+}
+
+void ProgramCache::prepare(GLuint program) {
+  if (supported()) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+}
+
+void ProgramCache::store(uint64_t key, GLuint program) {
+  if (!supported()) {
+    return;
+  }
+
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<std::byte> buf(sizeof(FileHeader) + static_cast<size_t>(length));
+  FileHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.key = key;
+  GLenum format{};
+  GLsizei written{};
+  glGetProgramBinary(program, length, &written, &format, buf.data() + sizeof(FileHeader));
+  if (written <= 0) {
+    return;
+  }
+  header.binary_format = format;
+  header.binary_length = static_cast<uint32_t>(written);
+  std::memcpy(buf.data(), &header, sizeof(FileHeader));
+
+  try {
+    std::filesystem::create_directories(directory_);
+    auto path = file_path(key);
+    // write to a temporary file first so a crash never leaves a truncated binary behind
+    auto tmp_path = std::filesystem::path{std::format("{}.tmp", path.string())};
+    {
+      std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+      if (!file.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file: {}", tmp_path.string()));
+      }
+      file.write(reinterpret_cast<const char*>(buf.data()),
+                 static_cast<std::streamsize>(sizeof(FileHeader) + header.binary_length));
+      if (!file) {
+        throw std::runtime_error(std::format("Failed to write file: {}", tmp_path.string()));
+      }
+    }
+    std::filesystem::rename(tmp_path, path);
+    stats_.stores++;
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to store program binary: {}", e.what());
+  }
+}
+
+void ProgramCache::clear() {
+  std::error_code ec;
+  for (auto& entry : std::filesystem::directory_iterator{directory_, ec}) {
+    if (entry.path().extension() == ".bin") {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+}
+
+std::filesystem::path ProgramCache::file_path(uint64_t key) const {
+  return directory_ / std::format("{:016x}.bin", key);
+}
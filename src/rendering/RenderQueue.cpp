@@ -0,0 +1,167 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <limits>
+
+#include "Profiler.hpp"
+#include "utils/Hash.hpp"
+
+namespace {
+constexpr int RADIX_BITS = 8;
+constexpr size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+constexpr int RADIX_PASSES = 64 / RADIX_BITS;
+
+uint64_t bits(uint64_t value, int count) {
+  return value & ((1ull << count) - 1);
+}
+
+// positive floats keep their order when compared as integers, the top bits
+// below the sign are a logarithmic quantisation of the depth
+uint64_t quantize_depth(float depth, int count) {
+  auto raw = std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+  return bits(raw >> (31 - count), count);
+}
+} // namespace
+
+void RenderQueue::push(const DrawPacket& packet) {
+  entries_.push_back(SortEntry{sort_key(packet), static_cast<uint32_t>(packets_.size())});
+  packets_.push_back(packet);
+}
+
+void RenderQueue::submit(bool execute) {
+  PROFILE_ZONE("RenderQueue::submit");
+  auto start = std::chrono::steady_clock::now();
+  sort();
+  auto end = std::chrono::steady_clock::now();
+
+  stats_ = Stats{};
+  stats_.packets = packets_.size();
+  stats_.sort_ms = std::chrono::duration<double, std::milli>(end - start).count();
+  this->execute(execute);
+
+  clear();
+}
+
+void RenderQueue::clear() {
+  packets_.clear();
+  entries_.clear();
+}
+
+uint64_t RenderQueue::sort_key(const DrawPacket& packet) {
+  uint64_t program = packet.program;
+  // Mesh::packet builds material with hash_combine, its top bits alone barely vary
+  uint64_t material = hash_finalize(packet.material) >> 48;
+  uint64_t vao = packet.vao;
+
+  if (packet.layer == RenderLayer::Transparent) {
+    uint64_t depth = bits(~quantize_depth(packet.depth, 24), 24);
+    return 1ull << 63 | depth << 39 | bits(program, 12) << 27 | bits(material, 16) << 11 |
+           bits(vao, 11);
+  }
+
+  uint64_t depth = quantize_depth(packet.depth, 19);
+  return bits(program, 12) << 51 | bits(material, 16) << 35 | bits(vao, 16) << 19 | depth;
+}
+
+// lsd radix sort, one byte per pass. passes where every key has the same digit are skipped,
+// which is common for the high bits when only a few programs are in use
+void RenderQueue::sort() {
+  size_t count = entries_.size();
+  if (count < 2) {
+    return;
+  }
+
+  std::array<std::array<uint32_t, RADIX_BUCKETS>, RADIX_PASSES> histograms{};
+  for (auto& entry : entries_) {
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+      histograms[pass][(entry.key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+    }
+  }
+
+  scratch_.resize(count);
+  for (int pass = 0; pass < RADIX_PASSES; pass++) {
+    auto& histogram = histograms[pass];
+    int shift = pass * RADIX_BITS;
+    if (histogram[(entries_[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) {
+      continue;
+    }
+
+    uint32_t offset{};
+    for (auto& bucket : histogram) {
+      auto bucket_count = bucket;
+      bucket = offset;
+      offset += bucket_count;
+    }
+
+    for (auto& entry : entries_) {
+      scratch_[histogram[(entry.key >> shift) & (RADIX_BUCKETS - 1)]++] = entry;
+    }
+    entries_.swap(scratch_);
+  }
+}
+
+void RenderQueue::execute(bool issue_gl_calls) {
+  constexpr auto NONE = std::numeric_limits<uint64_t>::max();
+
+  uint64_t program = NONE;
+  uint64_t material = NONE;
+  uint64_t vao = NONE;
+  size_t naive_binds{};
+  Uniform<glm::mat4> model_uniform{};
+
+  for (auto& entry : entries_) {
+    auto& packet = packets_[entry.index];
+    naive_binds += 2 + packet.textures.size();
+
+    if (packet.program != program) {
+      program = packet.program;
+      // sampler uniforms belong to the program, the material has to be set again
+      material = NONE;
+      stats_.program_binds++;
+      if (issue_gl_calls) {
+        packet.shader->use();
+        model_uniform = packet.shader->uniform<glm::mat4>("model");
+      }
+    }
+
+    if (packet.material != material) {
+      material = packet.material;
+      stats_.material_binds++;
+      stats_.texture_binds += packet.textures.size();
+      if (issue_gl_calls) {
+        glad::ContextState::current().next_draw();
+        for (auto& [texture, uniform_name] : packet.textures) {
+          packet.shader->set_sampler(uniform_name, texture->bind());
+        }
+      }
+    }
+
+    if (packet.vao != vao) {
+      vao = packet.vao;
+      stats_.vao_binds++;
+      if (issue_gl_calls) {
+        glad::ContextState::current().bind_vertex_array(packet.vao);
+      }
+    }
+
+    if (issue_gl_calls) {
+      model_uniform.set(packet.transform);
+      auto* indices = reinterpret_cast<void*>(packet.index_offset);
+      if (packet.instance_count > 1) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, packet.index_count, packet.index_type,
+                                          indices, packet.instance_count, packet.base_vertex);
+      } else {
+        glDrawElementsBaseVertex(GL_TRIANGLES, packet.index_count, packet.index_type, indices,
+                                 packet.base_vertex);
+      }
+      glad::call_stats().draw_calls++;
+    }
+    stats_.draw_calls++;
+  }
+
+  stats_.binds_avoided =
+    naive_binds - (stats_.program_binds + stats_.texture_binds + stats_.vao_binds);
+}
@@ -3,24 +3,100 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <spdlog/spdlog.h>
 
-#include <fstream>
 #include <format>
-#include <sstream>
+
+#include "ProgramCache.hpp"
+
+namespace {
+// the source string numbers in the driver's log refer to these files
+std::string source_files(const ShaderSource& source) {
+  std::string files{};
+  for (size_t i = 0; i < source.files.size(); i++) {
+    files += std::format("  {}: {}\n", i, source.files[i].string());
+  }
+  return files;
+}
+
+bool is_sampler(GLenum type) {
+  switch (type) {
+  case GL_SAMPLER_1D:
+  case GL_SAMPLER_2D:
+  case GL_SAMPLER_3D:
+  case GL_SAMPLER_CUBE:
+  case GL_SAMPLER_1D_SHADOW:
+  case GL_SAMPLER_2D_SHADOW:
+  case GL_SAMPLER_1D_ARRAY:
+  case GL_SAMPLER_2D_ARRAY:
+  case GL_SAMPLER_1D_ARRAY_SHADOW:
+  case GL_SAMPLER_2D_ARRAY_SHADOW:
+  case GL_SAMPLER_2D_MULTISAMPLE:
+  case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+  case GL_SAMPLER_CUBE_SHADOW:
+  case GL_SAMPLER_BUFFER:
+  case GL_SAMPLER_2D_RECT:
+  case GL_SAMPLER_2D_RECT_SHADOW:
+  case GL_INT_SAMPLER_1D:
+  case GL_INT_SAMPLER_2D:
+  case GL_INT_SAMPLER_3D:
+  case GL_INT_SAMPLER_CUBE:
+  case GL_INT_SAMPLER_1D_ARRAY:
+  case GL_INT_SAMPLER_2D_ARRAY:
+  case GL_INT_SAMPLER_2D_MULTISAMPLE:
+  case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+  case GL_INT_SAMPLER_BUFFER:
+  case GL_INT_SAMPLER_2D_RECT:
+  case GL_UNSIGNED_INT_SAMPLER_1D:
+  case GL_UNSIGNED_INT_SAMPLER_2D:
+  case GL_UNSIGNED_INT_SAMPLER_3D:
+  case GL_UNSIGNED_INT_SAMPLER_CUBE:
+  case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+  case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+  case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+  case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+  case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+  case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// samplers and bools are set with glUniform1i
+bool uniform_type_matches(GLenum declared, GLenum type) {
+  if (declared == type) {
+    return true;
+  }
+  return type == GL_INT && (declared == GL_BOOL || is_sampler(declared));
+}
+} // namespace
 
 Shader::~Shader() {
   clear();
 }
 
-Shader::Shader(std::string_view vertex_path, std::string_view fragment_path) {
-  std::string vertex_code{};
-  std::string fragment_code{};
+Shader::Shader(std::string_view vertex_path, std::string_view fragment_path,
+               const ShaderDefines& defines) {
+  ShaderSource vertex_source{};
+  ShaderSource fragment_source{};
   try {
-    vertex_code = read_file(vertex_path);
-    fragment_code = read_file(fragment_path);
+    vertex_source = preprocess_shader(vertex_path, defines);
+    fragment_source = preprocess_shader(fragment_path, defines);
   } catch (const std::exception& e) {
     spdlog::error("ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: {}", e.what());
     return;
   }
+  auto& vertex_code = vertex_source.code;
+  auto& fragment_code = fragment_source.code;
+
+  // the expanded sources, so includes and defines are part of the key
+  auto& cache = ProgramCache::instance();
+  auto key = cache.key(vertex_code, fragment_code);
+  ID = cache.load(key);
+  if (ID != 0) {
+    load_uniforms();
+    bind_uniform_blocks();
+    return;
+  }
 
   unsigned int vertex;
   unsigned int fragment;
@@ -28,14 +104,16 @@ Shader::Shader(std::string_view vertex_path, std::string_view fragment_path) {
   try {
     vertex = compile_shader(ShaderType::Vertex, vertex_code.data());
   } catch (std::exception& e) {
-    spdlog::error("ERROR::SHADER::VERTEX::COMPILATION_FAILED:\n{}", e.what());
+    spdlog::error("ERROR::SHADER::VERTEX::COMPILATION_FAILED:\n{}{}", e.what(),
+                  source_files(vertex_source));
     return;
   }
 
   try {
     fragment = compile_shader(ShaderType::Fragment, fragment_code.c_str());
   } catch (std::exception& e) {
-    spdlog::error("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED:\n{}", e.what());
+    spdlog::error("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED:\n{}{}", e.what(),
+                  source_files(fragment_source));
     return;
   }
 
@@ -48,23 +126,11 @@ Shader::Shader(std::string_view vertex_path, std::string_view fragment_path) {
 
   glDeleteShader(vertex);
   glDeleteShader(fragment);
-};
+  cache.store(key, ID);
 
-std::string Shader::read_file(std::string_view file_path) {
-  std::ifstream file{file_path.data()};
-  if (!file.is_open()) {
-    throw std::runtime_error(std::format("Failed to open file: {}", file_path));
-  }
-
-  std::stringstream buf{};
-  buf << file.rdbuf();
-
-  if (file.bad()) {
-    throw std::runtime_error("Error reading file contents");
-  }
-
-  return buf.str();
-}
+  load_uniforms();
+  bind_uniform_blocks();
+};
 
 int Shader::compile_shader(ShaderType shader_type, const char* shader_code) {
   GLenum type;
@@ -96,6 +162,7 @@ void Shader::link_shader(unsigned int& shader_id, unsigned int vertex, unsigned
   shader_id = glCreateProgram();
   glAttachShader(shader_id, vertex);
   glAttachShader(shader_id, fragment);
+  ProgramCache::instance().prepare(shader_id);
   glLinkProgram(shader_id);
 
   int success;
@@ -108,35 +175,146 @@ void Shader::link_shader(unsigned int& shader_id, unsigned int vertex, unsigned
 }
 
 void Shader::use() {
-  glUseProgram(ID);
+  glad::ContextState::current().use_program(ID);
+}
+
+void Shader::load_uniforms() {
+  GLint count{};
+  GLint max_length{};
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+  std::string name(static_cast<size_t>(max_length), '\0');
+  auto add_uniform = [this](const std::string& name, GLenum type) {
+    GLint location = glGetUniformLocation(ID, name.c_str());
+    // uniforms inside a uniform block have no location
+    if (location < 0) {
+      return;
+    }
+    uniform_slots_.emplace(name, static_cast<int>(uniforms_.size()));
+    uniforms_.push_back(UniformSlot{location, type, false, {}});
+  };
+
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length{};
+    GLint size{};
+    GLenum type{};
+    glGetActiveUniform(ID, static_cast<GLuint>(i), max_length, &length, &size, &type, name.data());
+    std::string uniform_name{name.data(), static_cast<size_t>(length)};
+
+    if (size == 1) {
+      add_uniform(uniform_name, type);
+      continue;
+    }
+
+    // arrays are reported as "name[0]", register every element and the bare name
+    auto base = uniform_name.substr(0, uniform_name.rfind("[0]"));
+    for (GLint element = 0; element < size; element++) {
+      add_uniform(std::format("{}[{}]", base, element), type);
+    }
+    if (auto it = uniform_slots_.find(std::format("{}[0]", base)); it != uniform_slots_.end()) {
+      uniform_slots_.emplace(base, it->second);
+    }
+  }
+}
+
+void Shader::bind_uniform_blocks() {
+  GLint count{};
+  GLint max_length{};
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+
+  std::string name(static_cast<size_t>(max_length), '\0');
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length{};
+    glGetActiveUniformBlockName(ID, static_cast<GLuint>(i), max_length, &length, name.data());
+    auto binding = glad::uniform_block_binding(std::string_view{name.data(), static_cast<size_t>(length)});
+    glUniformBlockBinding(ID, static_cast<GLuint>(i), binding);
+  }
+}
+
+int Shader::find_slot(std::string_view name) const {
+  auto it = uniform_slots_.find(name);
+  return it == uniform_slots_.end() ? -1 : it->second;
+}
+
+int Shader::find_slot(std::string_view name, GLenum type) const {
+  int slot = find_slot(name);
+  if (slot >= 0 && !uniform_type_matches(uniforms_[slot].type, type)) {
+    spdlog::error("Uniform {} of program {} is declared as type {:#x}, not {:#x}", name, ID,
+                  uniforms_[slot].type, type);
+    return -1;
+  }
+  return slot;
+}
+
+void Shader::set_skip_redundant_uniforms(bool skip) {
+  skip_redundant_uniforms_ = skip;
 }
 
 void Shader::set_bool(std::string_view name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.data()), static_cast<int>(value));
+  upload(find_slot(name), value);
 }
 
 void Shader::set_int(std::string_view name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.data()), value);
+  upload(find_slot(name), value);
+}
+
+void Shader::set_sampler(std::string_view name, int unit) const {
+  upload(find_slot(name), unit, true);
 }
 
 void Shader::set_float(std::string_view name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.data()), value);
+  upload(find_slot(name), value);
 }
 
 void Shader::set_vec3(std::string_view name, float x, float y, float z) const {
-  glUniform3f(glGetUniformLocation(ID, name.data()), x, y, z);
+  upload(find_slot(name), glm::vec3{x, y, z});
 }
 
 void Shader::set_vec3(std::string_view name, const glm::vec3& vec) const {
-  glUniform3fv(glGetUniformLocation(ID, name.data()), 1, glm::value_ptr(vec));
+  upload(find_slot(name), vec);
 }
 
 void Shader::set_mat4(std::string_view name, const glm::mat4& martix) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.data()), 1, GL_FALSE, glm::value_ptr(martix));
+  upload(find_slot(name), martix);
+}
+
+void Shader::upload_uniform(GLint location, bool value) {
+  glUniform1i(location, static_cast<int>(value));
+}
+
+void Shader::upload_uniform(GLint location, int value) {
+  glUniform1i(location, value);
+}
+
+void Shader::upload_uniform(GLint location, float value) {
+  glUniform1f(location, value);
+}
+
+void Shader::upload_uniform(GLint location, const glm::vec2& value) {
+  glUniform2fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::upload_uniform(GLint location, const glm::vec3& value) {
+  glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::upload_uniform(GLint location, const glm::vec4& value) {
+  glUniform4fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::upload_uniform(GLint location, const glm::mat3& value) {
+  glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::upload_uniform(GLint location, const glm::mat4& value) {
+  glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::clear() {
   if (!is_delete) {
+    glad::ContextState::current().forget_program(ID);
     glDeleteProgram(ID);
   }
 }
@@ -0,0 +1,181 @@
+#include "ShaderPreprocessor.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "utils/Hash.hpp"
+
+namespace {
+constexpr int MAX_INCLUDE_DEPTH = 32;
+
+struct Directive {
+  std::string_view name;
+  std::string_view argument;
+};
+
+// "  #  include "file"" -> {include, "file"}, lines that are no directive give an empty name
+Directive parse_directive(std::string_view line) {
+  auto skip_space = [](std::string_view str) {
+    auto begin = str.find_first_not_of(" \t");
+    return begin == std::string_view::npos ? std::string_view{} : str.substr(begin);
+  };
+
+  line = skip_space(line);
+  if (!line.starts_with('#')) {
+    return {};
+  }
+  line = skip_space(line.substr(1));
+  auto name_end = std::min(line.find_first_of(" \t"), line.size());
+  return Directive{line.substr(0, name_end), skip_space(line.substr(name_end))};
+}
+
+std::string read_file(const std::filesystem::path& path) {
+  std::ifstream file{path};
+  if (!file.is_open()) {
+    throw std::runtime_error(std::format("Failed to open file: {}", path.string()));
+  }
+
+  std::stringstream buf{};
+  buf << file.rdbuf();
+  if (file.bad()) {
+    throw std::runtime_error(std::format("Error reading file: {}", path.string()));
+  }
+  return buf.str();
+}
+
+class Preprocessor {
+public:
+  Preprocessor(const ShaderDefines& defines, ShaderSource& source)
+    : defines_(defines), source_(source) {}
+
+  void expand(const std::filesystem::path& path, int depth) {
+    if (depth > MAX_INCLUDE_DEPTH) {
+      throw std::runtime_error(std::format("Includes nested too deep at {}", path.string()));
+    }
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    if (!included_.insert((ec ? path : canonical).string()).second) {
+      return;
+    }
+
+    auto text = read_file(path);
+    auto file_index = source_.files.size();
+    source_.files.push_back(path);
+    // nothing may come before #version, the stage file starts at line 1 anyway
+    if (file_index != 0) {
+      line_directive(1, file_index);
+    }
+
+    size_t line_number = 0;
+    for (size_t begin = 0; begin < text.size();) {
+      auto end = std::min(text.find('\n', begin), text.size());
+      std::string_view line{text.data() + begin, end - begin};
+      begin = end + 1;
+      line_number++;
+
+      auto directive = parse_directive(line);
+      if (directive.name == "version") {
+        if (file_index != 0) {
+          throw std::runtime_error(std::format("#version in included file {}", path.string()));
+        }
+        append(line);
+        inject_defines();
+        line_directive(line_number + 1, file_index);
+      } else if (directive.name == "include") {
+        auto& argument = directive.argument;
+        auto close = argument.find('"', 1);
+        if (!argument.starts_with('"') || close == std::string_view::npos) {
+          throw std::runtime_error(
+            std::format("{}:{}: expected #include \"file\"", path.string(), line_number));
+        }
+        auto include = path.parent_path() / argument.substr(1, close - 1);
+        expand(include.lexically_normal(), depth + 1);
+        line_directive(line_number + 1, file_index);
+      } else {
+        append(line);
+      }
+    }
+
+    // no #version, the defines still have to come first
+    if (file_index == 0 && !defines_injected_) {
+      auto code = std::move(source_.code);
+      source_.code.clear();
+      inject_defines();
+      source_.code += code;
+    }
+  }
+
+private:
+  const ShaderDefines& defines_;
+  ShaderSource& source_;
+  std::unordered_set<std::string> included_{};
+  bool defines_injected_{false};
+
+  void append(std::string_view line) {
+    source_.code += line;
+    source_.code += '\n';
+  }
+
+  void line_directive(size_t line, size_t file_index) {
+    source_.code += std::format("#line {} {}\n", line, file_index);
+  }
+
+  void inject_defines() {
+    for (auto& [name, value] : defines_) {
+      source_.code += std::format("#define {} {}\n", name, value);
+    }
+    defines_injected_ = true;
+  }
+};
+} // namespace
+
+ShaderDefines::ShaderDefines(std::initializer_list<Define> defines) {
+  for (auto& [name, value] : defines) {
+    set(name, value);
+  }
+}
+
+ShaderDefines& ShaderDefines::set(std::string_view name, std::string_view value) {
+  auto it = std::ranges::lower_bound(defines_, name, {}, &Define::first);
+  if (it != defines_.end() && it->first == name) {
+    it->second = value;
+  } else {
+    defines_.emplace(it, std::string{name}, std::string{value});
+  }
+  rehash();
+  return *this;
+}
+
+ShaderDefines& ShaderDefines::set(std::string_view name, int value) {
+  return set(name, std::to_string(value));
+}
+
+void ShaderDefines::erase(std::string_view name) {
+  auto it = std::ranges::lower_bound(defines_, name, {}, &Define::first);
+  if (it != defines_.end() && it->first == name) {
+    defines_.erase(it);
+    rehash();
+  }
+}
+
+bool ShaderDefines::contains(std::string_view name) const {
+  auto it = std::ranges::lower_bound(defines_, name, {}, &Define::first);
+  return it != defines_.end() && it->first == name;
+}
+
+void ShaderDefines::rehash() {
+  hash_ = 0;
+  for (auto& [name, value] : defines_) {
+    hash_ = hash_combine(hash_, hash_string(value, hash_string(name)));
+  }
+}
+
+ShaderSource preprocess_shader(const std::filesystem::path& path, const ShaderDefines& defines) {
+  ShaderSource source{};
+  Preprocessor{defines, source}.expand(path, 0);
+  return source;
+}
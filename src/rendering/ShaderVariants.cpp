@@ -0,0 +1,39 @@
+#include "ShaderVariants.hpp"
+
+ShaderVariants::ShaderVariants(std::string vertex_path, std::string fragment_path)
+  : vertex_path_(std::move(vertex_path)), fragment_path_(std::move(fragment_path)) {}
+
+auto ShaderVariants::variant(const ShaderDefines& defines) -> Index {
+  if (auto it = variants_.find(defines); it != variants_.end()) {
+    return it->second;
+  }
+
+  auto index = static_cast<Index>(shaders_.size());
+  shaders_.push_back(std::make_unique<Shader>(vertex_path_, fragment_path_, defines));
+  variants_.emplace(defines, index);
+  return index;
+}
+
+ShaderDefines texture_defines(std::span<const MeshTexture> textures) {
+  ShaderDefines defines{};
+  for (auto& texture : textures) {
+    if (!texture.texture) {
+      continue;
+    }
+    switch (texture.texture->texture_type()) {
+      case TextureType::Diffuse:
+        defines.set("HAS_DIFFUSE_MAP");
+        break;
+      case TextureType::Specular:
+        defines.set("HAS_SPECULAR_MAP");
+        break;
+      case TextureType::Normal:
+        defines.set("HAS_NORMAL_MAP");
+        break;
+      case TextureType::Height:
+        defines.set("HAS_HEIGHT_MAP");
+        break;
+    }
+  }
+  return defines;
+}
@@ -1,63 +1,139 @@
 #include "Texture.hpp"
 
+#include "glad_wrapper.hpp"
+#include "TextureStreamer.hpp"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <cmath>
 #include <stdexcept>
 #include <format>
+#include <tuple>
+
+// s3tc and bptc are extensions to the 3.3 core profile, rgtc is core
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
 
-Texture::Texture(TextureArgs args)
-  : load_path_(std::move(args.load_path)), cmp_path_(std::move(args.cmp_path)) {
-  stbi_set_flip_vertically_on_load(true);
-  unsigned char* data = stbi_load(load_path_.c_str(), &width_, &height_, &nr_channels_, 0);
+void ImageDeleter::operator()(unsigned char* pixels) const {
+  stbi_image_free(pixels);
+}
 
-  if (data) {
-    glGenTextures(1, &texture_id_);
-    glBindTexture(GL_TEXTURE_2D, texture_id_);
+Texture::Texture(TextureArgs args) : Texture(args, decode(args.load_path)) {}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, args.min_filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, args.mag_filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, args.wrap_s);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, args.wrap_t);
+Texture::Texture(TextureArgs args, ImageData image)
+  : load_path_(std::move(args.load_path)), cmp_path_(std::move(args.cmp_path)),
+    width_(image.width), height_(image.height), nr_channels_(image.nr_channels) {
+  glGenTextures(1, &texture_id_);
+  auto& state = glad::ContextState::current();
+  state.next_draw();
+  state.edit_texture(texture_id_);
 
-    auto [internal_format, format] =
-      handle_format(args.auto_format, nr_channels_, args.internal_format, args.format);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, args.min_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, args.mag_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, args.wrap_s);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, args.wrap_t);
 
-    texture_type_ = args.texture_type;
+  auto [internal_format, format] =
+    handle_format(args.auto_format, nr_channels_, args.internal_format, args.format);
+  internal_format_ = internal_format;
+  format_ = format;
 
-    unit_index_ = init_unit_index();
-    uniform_name_ = args.uniform_name;
+  texture_type_ = args.texture_type;
 
-    glTexImage2D(GL_TEXTURE_2D, 0, internal_format,
-                 width_, height_, 0, format, GL_UNSIGNED_BYTE, data);
+  uniform_name_ = args.uniform_name;
 
-    if (args.generate_mipmap) {
-      glGenerateMipmap(GL_TEXTURE_2D);
-    }
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format,
+               width_, height_, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+
+  if (args.generate_mipmap) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+    has_mipmap_ = true;
+  }
+}
+
+Texture::Texture(TextureArgs args, MipChain mips)
+  : uniform_name_(std::move(args.uniform_name)), texture_type_(args.texture_type),
+    load_path_(std::move(args.load_path)), cmp_path_(std::move(args.cmp_path)),
+    width_(mips.width), height_(mips.height), nr_channels_(mips.nr_channels), has_mipmap_(true),
+    mips_(std::make_unique<MipChain>(std::move(mips))) {
+  glGenTextures(1, &texture_id_);
+  auto& state = glad::ContextState::current();
+  state.next_draw();
+  state.edit_texture(texture_id_);
 
-    stbi_image_free(data);
-  } else {
-    throw std::runtime_error(std::format("Failed to load texture: {}", load_path_));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, args.min_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, args.mag_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, args.wrap_s);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, args.wrap_t);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips_->level_count() - 1);
+
+  std::tie(internal_format_, format_) =
+    handle_format(args.auto_format, nr_channels_, args.internal_format, args.format);
+
+  // levels finer than the base level stay undefined until they are streamed in
+  resident_level_ = mips_->level_count();
+  for (int level = mips_->level_count() - 1; level >= tail_level(); level--) {
+    upload_level(level);
+  }
+  TextureStreamer::instance().add(this);
+}
+
+Texture::Texture(TextureArgs args, CompressedImage image)
+  : uniform_name_(std::move(args.uniform_name)), texture_type_(args.texture_type),
+    load_path_(std::move(args.load_path)), cmp_path_(std::move(args.cmp_path)),
+    width_(image.width), height_(image.height), has_mipmap_(image.level_count() > 1) {
+  glGenTextures(1, &texture_id_);
+  auto& state = glad::ContextState::current();
+  state.next_draw();
+  state.edit_texture(texture_id_);
+
+  // a single level cannot be sampled with a mipmap filter
+  GLint min_filter = has_mipmap_ || args.min_filter == GL_LINEAR || args.min_filter == GL_NEAREST
+                       ? args.min_filter
+                       : GL_LINEAR;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, args.mag_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, args.wrap_s);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, args.wrap_t);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.level_count() - 1);
+
+  internal_format_ = compressed_format(image.format, image.srgb);
+  for (int level = 0; level < image.level_count(); level++) {
+    auto& data = image.levels[level];
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format_, image.level_width(level),
+                           image.level_height(level), 0, static_cast<GLsizei>(data.size()),
+                           data.data());
+    compressed_bytes_ += data.size();
   }
 }
 
 Texture::~Texture() {
+  if (mips_) {
+    TextureStreamer::instance().remove(this);
+  }
+  glad::ContextState::current().forget_texture(texture_id_);
   glDeleteTextures(1, &texture_id_);
 }
 
-void Texture::bind() const {
-  glActiveTexture(GL_TEXTURE0 + unit_index_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+int Texture::bind() const {
+  return static_cast<int>(glad::ContextState::current().bind_texture(texture_id_));
 }
 
 GLuint Texture::id() const {
   return texture_id_;
 }
 
-int Texture::unit_index() const {
-  return unit_index_;
-}
-
 std::string_view Texture::unform_name() const {
   return uniform_name_;
 }
@@ -70,6 +146,151 @@ std::string_view Texture::cmp_path() const {
   return cmp_path_;
 }
 
+size_t Texture::byte_size() const {
+  if (compressed_bytes_ > 0) {
+    return compressed_bytes_;
+  }
+  size_t size = static_cast<size_t>(width_) * height_ * nr_channels_;
+  return has_mipmap_ ? size * 4 / 3 : size;
+}
+
+size_t Texture::resident_bytes() const {
+  if (!mips_) {
+    return byte_size();
+  }
+  size_t size{};
+  for (int level = resident_level_; level < mips_->level_count(); level++) {
+    size += level_bytes(level);
+  }
+  return size;
+}
+
+void Texture::request_size(float pixels) const {
+  requested_size_ = std::max(requested_size_, pixels);
+}
+
+int Texture::wanted_level() const {
+  int tail = tail_level();
+  if (requested_size_ <= 0.0f) {
+    return tail;
+  }
+  float size = static_cast<float>(std::max(width_, height_));
+  int level = static_cast<int>(std::floor(std::log2(size / requested_size_)));
+  return std::clamp(level, 0, tail);
+}
+
+int Texture::tail_level() const {
+  int level = 0;
+  while (level + 1 < mips_->level_count() &&
+         std::max(mips_->level_width(level), mips_->level_height(level)) > STREAM_TAIL_SIZE) {
+    level++;
+  }
+  return level;
+}
+
+size_t Texture::level_bytes(int level) const {
+  return static_cast<size_t>(mips_->level_width(level)) * mips_->level_height(level) *
+         mips_->nr_channels;
+}
+
+void Texture::upload_level(int level) {
+  auto& state = glad::ContextState::current();
+  state.next_draw();
+  state.edit_texture(texture_id_);
+
+  // levels shrink to widths whose rows are not 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, level, internal_format_, mips_->level_width(level),
+               mips_->level_height(level), 0, format_, GL_UNSIGNED_BYTE,
+               mips_->levels[level].data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  resident_level_ = level;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+}
+
+void Texture::evict_to(int level) {
+  auto& state = glad::ContextState::current();
+  state.next_draw();
+  state.edit_texture(texture_id_);
+
+  // clamp sampling first, then release the storage with zero sized images
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+  for (int evicted = resident_level_; evicted < level; evicted++) {
+    glTexImage2D(GL_TEXTURE_2D, evicted, internal_format_, 0, 0, 0, format_, GL_UNSIGNED_BYTE,
+                 nullptr);
+  }
+  resident_level_ = level;
+}
+
+ImageData Texture::decode(std::string_view load_path) {
+  // thread local flag, decode may run on worker threads
+  stbi_set_flip_vertically_on_load_thread(true);
+
+  ImageData image;
+  std::string path{load_path};
+  image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.nr_channels, 0));
+  if (!image.pixels) {
+    throw std::runtime_error(std::format("Failed to load texture: {}", load_path));
+  }
+
+  return image;
+}
+
+ImageData Texture::decode(std::span<const std::byte> encoded, std::string_view name) {
+  stbi_set_flip_vertically_on_load_thread(true);
+
+  ImageData image;
+  image.pixels.reset(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()),
+                                           static_cast<int>(encoded.size()), &image.width,
+                                           &image.height, &image.nr_channels, 0));
+  if (!image.pixels) {
+    throw std::runtime_error(std::format("Failed to load texture: {}", name));
+  }
+
+  return image;
+}
+
+MipChain Texture::build_mips(ImageData image) {
+  MipChain mips{.width = image.width, .height = image.height, .nr_channels = image.nr_channels};
+  size_t channels = image.nr_channels;
+  auto* pixels = image.pixels.get();
+  mips.levels.emplace_back(pixels, pixels + static_cast<size_t>(image.width) * image.height *
+                                              channels);
+
+  // 2x2 box filter, the last row/column repeats on odd sizes
+  while (mips.level_width(mips.level_count() - 1) > 1 ||
+         mips.level_height(mips.level_count() - 1) > 1) {
+    int parent = mips.level_count() - 1;
+    int parent_width = mips.level_width(parent);
+    int parent_height = mips.level_height(parent);
+    int width = mips.level_width(parent + 1);
+    int height = mips.level_height(parent + 1);
+    auto& source = mips.levels[parent];
+    std::vector<unsigned char> level(static_cast<size_t>(width) * height * channels);
+
+    for (int y = 0; y < height; y++) {
+      int y0 = std::min(2 * y, parent_height - 1);
+      int y1 = std::min(2 * y + 1, parent_height - 1);
+      for (int x = 0; x < width; x++) {
+        int x0 = std::min(2 * x, parent_width - 1);
+        int x1 = std::min(2 * x + 1, parent_width - 1);
+        for (size_t c = 0; c < channels; c++) {
+          auto texel = [&](int tx, int ty) {
+            return static_cast<unsigned>(
+              source[(static_cast<size_t>(ty) * parent_width + tx) * channels + c]);
+          };
+          unsigned sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+          level[(static_cast<size_t>(y) * width + x) * channels + c] =
+            static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+    mips.levels.push_back(std::move(level));
+  }
+  return mips;
+}
+
 std::pair<GLint, GLint> Texture::handle_format(bool auto_format, int nr_channels,
                                                TextureFormat internal_format,
                                                TextureFormat format) {
@@ -105,7 +326,19 @@ GLint Texture::texture_format(TextureFormat format) {
   }
 }
 
-int Texture::init_unit_index() {
-  static int index = 0;
-  return index++;
+GLint Texture::compressed_format(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4:
+      return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+      std::unreachable();
+  }
 }
@@ -0,0 +1,315 @@
+#include "TextureContainer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+constexpr uint32_t four_cc(const char (&code)[5]) {
+  return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 |
+         static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+}
+
+struct DdsPixelFormat {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t four_cc;
+  uint32_t rgb_bit_count;
+  uint32_t masks[4];
+};
+
+struct DdsHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitch_or_linear_size;
+  uint32_t depth;
+  uint32_t mip_map_count;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixel_format;
+  uint32_t caps[4];
+  uint32_t reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124);
+
+struct DdsHeaderDx10 {
+  uint32_t dxgi_format;
+  uint32_t resource_dimension;
+  uint32_t misc_flag;
+  uint32_t array_size;
+  uint32_t misc_flags2;
+};
+
+constexpr uint32_t DDS_MAGIC = four_cc("DDS ");
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+// reserved1[0] of caches written by write_dds, followed by the source hash
+constexpr uint32_t CACHE_TAG = four_cc("OGLB");
+
+struct Ktx2Header {
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+};
+
+struct Ktx2Level {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+};
+
+constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                         0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+// identifier, header and the dfd/kvd/sgd index
+constexpr size_t KTX2_LEVEL_INDEX = 12 + sizeof(Ktx2Header) + 32;
+
+template <typename T>
+T read_pod(std::span<const std::byte> bytes, size_t offset) {
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+struct FormatInfo {
+  BlockFormat format;
+  bool srgb;
+};
+
+std::optional<FormatInfo> dxgi_format(uint32_t format) {
+  switch (format) {
+    case 71: return FormatInfo{BlockFormat::BC1, false};
+    case 72: return FormatInfo{BlockFormat::BC1, true};
+    case 77: return FormatInfo{BlockFormat::BC3, false};
+    case 78: return FormatInfo{BlockFormat::BC3, true};
+    case 80: return FormatInfo{BlockFormat::BC4, false};
+    case 83: return FormatInfo{BlockFormat::BC5, false};
+    case 98: return FormatInfo{BlockFormat::BC7, false};
+    case 99: return FormatInfo{BlockFormat::BC7, true};
+    default: return std::nullopt;
+  }
+}
+
+uint32_t dxgi_format(BlockFormat format, bool srgb) {
+  switch (format) {
+    case BlockFormat::BC1: return srgb ? 72 : 71;
+    case BlockFormat::BC3: return srgb ? 78 : 77;
+    case BlockFormat::BC4: return 80;
+    case BlockFormat::BC5: return 83;
+    case BlockFormat::BC7: return srgb ? 99 : 98;
+    default: std::unreachable();
+  }
+}
+
+std::optional<FormatInfo> vk_format(uint32_t format) {
+  switch (format) {
+    case 131:
+    case 133: return FormatInfo{BlockFormat::BC1, false};
+    case 132:
+    case 134: return FormatInfo{BlockFormat::BC1, true};
+    case 137: return FormatInfo{BlockFormat::BC3, false};
+    case 138: return FormatInfo{BlockFormat::BC3, true};
+    case 139: return FormatInfo{BlockFormat::BC4, false};
+    case 141: return FormatInfo{BlockFormat::BC5, false};
+    case 145: return FormatInfo{BlockFormat::BC7, false};
+    case 146: return FormatInfo{BlockFormat::BC7, true};
+    default: return std::nullopt;
+  }
+}
+
+size_t level_size(const CompressedImage& image, int level) {
+  size_t blocks_x = (image.level_width(level) + 3) / 4;
+  size_t blocks_y = (image.level_height(level) + 3) / 4;
+  return blocks_x * blocks_y * block_bytes(image.format);
+}
+
+// floor(log2(max(width, height))) + 1, a header asking for more levels is corrupt
+uint32_t max_level_count(const CompressedImage& image) {
+  return static_cast<uint32_t>(
+    std::bit_width(static_cast<uint32_t>(std::max({image.width, image.height, 1}))));
+}
+
+CompressedImage read_dds(std::span<const std::byte> bytes, std::string_view name) {
+  if (bytes.size() < 4 + sizeof(DdsHeader)) {
+    throw std::runtime_error(std::format("Truncated DDS file: {}", name));
+  }
+  auto header = read_pod<DdsHeader>(bytes, 4);
+  size_t offset = 4 + sizeof(DdsHeader);
+
+  std::optional<FormatInfo> info{};
+  if (header.pixel_format.flags & DDPF_FOURCC) {
+    auto code = header.pixel_format.four_cc;
+    if (code == four_cc("DX10")) {
+      if (bytes.size() < offset + sizeof(DdsHeaderDx10)) {
+        throw std::runtime_error(std::format("Truncated DDS file: {}", name));
+      }
+      info = dxgi_format(read_pod<DdsHeaderDx10>(bytes, offset).dxgi_format);
+      offset += sizeof(DdsHeaderDx10);
+    } else if (code == four_cc("DXT1")) {
+      info = FormatInfo{BlockFormat::BC1, false};
+    } else if (code == four_cc("DXT5")) {
+      info = FormatInfo{BlockFormat::BC3, false};
+    } else if (code == four_cc("ATI1") || code == four_cc("BC4U")) {
+      info = FormatInfo{BlockFormat::BC4, false};
+    } else if (code == four_cc("ATI2") || code == four_cc("BC5U")) {
+      info = FormatInfo{BlockFormat::BC5, false};
+    }
+  }
+  if (!info) {
+    throw std::runtime_error(std::format("Unsupported DDS format: {}", name));
+  }
+
+  CompressedImage image{
+    .format = info->format,
+    .srgb = info->srgb,
+    .width = static_cast<int>(header.width),
+    .height = static_cast<int>(header.height),
+  };
+  uint32_t level_count = header.flags & DDSD_MIPMAPCOUNT ? std::max(header.mip_map_count, 1u) : 1;
+  level_count = std::min(level_count, max_level_count(image));
+  for (uint32_t level = 0; level < level_count; level++) {
+    auto size = level_size(image, static_cast<int>(level));
+    if (size > bytes.size() - offset) {
+      throw std::runtime_error(std::format("Truncated DDS file: {}", name));
+    }
+    auto data = bytes.subspan(offset, size);
+    image.levels.emplace_back(data.begin(), data.end());
+    offset += size;
+  }
+  return image;
+}
+
+CompressedImage read_ktx2(std::span<const std::byte> bytes, std::string_view name) {
+  if (bytes.size() < KTX2_LEVEL_INDEX) {
+    throw std::runtime_error(std::format("Truncated KTX2 file: {}", name));
+  }
+  auto header = read_pod<Ktx2Header>(bytes, sizeof(KTX2_IDENTIFIER));
+  if (header.supercompression_scheme != 0) {
+    throw std::runtime_error(std::format("Supercompressed KTX2 is not supported: {}", name));
+  }
+  auto info = vk_format(header.vk_format);
+  if (!info || header.pixel_depth > 1) {
+    throw std::runtime_error(std::format("Unsupported KTX2 format: {}", name));
+  }
+
+  CompressedImage image{
+    .format = info->format,
+    .srgb = info->srgb,
+    .width = static_cast<int>(header.pixel_width),
+    .height = static_cast<int>(header.pixel_height),
+  };
+  uint32_t level_count = std::min(std::max(header.level_count, 1u), max_level_count(image));
+  if (bytes.size() < KTX2_LEVEL_INDEX + level_count * sizeof(Ktx2Level)) {
+    throw std::runtime_error(std::format("Truncated KTX2 file: {}", name));
+  }
+  for (uint32_t level = 0; level < level_count; level++) {
+    auto entry = read_pod<Ktx2Level>(bytes, KTX2_LEVEL_INDEX + level * sizeof(Ktx2Level));
+    // layers and faces follow the first image of the level
+    auto size = level_size(image, static_cast<int>(level));
+    if (entry.byte_length < size || size > bytes.size() ||
+        entry.byte_offset > bytes.size() - size) {
+      throw std::runtime_error(std::format("Truncated KTX2 file: {}", name));
+    }
+    auto data = bytes.subspan(entry.byte_offset, size);
+    image.levels.emplace_back(data.begin(), data.end());
+  }
+  return image;
+}
+} // namespace
+
+bool is_compressed_container(std::string_view path) {
+  auto extension = std::filesystem::path{path}.extension().string();
+  std::ranges::transform(extension, extension.begin(),
+                         [](char c) { return static_cast<char>(std::tolower(c)); });
+  return extension == ".dds" || extension == ".ktx2";
+}
+
+CompressedImage read_compressed_texture(std::span<const std::byte> bytes, std::string_view name) {
+  if (bytes.size() >= 4 && read_pod<uint32_t>(bytes, 0) == DDS_MAGIC) {
+    return read_dds(bytes, name);
+  }
+  if (bytes.size() >= sizeof(KTX2_IDENTIFIER) &&
+      std::memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+    return read_ktx2(bytes, name);
+  }
+  throw std::runtime_error(std::format("Unknown compressed texture container: {}", name));
+}
+
+std::string bcn_cache_path(std::string_view source_path) {
+  return std::format("{}.bcn.dds", source_path);
+}
+
+void write_dds(std::string_view path, const CompressedImage& image, uint64_t source_hash) {
+  DdsHeader header{};
+  header.size = sizeof(DdsHeader);
+  // caps, height, width, pixel format, mipmap count, linear size
+  header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | DDSD_MIPMAPCOUNT | 0x80000;
+  header.height = static_cast<uint32_t>(image.height);
+  header.width = static_cast<uint32_t>(image.width);
+  header.pitch_or_linear_size = static_cast<uint32_t>(level_size(image, 0));
+  header.mip_map_count = static_cast<uint32_t>(image.level_count());
+  header.reserved1[0] = CACHE_TAG;
+  header.reserved1[1] = static_cast<uint32_t>(source_hash);
+  header.reserved1[2] = static_cast<uint32_t>(source_hash >> 32);
+  header.pixel_format.size = sizeof(DdsPixelFormat);
+  header.pixel_format.flags = DDPF_FOURCC;
+  header.pixel_format.four_cc = four_cc("DX10");
+  // texture, plus complex and mipmap with more than one level
+  header.caps[0] = 0x1000 | (image.level_count() > 1 ? 0x8 | 0x400000 : 0);
+
+  DdsHeaderDx10 dx10{
+    .dxgi_format = dxgi_format(image.format, image.srgb),
+    // texture 2d
+    .resource_dimension = 3,
+    .array_size = 1,
+  };
+
+  // write to a temporary file first so a crash never leaves a truncated cache behind
+  auto tmp_path = std::format("{}.tmp", path);
+  {
+    std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      throw std::runtime_error(std::format("Failed to open file: {}", tmp_path));
+    }
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    for (auto& level : image.levels) {
+      file.write(reinterpret_cast<const char*>(level.data()),
+                 static_cast<std::streamsize>(level.size()));
+    }
+    if (!file) {
+      throw std::runtime_error(std::format("Failed to write file: {}", tmp_path));
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    throw std::runtime_error(std::format("Failed to replace texture cache: {}", path));
+  }
+}
+
+std::optional<uint64_t> dds_source_hash(std::span<const std::byte> bytes) {
+  if (bytes.size() < 4 + sizeof(DdsHeader) || read_pod<uint32_t>(bytes, 0) != DDS_MAGIC) {
+    return std::nullopt;
+  }
+  auto header = read_pod<DdsHeader>(bytes, 4);
+  if (header.reserved1[0] != CACHE_TAG) {
+    return std::nullopt;
+  }
+  return uint64_t{header.reserved1[1]} | uint64_t{header.reserved1[2]} << 32;
+}
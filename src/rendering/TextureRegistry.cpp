@@ -0,0 +1,111 @@
+#include "TextureRegistry.hpp"
+
+#include <filesystem>
+
+#include "utils/Hash.hpp"
+
+TextureRegistry& TextureRegistry::instance() {
+  static TextureRegistry registry{};
+  return registry;
+}
+
+std::string TextureRegistry::canonical_path(std::string_view load_path) {
+  std::filesystem::path path{load_path};
+  std::error_code ec;
+  auto canonical = std::filesystem::weakly_canonical(path, ec);
+  if (ec) {
+    return path.lexically_normal().generic_string();
+  }
+  return canonical.generic_string();
+}
+
+size_t TextureRegistry::KeyHash::operator()(const PathKey& key) const {
+  return hash_combine(hash_string(key.path), key.variant);
+}
+
+size_t TextureRegistry::KeyHash::operator()(const HashKey& key) const {
+  return hash_combine(key.content_hash, key.variant);
+}
+
+auto TextureRegistry::find(const std::string& canonical_path, uint64_t variant)
+  -> std::shared_ptr<Texture> {
+  std::lock_guard lock{mutex_};
+  auto it = by_path_.find(PathKey{canonical_path, variant});
+  if (it != by_path_.end()) {
+    if (auto texture = it->second.texture.lock()) {
+      hits_++;
+      return texture;
+    }
+  }
+  return nullptr;
+}
+
+auto TextureRegistry::find_by_hash(uint64_t content_hash, uint64_t variant)
+  -> std::shared_ptr<Texture> {
+  std::lock_guard lock{mutex_};
+  auto it = by_hash_.find(HashKey{content_hash, variant});
+  if (it != by_hash_.end()) {
+    if (auto texture = it->second.texture.lock()) {
+      hits_++;
+      return texture;
+    }
+  }
+  misses_++;
+  return nullptr;
+}
+
+auto TextureRegistry::insert(const std::string& canonical_path, uint64_t content_hash,
+                             uint64_t variant, std::unique_ptr<Texture> texture)
+  -> std::shared_ptr<Texture> {
+  std::lock_guard lock{mutex_};
+  PathKey path_key{canonical_path, variant};
+  HashKey hash_key{content_hash, variant};
+  auto it = by_path_.find(path_key);
+  if (it != by_path_.end()) {
+    if (auto existing = it->second.texture.lock()) {
+      return existing;
+    }
+  }
+  auto hash_it = by_hash_.find(hash_key);
+  if (hash_it != by_hash_.end()) {
+    if (auto existing = hash_it->second.texture.lock()) {
+      return existing;
+    }
+  }
+
+  const Texture* raw = texture.get();
+  std::shared_ptr<Texture> handle{
+    texture.release(),
+    [path_key, hash_key](Texture* texture) {
+      TextureRegistry::instance().evict(path_key, hash_key, texture);
+      delete texture;
+    }
+  };
+
+  Entry entry{handle, raw};
+  by_path_[path_key] = entry;
+  by_hash_[hash_key] = entry;
+  resident_bytes_ += raw->byte_size();
+
+  return handle;
+}
+
+auto TextureRegistry::stats() const -> Stats {
+  std::lock_guard lock{mutex_};
+  return Stats{by_path_.size(), resident_bytes_, hits_, misses_};
+}
+
+void TextureRegistry::evict(const PathKey& path_key, const HashKey& hash_key,
+                            const Texture* texture) {
+  std::lock_guard lock{mutex_};
+  // only erase entries that still point to the released texture
+  auto path_it = by_path_.find(path_key);
+  if (path_it != by_path_.end() && path_it->second.raw == texture) {
+    by_path_.erase(path_it);
+  }
+  auto hash_it = by_hash_.find(hash_key);
+  if (hash_it != by_hash_.end() && hash_it->second.raw == texture) {
+    by_hash_.erase(hash_it);
+  }
+  resident_bytes_ -= texture->byte_size();
+}
@@ -0,0 +1,86 @@
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+
+#include "Profiler.hpp"
+
+TextureStreamer& TextureStreamer::instance() {
+  static TextureStreamer streamer{};
+  return streamer;
+}
+
+void TextureStreamer::update(size_t byte_budget) {
+  PROFILE_ZONE("TextureStreamer::update");
+  uploaded_bytes_ = 0;
+  evicted_bytes_ = 0;
+
+  starved_.clear();
+  for (auto* texture : textures_) {
+    int wanted = texture->wanted_level();
+    int resident = texture->resident_level();
+    texture->requested_size_ = 0.0f;
+    if (wanted < resident) {
+      texture->idle_updates_ = 0;
+      starved_.push_back(Starved{texture, wanted});
+    } else if (wanted > resident) {
+      if (++texture->idle_updates_ >= EVICT_UPDATES) {
+        evicted_bytes_ += texture->resident_bytes();
+        texture->evict_to(wanted);
+        evicted_bytes_ -= texture->resident_bytes();
+        texture->idle_updates_ = 0;
+      }
+    } else {
+      texture->idle_updates_ = 0;
+    }
+  }
+
+  // the furthest from its wanted level goes first, one level per texture and
+  // pass so a single large texture cannot take the whole budget
+  std::ranges::sort(starved_, std::greater{}, [](const Starved& starved) {
+    return starved.texture->resident_level() - starved.wanted;
+  });
+  for (bool uploaded = true; uploaded;) {
+    uploaded = false;
+    for (auto& [texture, wanted] : starved_) {
+      int level = texture->resident_level() - 1;
+      if (level < wanted) {
+        continue;
+      }
+      auto bytes = texture->level_bytes(level);
+      if (uploaded_bytes_ > 0 && uploaded_bytes_ + bytes > byte_budget) {
+        continue;
+      }
+      texture->upload_level(level);
+      uploaded_bytes_ += bytes;
+      uploaded = true;
+    }
+  }
+
+  pending_levels_ = 0;
+  for (auto& [texture, wanted] : starved_) {
+    pending_levels_ += static_cast<size_t>(texture->resident_level() - wanted);
+  }
+}
+
+auto TextureStreamer::stats() const -> Stats {
+  Stats stats{
+    .texture_count = textures_.size(),
+    .pending_levels = pending_levels_,
+    .uploaded_bytes = uploaded_bytes_,
+    .evicted_bytes = evicted_bytes_,
+  };
+  for (auto* texture : textures_) {
+    stats.resident_bytes += texture->resident_bytes();
+    stats.full_bytes += texture->byte_size();
+  }
+  return stats;
+}
+
+void TextureStreamer::add(Texture* texture) {
+  textures_.push_back(texture);
+}
+
+void TextureStreamer::remove(Texture* texture) {
+  std::erase(textures_, texture);
+  std::erase_if(starved_, [&](const Starved& starved) { return starved.texture == texture; });
+}
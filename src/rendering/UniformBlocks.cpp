@@ -0,0 +1,51 @@
+#include "UniformBlocks.hpp"
+
+void write_std140(glad::Std140Writer& writer, const CameraBlock& block) {
+  writer.write(block.projection);
+  writer.write(block.view);
+  writer.write(block.view_pos);
+}
+
+void write_std140(glad::Std140Writer& writer, const DirLight& light) {
+  writer.begin_struct();
+  writer.write(light.direction);
+  writer.write(light.ambient);
+  writer.write(light.diffuse);
+  writer.write(light.specular);
+  writer.end_struct();
+}
+
+void write_std140(glad::Std140Writer& writer, const PointLight& light) {
+  writer.begin_struct();
+  writer.write(light.position);
+  writer.write(light.constant);
+  writer.write(light.linear);
+  writer.write(light.quadratic);
+  writer.write(light.ambient);
+  writer.write(light.diffuse);
+  writer.write(light.specular);
+  writer.end_struct();
+}
+
+void write_std140(glad::Std140Writer& writer, const SpotLight& light) {
+  writer.begin_struct();
+  writer.write(light.position);
+  writer.write(light.direction);
+  writer.write(light.cut_off);
+  writer.write(light.outer_cut_off);
+  writer.write(light.constant);
+  writer.write(light.linear);
+  writer.write(light.quadratic);
+  writer.write(light.ambient);
+  writer.write(light.diffuse);
+  writer.write(light.specular);
+  writer.end_struct();
+}
+
+void write_std140(glad::Std140Writer& writer, const LightsBlock& block) {
+  write_std140(writer, block.dir_light);
+  for (auto& light : block.point_lights) {
+    write_std140(writer, light);
+  }
+  write_std140(writer, block.spot_light);
+}
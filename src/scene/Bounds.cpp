@@ -0,0 +1,94 @@
+#include "Bounds.hpp"
+
+void Aabb::expand(const glm::vec3& point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void Aabb::expand(const Aabb& other) {
+  if (other.empty()) {
+    return;
+  }
+  min = glm::min(min, other.min);
+  max = glm::max(max, other.max);
+}
+
+// Arvo: the new extent is the absolute rotation/scale applied to the old one
+Aabb Aabb::transformed(const glm::mat4& transform) const {
+  if (empty()) {
+    return *this;
+  }
+  glm::vec3 new_center = transform * glm::vec4{center(), 1.0f};
+  glm::mat3 linear{transform};
+  glm::vec3 old_extent = extent();
+  glm::vec3 new_extent{};
+  for (int axis = 0; axis < 3; axis++) {
+    new_extent += glm::abs(linear[axis]) * old_extent[axis];
+  }
+  return Aabb{new_center - new_extent, new_center + new_extent};
+}
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4& transform) const {
+  if (empty()) {
+    return *this;
+  }
+  float scale = glm::max(glm::length(glm::vec3{transform[0]}),
+                         glm::max(glm::length(glm::vec3{transform[1]}),
+                                  glm::length(glm::vec3{transform[2]})));
+  return BoundingSphere{glm::vec3{transform * glm::vec4{center, 1.0f}}, radius * scale};
+}
+
+Frustum Frustum::from_matrix(const glm::mat4& view_projection) {
+  // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+  auto row = [&](int i) {
+    return glm::vec4{view_projection[0][i], view_projection[1][i], view_projection[2][i],
+                     view_projection[3][i]};
+  };
+
+  Frustum frustum{};
+  frustum.planes[Left] = row(3) + row(0);
+  frustum.planes[Right] = row(3) - row(0);
+  frustum.planes[Bottom] = row(3) + row(1);
+  frustum.planes[Top] = row(3) - row(1);
+  frustum.planes[Near] = row(3) + row(2);
+  frustum.planes[Far] = row(3) - row(2);
+  for (auto& plane : frustum.planes) {
+    plane /= glm::length(glm::vec3{plane});
+  }
+  return frustum;
+}
+
+Frustum Frustum::to_local(const glm::mat4& local_to_world) const {
+  // dot(plane, M * p) == dot(transpose(M) * plane, p)
+  auto transpose = glm::transpose(local_to_world);
+  Frustum frustum{};
+  for (size_t i = 0; i < planes.size(); i++) {
+    auto plane = transpose * planes[i];
+    frustum.planes[i] = plane / glm::length(glm::vec3{plane});
+  }
+  return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+  for (auto& plane : planes) {
+    if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersects(const Aabb& aabb) const {
+  for (auto& plane : planes) {
+    // corner furthest along the plane normal
+    glm::vec3 positive{
+      plane.x >= 0.0f ? aabb.max.x : aabb.min.x,
+      plane.y >= 0.0f ? aabb.max.y : aabb.min.y,
+      plane.z >= 0.0f ? aabb.max.z : aabb.min.z,
+    };
+    if (glm::dot(glm::vec3{plane}, positive) + plane.w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
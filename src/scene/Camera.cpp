@@ -29,6 +29,10 @@ glm::mat4 Camera::view_matrix() {
   return glm::lookAt(position_, position_ + front_, up_);
 }
 
+Frustum Camera::frustum(const glm::mat4& projection) {
+  return Frustum::from_matrix(projection * view_matrix());
+}
+
 void Camera::process_keyboard(CameraMovement direction, float delta_time) {
   float velocity = movement_speed_ * delta_time;
   if (direction == CameraMovement::Backward)
@@ -60,6 +64,13 @@ void Camera::process_mouse_scroll(float y_offset) {
   zoom_ = glm::clamp(zoom_, 1.0f, 45.0f);
 }
 
+void Camera::look_at(const glm::vec3& target) {
+  auto direction = glm::normalize(target - position_);
+  yaw_ = glm::degrees(std::atan2(direction.z, direction.x));
+  pitch_ = glm::clamp(glm::degrees(std::asin(direction.y)), -89.0f, 89.0f);
+  update_camera_vectors();
+}
+
 void Camera::update_camera_vectors() {
   glm::vec3 front;
   front.x = std::cos(glm::radians(pitch_)) * std::cos(glm::radians(yaw_));
@@ -0,0 +1,229 @@
+#include "FrustumCuller.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CULL_TARGET_SSE
+#define CULL_TARGET_AVX
+#else
+#define CULL_TARGET_SSE __attribute__((target("sse")))
+#define CULL_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace {
+// padding spheres fail every plane test
+constexpr float PADDING_RADIUS = -FLT_MAX;
+
+struct SoaView {
+  const float* x;
+  const float* y;
+  const float* z;
+  const float* radius;
+  size_t count;
+  size_t padded_count;
+};
+
+size_t cull_scalar(const SoaView& spheres, const Frustum& frustum, uint32_t* out) {
+  size_t visible{};
+  for (size_t i = 0; i < spheres.count; i++) {
+    bool inside = true;
+    for (auto& plane : frustum.planes) {
+      float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] +
+                       plane.w + spheres.radius[i];
+      inside &= distance >= 0.0f;
+    }
+    out[visible] = static_cast<uint32_t>(i);
+    visible += inside;
+  }
+  return visible;
+}
+
+#ifdef CULL_X86
+CULL_TARGET_SSE size_t cull_sse(const SoaView& spheres, const Frustum& frustum, uint32_t* out) {
+  __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (size_t p = 0; p < 6; p++) {
+    plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+    plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+    plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+    plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  size_t visible{};
+  for (size_t i = 0; i < spheres.padded_count; i += 4) {
+    __m128 x = _mm_loadu_ps(spheres.x + i);
+    __m128 y = _mm_loadu_ps(spheres.y + i);
+    __m128 z = _mm_loadu_ps(spheres.z + i);
+    __m128 radius = _mm_loadu_ps(spheres.radius + i);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (size_t p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y));
+      distance = _mm_add_ps(distance, _mm_mul_ps(plane_z[p], z));
+      distance = _mm_add_ps(distance, _mm_add_ps(plane_w[p], radius));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+    }
+
+    for (auto mask = static_cast<unsigned>(_mm_movemask_ps(inside)); mask; mask &= mask - 1) {
+      out[visible++] = static_cast<uint32_t>(i + std::countr_zero(mask));
+    }
+  }
+  return visible;
+}
+
+CULL_TARGET_AVX size_t cull_avx(const SoaView& spheres, const Frustum& frustum, uint32_t* out) {
+  __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (size_t p = 0; p < 6; p++) {
+    plane_x[p] = _mm256_set1_ps(frustum.planes[p].x);
+    plane_y[p] = _mm256_set1_ps(frustum.planes[p].y);
+    plane_z[p] = _mm256_set1_ps(frustum.planes[p].z);
+    plane_w[p] = _mm256_set1_ps(frustum.planes[p].w);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  size_t visible{};
+  for (size_t i = 0; i < spheres.padded_count; i += 8) {
+    __m256 x = _mm256_loadu_ps(spheres.x + i);
+    __m256 y = _mm256_loadu_ps(spheres.y + i);
+    __m256 z = _mm256_loadu_ps(spheres.z + i);
+    __m256 radius = _mm256_loadu_ps(spheres.radius + i);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t p = 0; p < 6; p++) {
+      __m256 distance = _mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y));
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(plane_z[p], z));
+      distance = _mm256_add_ps(distance, _mm256_add_ps(plane_w[p], radius));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+    }
+
+    for (auto mask = static_cast<unsigned>(_mm256_movemask_ps(inside)); mask; mask &= mask - 1) {
+      out[visible++] = static_cast<uint32_t>(i + std::countr_zero(mask));
+    }
+  }
+  return visible;
+}
+
+bool cpu_has_avx() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 1);
+  bool osxsave = info[2] & (1 << 27);
+  bool avx = info[2] & (1 << 28);
+  // the os has to save the ymm registers on context switches
+  return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+  return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+} // namespace
+
+FrustumCuller::FrustumCuller() : kernel_(best_kernel()) {}
+
+void FrustumCuller::clear() {
+  x_.clear();
+  y_.clear();
+  z_.clear();
+  radius_.clear();
+  count_ = 0;
+}
+
+void FrustumCuller::reserve(size_t count) {
+  size_t padded = (count + LANES - 1) / LANES * LANES;
+  x_.reserve(padded);
+  y_.reserve(padded);
+  z_.reserve(padded);
+  radius_.reserve(padded);
+}
+
+uint32_t FrustumCuller::add(const BoundingSphere& sphere) {
+  if (count_ == x_.size()) {
+    x_.resize(count_ + LANES, 0.0f);
+    y_.resize(count_ + LANES, 0.0f);
+    z_.resize(count_ + LANES, 0.0f);
+    radius_.resize(count_ + LANES, PADDING_RADIUS);
+  }
+  auto index = static_cast<uint32_t>(count_++);
+  set(index, sphere);
+  return index;
+}
+
+void FrustumCuller::set(uint32_t index, const BoundingSphere& sphere) {
+  x_[index] = sphere.center.x;
+  y_[index] = sphere.center.y;
+  z_[index] = sphere.center.z;
+  // empty bounds never pass
+  radius_[index] = sphere.empty() ? PADDING_RADIUS : sphere.radius;
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  SoaView spheres{x_.data(), y_.data(), z_.data(), radius_.data(), count_, x_.size()};
+  visible.resize(x_.size());
+
+  size_t count{};
+  switch (kernel_) {
+#ifdef CULL_X86
+  case Kernel::Avx:
+    count = cull_avx(spheres, frustum, visible.data());
+    break;
+  case Kernel::Sse:
+    count = cull_sse(spheres, frustum, visible.data());
+    break;
+#endif
+  default:
+    count = cull_scalar(spheres, frustum, visible.data());
+    break;
+  }
+
+  visible.resize(count);
+  return count;
+}
+
+void FrustumCuller::set_kernel(Kernel kernel) {
+  kernel_ = supported(kernel) ? kernel : best_kernel();
+}
+
+auto FrustumCuller::best_kernel() -> Kernel {
+  if (supported(Kernel::Avx)) {
+    return Kernel::Avx;
+  }
+  if (supported(Kernel::Sse)) {
+    return Kernel::Sse;
+  }
+  return Kernel::Scalar;
+}
+
+bool FrustumCuller::supported(Kernel kernel) {
+  switch (kernel) {
+#ifdef CULL_X86
+  case Kernel::Avx: {
+    static const bool avx = cpu_has_avx();
+    return avx;
+  }
+  case Kernel::Sse:
+    return true;
+#endif
+  case Kernel::Scalar:
+    return true;
+  default:
+    return false;
+  }
+}
+
+const char* FrustumCuller::kernel_name(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Avx:
+    return "avx";
+  case Kernel::Sse:
+    return "sse";
+  default:
+    return "scalar";
+  }
+}
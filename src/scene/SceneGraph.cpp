@@ -0,0 +1,67 @@
+#include "SceneGraph.hpp"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+void SceneGraph::reserve(size_t count) {
+  parent_.reserve(count);
+  local_.reserve(count);
+  world_.reserve(count);
+  dirty_.reserve(count);
+  updated_in_.reserve(count);
+}
+
+void SceneGraph::clear() {
+  parent_.clear();
+  local_.clear();
+  world_.clear();
+  dirty_.clear();
+  updated_in_.clear();
+  first_dirty_ = 0;
+}
+
+uint32_t SceneGraph::add_node(const glm::mat4& local, uint32_t parent) {
+  auto node = static_cast<uint32_t>(size());
+  if (parent != NO_PARENT && parent >= node) {
+    throw std::invalid_argument(std::format("Scene node {} has no parent {}", node, parent));
+  }
+
+  parent_.push_back(parent);
+  local_.push_back(local);
+  world_.push_back(local);
+  dirty_.push_back(1);
+  updated_in_.push_back(0);
+  first_dirty_ = std::min<size_t>(first_dirty_, node);
+  return node;
+}
+
+void SceneGraph::set_local(uint32_t node, const glm::mat4& local) {
+  local_[node] = local;
+  dirty_[node] = 1;
+  first_dirty_ = std::min<size_t>(first_dirty_, node);
+}
+
+size_t SceneGraph::update() {
+  if (!dirty()) {
+    return 0;
+  }
+
+  update_count_++;
+  size_t recomputed{};
+  for (size_t i = first_dirty_; i < size(); i++) {
+    auto parent = parent_[i];
+    bool parent_changed = parent != NO_PARENT && updated_in_[parent] == update_count_;
+    if (!dirty_[i] && !parent_changed) {
+      continue;
+    }
+
+    world_[i] = parent == NO_PARENT ? local_[i] : world_[parent] * local_[i];
+    dirty_[i] = 0;
+    updated_in_[i] = update_count_;
+    recomputed++;
+  }
+
+  first_dirty_ = size();
+  return recomputed;
+}